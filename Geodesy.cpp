@@ -13,10 +13,36 @@ DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
 TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
 ***********************************************************************************/
 
+// no FMA contraction: scalar and batch paths must round identically
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
 #include <cmath>
 #include <numbers>
 #include <stdexcept>
 #include "Geodesy.h"
+#include "GeodesyKernels.h"
+#include "GeodesyMath.h"
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+#include "GeodesyTelemetry.h"
+
+namespace {
+
+    using StdMath = GeodesyKernels::StdMath;
+    using WGS84 = GeodesyPolicy::WGS84;
+
+    // Vincenty on the WGS84 ellipsoid
+    template<class M>
+    double VincentyKm(double lat1, double lon1, double lat2, double lon2, int& iterations) {
+        return GeodesyKernels::VincentyKm<M>(lat1, lon1, lat2, lon2, WGS84::a, WGS84::f, iterations);
+    }
+}
 
 // Haversine algorithm *************************************************************
 /// <summary>
@@ -32,18 +58,11 @@ TERMS OF USE : This module is copyrighted. Please keep the Copyright notice inta
 double Geodesy::Haversine(double lat1, double lon1,
                           double lat2, double lon2,
                           Units unit) {
+    GEODESY_PROBE(Haversine, 1);
     try {
-        double φ1 = lat1 * toRad;
-        double φ2 = lat2 * toRad;
-
-        double a = std::sin((φ2 - φ1) / 2);
-        a *= a;
-
-        double b = std::sin(((lon2 - lon1) / 2) * toRad);
-        b *= b * std::cos(φ1) * std::cos(φ2);
-
         // central angle
-        double ca = 2 * std::asin(std::sqrt(a + b));
+        double ca = Reproducible() ? GeodesyKernels::HaversineCA<GeodesyMath>(lat1, lon1, lat2, lon2)
+                                   : GeodesyKernels::HaversineCA<StdMath>(lat1, lon1, lat2, lon2);
         
         return ca * meanR * (unit == Units::SI ? 1.0 : 1.0 / mi2km);
     }
@@ -66,14 +85,11 @@ double Geodesy::Haversine(double lat1, double lon1,
 double Geodesy::SLC(double lat1, double lon1,
                     double lat2, double lon2,
                     Units unit) {
+    GEODESY_PROBE(SLC, 1);
     try {
-        double φ1 = lat1 * toRad;
-        double φ2 = lat2 * toRad;
-        double Δλ = (lon1 - lon2) * toRad;
-
         // central angle
-        double ca = std::acos(std::sin(φ1) * std::sin(φ2) +
-            std::cos(φ1) * std::cos(φ2) * std::cos(Δλ));
+        double ca = Reproducible() ? GeodesyKernels::SLCCA<GeodesyMath>(lat1, lon1, lat2, lon2)
+                                   : GeodesyKernels::SLCCA<StdMath>(lat1, lon1, lat2, lon2);
 
         return ca * meanR * (unit == Units::SI ? 1.0 : 1.0 / mi2km);
     }
@@ -113,68 +129,189 @@ double Geodesy::SLC(double lat1, double lon1,
 double Geodesy::Vincenty(double lat1, double lon1,
                              double lat2, double lon2,
                              Units unit) {
-    const double a = 6378137.0; // WGS84 Earth equatorial radius (m)
-    const double f = 1.0 / 298.257223563;
-    const double b = a * (1.0 - f);
+    GEODESY_PROBE(Vincenty, 1);
     try {
-        double φ1 = lat1 * toRad, φ2 = lat2 * toRad;
-        double Δλ = (lon2 - lon1) * toRad;
-
-        double U1 = std::atan((1 - f) * std::tan(φ1));
-        double U2 = std::atan((1 - f) * std::tan(φ2));
-
-        double sinU1 = std::sin(U1), cosU1 = std::cos(U1);
-        double sinU2 = std::sin(U2), cosU2 = std::cos(U2);
-
-        double λ = Δλ, λPrev;
-        int iterLimit = 100;
-        const double ε = 1e-12;
+#ifdef GEODESY_TELEMETRY
+        auto t0 = std::chrono::steady_clock::now();
+#endif
+        int iterations = 0;
+        double s = Reproducible() ? VincentyKm<GeodesyMath>(lat1, lon1, lat2, lon2, iterations)
+                                  : VincentyKm<StdMath>(lat1, lon1, lat2, lon2, iterations);
+#ifdef GEODESY_TELEMETRY
+        GeodesyTelemetry::RecordVincentyTime(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0).count(), 1);
+        GeodesyTelemetry::RecordVincenty(iterations, s >= 0, lat1, lon1, lat2, lon2);
+#endif
+        if (s < 0) throw std::runtime_error("Vincenty: No convergence");
 
-        double sinσ, cosσ, σ, sinα, cos2α, cos2σM;
-        double u2, A, B, Δσ;
-
-        do {
-            double sinλ = std::sin(λ), cosλ = std::cos(λ);
-            double term1 = cosU2 * sinλ;
-            double term2 = cosU1 * sinU2 - sinU1 * cosU2 * cosλ;
-
-            sinσ = std::sqrt(term1 * term1 + term2 * term2);
-            if (sinσ == 0.0) return 0.0; // coincident points
-
-            cosσ = sinU1 * sinU2 + cosU1 * cosU2 * cosλ;
-            σ = std::atan2(sinσ, cosσ);
+        return s * (unit == Units::SI ? 1.0 : 1.0 / mi2km);
+    }
+    catch (...) { return -1; }
+}
 
-            sinα = (cosU1 * cosU2 * sinλ) / sinσ;
-            double sin2α = sinα * sinα;
-            cos2α = 1.0 - sin2α;
+// Robust spherical variants ******************************************************
+/// <summary>
+/// Haversine with the central angle evaluated as 2·atan2(√h, √(1-h)):
+/// same cost and accuracy as Haversine; h is clamped to 1, so rounding
+/// never yields NaN. Near antipodal points the precision lost in h itself
+/// (up to ~0.2 m on the sphere) remains; use SphericalVincenty there.
+/// </summary>
+/// <returns>double: distance, km/miles</returns>
+double Geodesy::HaversineAtan2(double lat1, double lon1,
+                               double lat2, double lon2,
+                               Units unit) {
+    GEODESY_PROBE(HaversineAtan2, 1);
+    try {
+        double ca = Reproducible() ? GeodesyKernels::HaversineAtan2CA<GeodesyMath>(lat1, lon1, lat2, lon2)
+                                   : GeodesyKernels::HaversineAtan2CA<StdMath>(lat1, lon1, lat2, lon2);
 
-            cos2σM = (cos2α != 0.0) ? cosσ - (2.0 * sinU1 * sinU2) / cos2α : 0.0;
+        return ca * meanR * (unit == Units::SI ? 1.0 : 1.0 / mi2km);
+    }
+    catch (...) { return -1; }
+}
 
-            u2 = (cos2α * (a * a - b * b)) / (b * b);
+/// <summary>
+/// Vincenty formula applied to the sphere (a special case of the
+/// ellipsoidal inverse, closed form): central angle = atan2 of the
+/// cross and dot products of the two position vectors. Well-conditioned
+/// over the full range, at the cost of two more sin/cos than Haversine.
+/// </summary>
+/// <returns>double: distance, km/miles</returns>
+double Geodesy::SphericalVincenty(double lat1, double lon1,
+                                  double lat2, double lon2,
+                                  Units unit) {
+    GEODESY_PROBE(SphericalVincenty, 1);
+    try {
+        double ca = Reproducible() ? GeodesyKernels::SphericalVincentyCA<GeodesyMath>(lat1, lon1, lat2, lon2)
+                                   : GeodesyKernels::SphericalVincentyCA<StdMath>(lat1, lon1, lat2, lon2);
 
-            A = 1.0 + (u2 / 16384.0) *
-                (4096.0 + u2 * (-768.0 + u2 * (320.0 - 175.0 * u2)));
-            B = (u2 / 1024.0) * (256.0 + u2 * (-128.0 + u2 * (74.0 - 47.0 * u2)));
+        return ca * meanR * (unit == Units::SI ? 1.0 : 1.0 / mi2km);
+    }
+    catch (...) { return -1; }
+}
 
-            double cos2αM2 = cos2σM * cos2σM;
-            Δσ = B * sinσ * (cos2σM + (B / 4.0) * (cosσ * (-1.0 + 2.0 * cos2αM2) -
-                (B / 6.0) * cos2σM * (-3.0 + 4.0 * sinσ * sinσ) *
-                (-3.0 + 4.0 * cos2αM2)));
+// Batch methods *******************************************************************
+/// <summary>
+/// Batch (Structure-of-Arrays) counterparts of the scalar methods:
+/// compute n distances dist[i] between (lat1[i], lon1[i]) and
+/// (lat2[i], lon2[i]) in a single call, hoisting the unit conversion
+/// and error handling out of the per-pair path. Large batches are split
+/// over GeodesyParallel worker threads; every element is evaluated by
+/// the same kernel and expression as the scalar method, so results are
+/// identical to it (bit-for-bit in reproducible mode, on any host).
+/// Failed pairs (e.g. Vincenty non-convergence) are set to -1.
+/// </summary>
+/// <param name="dist">double*: output array of n distances, km/miles</param>
+/// <param name="n">size_t: number of pairs</param>
+void Geodesy::HaversineBatch(const double* lat1, const double* lon1,
+                             const double* lat2, const double* lon2,
+                             double* dist, std::size_t n,
+                             Units unit) {
+    GEODESY_PROBE(HaversineBatch, n);
+    const double u = (unit == Units::SI ? 1.0 : 1.0 / mi2km);
+    const bool fixed = Reproducible();
+    GeodesyParallel::For(n, [=](std::size_t lo, std::size_t hi) {
+        if (fixed)
+            for (std::size_t i = lo; i < hi; ++i)
+                dist[i] = GeodesyKernels::HaversineCA<GeodesyMath>(lat1[i], lon1[i], lat2[i], lon2[i]) * meanR * u;
+        else
+            for (std::size_t i = lo; i < hi; ++i)
+                dist[i] = GeodesyKernels::HaversineCA<StdMath>(lat1[i], lon1[i], lat2[i], lon2[i]) * meanR * u;
+    });
+}
 
-            double C = (f / 16.0) * cos2α * (4.0 + f * (4.0 - 3.0 * cos2α));
+void Geodesy::SLCBatch(const double* lat1, const double* lon1,
+                       const double* lat2, const double* lon2,
+                       double* dist, std::size_t n,
+                       Units unit) {
+    GEODESY_PROBE(SLCBatch, n);
+    const double u = (unit == Units::SI ? 1.0 : 1.0 / mi2km);
+    const bool fixed = Reproducible();
+    GeodesyParallel::For(n, [=](std::size_t lo, std::size_t hi) {
+        if (fixed)
+            for (std::size_t i = lo; i < hi; ++i)
+                dist[i] = GeodesyKernels::SLCCA<GeodesyMath>(lat1[i], lon1[i], lat2[i], lon2[i]) * meanR * u;
+        else
+            for (std::size_t i = lo; i < hi; ++i)
+                dist[i] = GeodesyKernels::SLCCA<StdMath>(lat1[i], lon1[i], lat2[i], lon2[i]) * meanR * u;
+    });
+}
 
-            λPrev = λ;
-            λ = Δλ + (1.0 - C) * f * sinα *
-                (σ + C * sinσ * (cos2σM + C * cosσ * (-1.0 + 2.0 * cos2αM2)));
+void Geodesy::VincentyBatch(const double* lat1, const double* lon1,
+                            const double* lat2, const double* lon2,
+                            double* dist, std::size_t n,
+                            Units unit) {
+    GEODESY_PROBE(VincentyBatch, n);
+    const double k = (unit == Units::SI ? 1.0 : 1.0 / mi2km);
+    const bool fixed = Reproducible();
+#ifdef GEODESY_TELEMETRY
+    auto t0 = std::chrono::steady_clock::now();
+#endif
+    // Vincenty is ~10x costlier per pair: split at a smaller grain
+    GeodesyParallel::For(n, [=](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; ++i) {
+            int iterations;
+            double s = fixed ? VincentyKm<GeodesyMath>(lat1[i], lon1[i], lat2[i], lon2[i], iterations)
+                             : VincentyKm<StdMath>(lat1[i], lon1[i], lat2[i], lon2[i], iterations);
+            dist[i] = (s < 0) ? -1 : s * k;
+#ifdef GEODESY_TELEMETRY
+            GeodesyTelemetry::RecordVincenty(iterations, s >= 0,
+                                             lat1[i], lon1[i], lat2[i], lon2[i]);
+#endif
+        }
+    }, GeodesyParallel::grain / 8);
+#ifdef GEODESY_TELEMETRY
+    GeodesyTelemetry::RecordVincentyTime(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - t0).count(), n);
+#endif
+}
 
-            if (std::fabs(λ - λPrev) < ε) break;
-        } while (--iterLimit > 0);
+void Geodesy::HaversineAtan2Batch(const double* lat1, const double* lon1,
+                                  const double* lat2, const double* lon2,
+                                  double* dist, std::size_t n,
+                                  Units unit) {
+    GEODESY_PROBE(HaversineAtan2Batch, n);
+    const double u = (unit == Units::SI ? 1.0 : 1.0 / mi2km);
+    const bool fixed = Reproducible();
+    GeodesyParallel::For(n, [=](std::size_t lo, std::size_t hi) {
+        if (fixed)
+            for (std::size_t i = lo; i < hi; ++i)
+                dist[i] = GeodesyKernels::HaversineAtan2CA<GeodesyMath>(lat1[i], lon1[i], lat2[i], lon2[i]) * meanR * u;
+        else
+            for (std::size_t i = lo; i < hi; ++i)
+                dist[i] = GeodesyKernels::HaversineAtan2CA<StdMath>(lat1[i], lon1[i], lat2[i], lon2[i]) * meanR * u;
+    });
+}
 
-        if (iterLimit == 0) throw std::runtime_error("Vincenty: No convergence");
+void Geodesy::SphericalVincentyBatch(const double* lat1, const double* lon1,
+                                     const double* lat2, const double* lon2,
+                                     double* dist, std::size_t n,
+                                     Units unit) {
+    GEODESY_PROBE(SphericalVincentyBatch, n);
+    const double u = (unit == Units::SI ? 1.0 : 1.0 / mi2km);
+    const bool fixed = Reproducible();
+    GeodesyParallel::For(n, [=](std::size_t lo, std::size_t hi) {
+        if (fixed)
+            for (std::size_t i = lo; i < hi; ++i)
+                dist[i] = GeodesyKernels::SphericalVincentyCA<GeodesyMath>(lat1[i], lon1[i], lat2[i], lon2[i]) * meanR * u;
+        else
+            for (std::size_t i = lo; i < hi; ++i)
+                dist[i] = GeodesyKernels::SphericalVincentyCA<StdMath>(lat1[i], lon1[i], lat2[i], lon2[i]) * meanR * u;
+    });
+}
 
-        double s = b * A * (σ - Δσ) / 1000.0;
+// Reproducible mode ***************************************************************
+/// <summary>
+/// In reproducible mode all scalar and batch methods evaluate their
+/// elementary functions with the fixed GeodesyMath kernels instead of the
+/// C runtime, so every result is bit-identical across hosts (e.g. AVX2
+/// vs. AVX-512 servers with different libm dispatch), thread counts and
+/// batch splits. Results differ from the default mode by a few ulp.
+/// </summary>
+void Geodesy::SetReproducible(bool on) {
+    reproducible.store(on, std::memory_order_relaxed);
+}
 
-        return s * (unit == Units::SI ? 1.0 : 1.0 / mi2km);
-    }
-    catch (...) { return -1; }
+bool Geodesy::Reproducible() {
+    return reproducible.load(std::memory_order_relaxed);
 }
\ No newline at end of file
@@ -14,6 +14,8 @@ TERMS OF USE : This module is copyrighted. Please keep the Copyright notice inta
 ***********************************************************************************/
 
 #pragma once
+#include <atomic>
+#include <cstddef>
 #include <numbers>
 
 /// <summary>
@@ -32,6 +34,8 @@ TERMS OF USE : This module is copyrighted. Please keep the Copyright notice inta
 /// Haversine                       5540.1754190795     3442.5054053574
 /// Spherical Law of Cosines        5540.1754190795     3442.5054053574
 /// Vincenty(Inverse)               5555.0656860095     3451.7577882724
+/// Haversine (atan2)               5540.1754190795     3442.5054053574
+/// Vincenty (sphere)               5540.1754190795     3442.5054053574
 /// --------------------------------------------------------------------
 /// </summary>
 class Geodesy {
@@ -51,6 +55,8 @@ private:
 
     static constexpr double toRad = π / 180.0;
 
+    static inline std::atomic<bool> reproducible{ false };
+
 public:
 
     // SI: km, US: miles
@@ -67,4 +73,44 @@ public:
     static double Vincenty(double lat1, double lon1,
                            double lat2, double lon2,
                            Units unit);
+
+    // spherical variants that never return NaN; SphericalVincenty is also
+    // well-conditioned near antipodal points (HaversineAtan2 is not)
+    static double HaversineAtan2(double lat1, double lon1,
+                                 double lat2, double lon2,
+                                 Units unit);
+
+    static double SphericalVincenty(double lat1, double lon1,
+                                    double lat2, double lon2,
+                                    Units unit);
+
+    // Batch (SoA) methods: dist[i] = Method(lat1[i], lon1[i], lat2[i], lon2[i])
+    static void HaversineBatch(const double* lat1, const double* lon1,
+                               const double* lat2, const double* lon2,
+                               double* dist, std::size_t n,
+                               Units unit);
+
+    static void SLCBatch(const double* lat1, const double* lon1,
+                         const double* lat2, const double* lon2,
+                         double* dist, std::size_t n,
+                         Units unit);
+
+    static void VincentyBatch(const double* lat1, const double* lon1,
+                              const double* lat2, const double* lon2,
+                              double* dist, std::size_t n,
+                              Units unit);
+
+    static void HaversineAtan2Batch(const double* lat1, const double* lon1,
+                                    const double* lat2, const double* lon2,
+                                    double* dist, std::size_t n,
+                                    Units unit);
+
+    static void SphericalVincentyBatch(const double* lat1, const double* lon1,
+                                       const double* lat2, const double* lon2,
+                                       double* dist, std::size_t n,
+                                       Units unit);
+
+    // Reproducible mode: fixed math kernels, bit-identical on every host
+    static void SetReproducible(bool on);
+    static bool Reproducible();
 };
\ No newline at end of file
@@ -0,0 +1,235 @@
+﻿/**********************************************************************************
+Module        : GeodesyAccuracy.cpp | Report Generator | C++
+Description   : Accuracy-vs-throughput (Pareto) report of the Geodesy methods
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************
+Build         : g++ -std=c++20 -O2 Geodesy.cpp GeodesyMath.cpp GeodesyTelemetry.cpp GeodesyAccuracy.cpp -o geodesy_accuracy -pthread
+Usage         : geodesy_accuracy [--format md|csv|json] [--out file]
+              :                  [--pairs N] [--reps N]
+***********************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+#include "GeodesyBench.h"
+#include "GeodesyParallel.h"
+
+namespace {
+
+    using namespace GeodesyBench;
+    using Clock = std::chrono::steady_clock;
+
+    // Evaluation ******************************************************************
+    struct Row {
+        std::string method, corpus;
+        std::size_t pairs = 0, failures = 0, noReference = 0;
+        double maxErr = 0, meanErr = 0, p99Err = 0; // meters
+        double nsPerPair = 0;   // single-threaded
+        bool pareto = false;
+    };
+
+    /// <summary>
+    /// Error statistics of one method on one corpus against the reference;
+    /// failed pairs (result -1) count as infinite error in max/p99.
+    /// </summary>
+    Row Evaluate(const Method& m, const Pairs& p, const std::vector<long double>& ref,
+                 int reps) {
+        const std::size_t n = p.size();
+        std::vector<double> out(n);
+        std::vector<double> err;
+        err.reserve(n);
+
+        Row row;
+        row.method = m.name;
+        row.pairs = n;
+
+        std::vector<double> ns;
+        for (int r = 0; r < reps; ++r) {
+            auto t0 = Clock::now();
+            m.batch(p.lat1.data(), p.lon1.data(), p.lat2.data(), p.lon2.data(),
+                    out.data(), n, Geodesy::Units::SI);
+            auto t1 = Clock::now();
+            ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() / n);
+        }
+        std::sort(ns.begin(), ns.end());
+        row.nsPerPair = ns[ns.size() / 2];
+
+        double sum = 0;
+        std::size_t ok = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            if (std::isnan(ref[i])) { ++row.noReference; continue; }
+            if (!(out[i] >= 0)) { // -1 or NaN
+                ++row.failures;
+                err.push_back(std::numeric_limits<double>::infinity());
+                continue;
+            }
+            double e = static_cast<double>(std::fabs(out[i] * 1000.0L - ref[i]));
+            err.push_back(e);
+            sum += e;
+            ++ok;
+        }
+        if (!err.empty()) {
+            std::sort(err.begin(), err.end());
+            row.maxErr = err.back();
+            row.p99Err = err[std::min(err.size() - 1,
+                static_cast<std::size_t>(std::ceil(0.99 * err.size())) - 1)];
+        }
+        row.meanErr = ok ? sum / ok : std::numeric_limits<double>::infinity();
+        return row;
+    }
+
+    /// <summary>
+    /// Mark rows on the accuracy (p99 error) vs. cost (ns/pair) Pareto
+    /// frontier of their corpus: no other method is both as fast and as
+    /// accurate, and strictly better in one of the two. Rows scored on a
+    /// subset of their corpus (pairs without reference) are incomplete and
+    /// neither on the frontier nor compared against.
+    /// </summary>
+    void MarkPareto(std::vector<Row>& rows) {
+        for (auto& r : rows) {
+            r.pareto = (r.noReference == 0);
+            for (const auto& o : rows) {
+                if (!r.pareto) break;
+                if (&o == &r || o.corpus != r.corpus || o.noReference) continue;
+                if (o.p99Err <= r.p99Err && o.nsPerPair <= r.nsPerPair &&
+                    (o.p99Err < r.p99Err || o.nsPerPair < r.nsPerPair)) {
+                    r.pareto = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Output **********************************************************************
+    std::string Num(double v, const char* fmt = "%.6g") {
+        if (std::isinf(v)) return "inf";
+        char buf[64];
+        std::snprintf(buf, sizeof buf, fmt, v);
+        return buf;
+    }
+
+    void WriteMarkdown(std::FILE* f, const std::vector<Row>& rows) {
+        std::fprintf(f, "| Corpus | Method | Pairs | No ref | Fail | Max err, m | Mean err, m "
+            "| p99 err, m | ns/pair | Pareto |\n");
+        std::fprintf(f, "|:--|:--|--:|--:|--:|--:|--:|--:|--:|:-:|\n");
+        for (const auto& r : rows)
+            std::fprintf(f, "| %s | %s | %zu | %zu | %zu | %s | %s | %s | %s | %s |\n",
+                r.corpus.c_str(), r.method.c_str(), r.pairs, r.noReference, r.failures,
+                Num(r.maxErr).c_str(), Num(r.meanErr).c_str(), Num(r.p99Err).c_str(),
+                Num(r.nsPerPair, "%.1f").c_str(),
+                r.noReference ? "incomplete" : r.pareto ? "yes" : "");
+    }
+
+    void WriteCSV(std::FILE* f, const std::vector<Row>& rows) {
+        std::fprintf(f, "corpus,method,pairs,failures,no_reference,max_err_m,mean_err_m,"
+            "p99_err_m,ns_per_pair,complete,pareto\n");
+        for (const auto& r : rows)
+            std::fprintf(f, "%s,%s,%zu,%zu,%zu,%s,%s,%s,%s,%d,%d\n",
+                r.corpus.c_str(), r.method.c_str(), r.pairs, r.failures, r.noReference,
+                Num(r.maxErr).c_str(), Num(r.meanErr).c_str(), Num(r.p99Err).c_str(),
+                Num(r.nsPerPair, "%.3f").c_str(), r.noReference ? 0 : 1, r.pareto ? 1 : 0);
+    }
+
+    void WriteJSON(std::FILE* f, const std::vector<Row>& rows) {
+        // JSON has no infinity: failed statistics are written as null
+        auto js = [](double v, const char* fmt = "%.6g") {
+            return std::isinf(v) ? std::string("null") : Num(v, fmt);
+        };
+        std::fprintf(f, "{\n  \"report\": \"geodesy-accuracy\",\n  \"version\": \"20.1.001\",\n"
+            "  \"reference\": \"Karney inverse/WGS84, long double, quadrature\",\n  \"threads\": 1,\n  \"results\": [\n");
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            const auto& r = rows[i];
+            std::fprintf(f, "    {\"corpus\": \"%s\", \"method\": \"%s\", \"pairs\": %zu, "
+                "\"failures\": %zu, \"no_reference\": %zu, \"max_err_m\": %s, "
+                "\"mean_err_m\": %s, \"p99_err_m\": %s, \"ns_per_pair\": %s, "
+                "\"complete\": %s, \"pareto\": %s}%s\n",
+                r.corpus.c_str(), r.method.c_str(), r.pairs, r.failures, r.noReference,
+                js(r.maxErr).c_str(), js(r.meanErr).c_str(), js(r.p99Err).c_str(),
+                Num(r.nsPerPair, "%.3f").c_str(), r.noReference ? "false" : "true",
+                r.pareto ? "true" : "false", i + 1 < rows.size() ? "," : "");
+        }
+        std::fprintf(f, "  ]\n}\n");
+    }
+
+    struct Options {
+        std::string format = "md";
+        std::string out;
+        std::size_t pairs = 20000; // per randomized regime
+        int reps = 5;
+    };
+
+    bool ParseArgs(int argc, char** argv, Options& o) {
+        for (int i = 1; i < argc; ++i) {
+            std::string a = argv[i];
+            auto next = [&]() -> const char* { return (i + 1 < argc) ? argv[++i] : nullptr; };
+            const char* v = nullptr;
+            if (a == "--format" && (v = next())) o.format = v;
+            else if (a == "--out" && (v = next())) o.out = v;
+            else if (a == "--pairs" && (v = next())) o.pairs = std::strtoull(v, nullptr, 10);
+            else if (a == "--reps" && (v = next())) o.reps = std::atoi(v);
+            else return false;
+        }
+        return (o.format == "md" || o.format == "csv" || o.format == "json") &&
+            o.pairs > 0 && o.reps > 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseArgs(argc, argv, opt)) {
+        std::fprintf(stderr,
+            "usage: geodesy_accuracy [--format md|csv|json] [--out file]\n"
+            "                        [--pairs N] [--reps N]\n");
+        return 1;
+    }
+
+    struct Corpus { std::string name; Pairs pairs; };
+    std::vector<Corpus> corpora;
+    for (Regime rg : { Regime::SubMeter, Regime::City,
+                       Regime::Continental, Regime::NearAntipodal })
+        corpora.push_back({ RegimeName(rg),
+                            MakePairs(rg, opt.pairs, 52000 + static_cast<int>(rg)) });
+    corpora.push_back({ "real-world", RealWorldPairs() });
+
+    // cost is per-core time: batches single-threaded, as the scalar methods
+    GeodesyParallel::SetThreads(1);
+    std::vector<Row> rows;
+    for (const auto& c : corpora) {
+        const Pairs& p = c.pairs;
+        std::vector<long double> ref(p.size());
+        for (std::size_t i = 0; i < p.size(); ++i)
+            ref[i] = Reference::Meters(p.lat1[i], p.lon1[i], p.lat2[i], p.lon2[i]);
+
+        for (const Method& m : methods) {
+            Row r = Evaluate(m, p, ref, opt.reps);
+            r.corpus = c.name;
+            rows.push_back(r);
+        }
+    }
+    MarkPareto(rows);
+
+    std::FILE* f = stdout;
+    if (!opt.out.empty() && !(f = std::fopen(opt.out.c_str(), "w"))) {
+        std::fprintf(stderr, "geodesy_accuracy: cannot open %s\n", opt.out.c_str());
+        return 1;
+    }
+    if (opt.format == "json") WriteJSON(f, rows);
+    else if (opt.format == "csv") WriteCSV(f, rows);
+    else WriteMarkdown(f, rows);
+    if (f != stdout) std::fclose(f);
+    return 0;
+}
@@ -0,0 +1,195 @@
+﻿/**********************************************************************************
+Module        : GeodesyArea.h | Header File | C++
+Description   : Polygon area and perimeter on the sphere and on the ellipsoid
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+
+/// <summary>
+/// Class GeodesyArea computes the area and perimeter of polygons given
+/// as rings of geo-points (decimal degrees; the closing edge from the
+/// last vertex back to the first is implied).
+/// Area: signed spherical excess, summed edge by edge as the area
+/// between the edge and the equator,
+///   tan(E/2) = -tan(Δλ/2) (t1 + t2) / (1 + t1 t2),  t = tan(φ/2);
+/// positive for counter-clockwise rings, no larger than half the globe
+/// in magnitude; rings around a pole and across the antimeridian need no
+/// special handling by the caller. The spherical methods of policy P use
+/// the sphere of radius E::R (fast); Vincenty maps the vertices to
+/// authalic latitudes, on the equal-area sphere of the ellipsoid E, so
+/// the area is ellipsoidal (edges are great circles of that sphere).
+/// Perimeter: sum of P::Distance over the edges.
+/// Sums are compensated (Neumaier), so long rings keep full precision.
+/// Results are in P::Units squared and P::Units; -1 on failure.
+/// </summary>
+class GeodesyArea {
+
+public:
+    /// <summary>
+    /// Streaming accumulator: vertices are added one at a time, so a ring
+    /// need not be held in memory; Area and Perimeter close the ring
+    /// </summary>
+    template<class P, class T = double>
+    class Ring {
+
+    public:
+        void Add(T lat, T lon) {
+            const T t = M::Tan(Authalic(lat) / 2);
+            if (count == 0) { lat0 = lat; lon0 = lon; t0 = t; }
+            else {
+                Excess(lonPrev, tPrev, lon, t, excess, crossings);
+                T d = P::Distance(latPrev, lonPrev, lat, lon);
+                if (d < 0) failed = true;
+                else perimeter.Add(d);
+            }
+            latPrev = lat; lonPrev = lon; tPrev = t;
+            ++count;
+        }
+
+        std::size_t Count() const { return count; }
+
+        T Area() const {
+            if (count < 3) return 0;
+            Sum e = excess;
+            int c = crossings;
+            Excess(lonPrev, tPrev, lon0, t0, e, c);
+            // a ring around a pole leaves the excess off by a hemisphere
+            const T half = 2 * std::numbers::pi_v<T>;
+            T E = e.Value();
+            if (c & 1) E += (E < 0) ? half : -half;
+            if (E > half) E -= 2 * half;
+            else if (E <= -half) E += 2 * half;
+            return E * Radius() * Radius();
+        }
+
+        /// <summary>
+        /// Excess of the closed ring summed over its edges, radians², before
+        /// the pole correction and the reduction to the smaller region; with
+        /// an even count of prime-meridian crossings (signed, in crossings)
+        /// it is the signed area of the side that holds neither pole
+        /// </summary>
+        T RawExcess(int& crossings) const {
+            crossings = 0;
+            if (count < 3) return 0;
+            Sum e = excess;
+            crossings = this->crossings;
+            Excess(lonPrev, tPrev, lon0, t0, e, crossings);
+            return e.Value();
+        }
+
+        T Perimeter() const {
+            if (count < 2) return 0;
+            T d = P::Distance(latPrev, lonPrev, lat0, lon0);
+            if (failed || d < 0) return -1;
+            Sum p = perimeter;
+            p.Add(d);
+            return p.Value();
+        }
+
+    private:
+        // Neumaier compensated sum
+        struct Sum {
+            T s = 0, c = 0;
+            void Add(T x) {
+                T t = s + x;
+                c += (std::fabs(s) >= std::fabs(x)) ? (s - t) + x : (x - t) + s;
+                s = t;
+            }
+            T Value() const { return s + c; }
+        };
+
+        std::size_t count = 0;
+        T lat0 = 0, lon0 = 0, t0 = 0, latPrev = 0, lonPrev = 0, tPrev = 0;
+        Sum excess, perimeter;
+        int crossings = 0;              // of the prime meridian, signed
+        bool failed = false;            // a perimeter leg failed
+
+        using M = typename P::Math;
+        static constexpr bool sphere = (P::boundF == 0);
+
+        // ellipsoid: authalic sphere radius (km) times units
+        static T Radius() {
+            if (sphere) return T(P::Ellipsoid::R * P::Units::perKm);
+            return T(P::Ellipsoid::a / 1000 * P::Units::perKm) * std::sqrt(Q(1) / 2);
+        }
+
+        // q(sin φ) of the authalic latitude, β = asin(q(sin φ) / q(1))
+        static T Q(T s) {
+            const T f = T(P::Ellipsoid::f), e2 = f * (2 - f), e = std::sqrt(e2);
+            return (1 - e2) * (s / (1 - e2 * s * s) + std::atanh(e * s) / e);
+        }
+
+        static T Authalic(T lat) {
+            T φ = lat * GeodesyKernels::toRad<T>;
+            if (sphere) return φ;
+            return M::Asin(std::clamp(Q(M::Sin(φ)) / Q(1), T(-1), T(1)));
+        }
+
+        static T Normalize(T lon) {
+            lon = std::remainder(lon, T(360));
+            return (lon == -180) ? T(180) : lon;
+        }
+
+        // excess between the edge and the equator; counts the edge's
+        // crossing of the prime meridian (odd total: ring around a pole)
+        static void Excess(T lon1, T t1, T lon2, T t2, Sum& e, int& c) {
+            lon1 = Normalize(lon1);
+            lon2 = Normalize(lon2);
+            T Δλ = Normalize(lon2 - lon1);
+            e.Add(-2 * M::Atan2(M::Tan(Δλ * GeodesyKernels::toRad<T> / 2) * (t1 + t2), 1 + t1 * t2));
+            if (lon1 <= 0 && lon2 > 0 && Δλ > 0) ++c;
+            else if (lon2 <= 0 && lon1 > 0 && Δλ < 0) --c;
+        }
+    };
+
+    template<class P, class T>
+    static T Area(const T* lat, const T* lon, std::size_t n) {
+        Ring<P, T> r;
+        for (std::size_t i = 0; i < n; ++i) r.Add(lat[i], lon[i]);
+        return r.Area();
+    }
+
+    template<class P, class T>
+    static T Perimeter(const T* lat, const T* lon, std::size_t n) {
+        Ring<P, T> r;
+        for (std::size_t i = 0; i < n; ++i) r.Add(lat[i], lon[i]);
+        return r.Perimeter();
+    }
+
+    /// <summary>
+    /// Batch over polygons in CSR form: polygon k is the ring of vertices
+    /// offsets[k] .. offsets[k+1]-1; polygons are split over the threads.
+    /// perimeter may be null.
+    /// </summary>
+    template<class P, class T, class I>
+    static void Batch(const T* lat, const T* lon, const I* offsets, std::size_t count,
+                      T* area, T* perimeter = nullptr) {
+        if (count == 0) return;
+        const std::size_t vertices = static_cast<std::size_t>(offsets[count] - offsets[0]);
+        const std::size_t grain = std::max<std::size_t>(1, GeodesyParallel::grain / P::cost * count / std::max<std::size_t>(vertices, 1));
+        GeodesyParallel::For(count, [=](std::size_t lo, std::size_t hi) {
+            for (std::size_t k = lo; k < hi; ++k) {
+                Ring<P, T> r;
+                for (I i = offsets[k]; i < offsets[k + 1]; ++i) r.Add(lat[i], lon[i]);
+                area[k] = r.Area();
+                if (perimeter) perimeter[k] = r.Perimeter();
+            }
+        }, grain);
+    }
+};
@@ -0,0 +1,549 @@
+﻿/**********************************************************************************
+Module        : GeodesyBench.cpp | Benchmark | C++
+Description   : Microbenchmark of the Geodesy distance methods
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************
+Build         : g++ -std=c++20 -O2 Geodesy.cpp GeodesyMath.cpp GeodesyTelemetry.cpp GeodesyBench.cpp -o geodesy_bench -pthread
+Usage         : geodesy_bench [--format csv|json] [--out file]
+              :               [--pairs N] [--cold-pairs N] [--reps N] [--threads N]
+              :               [--method Haversine|SLC|Vincenty]
+              :               [--regime sub-meter|city|continental|near-antipodal]
+              :               [--perf] [--perf-fp RAWCONFIG]
+              :               [--stress [--max-p99-ns X] [--max-iter N]]
+              :               [--validate]
+Stress        : pathological Vincenty inputs; build with -DGEODESY_TELEMETRY to
+              : report iteration counts; exit code 2 if a budget is exceeded
+              : or a pair has no reference distance
+Validate      : reproducible mode: batch vs. scalar bitwise over thread counts
+              : and alignments, cross-host digest; exit code 2 on mismatch
+***********************************************************************************/
+
+// no FMA contraction: the validation corpus must be identical on every host
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "GeodesyBench.h"
+#include "GeodesyParallel.h"
+#include "GeodesyPerf.h"
+#include "GeodesyTelemetry.h"
+
+namespace {
+
+    using namespace GeodesyBench;
+    using Clock = std::chrono::steady_clock;
+
+    // Cache control ***************************************************************
+    /// <summary>
+    /// Evict the caches by streaming through a buffer larger than the LLC;
+    /// used before every timed pass of the "cold" runs.
+    /// </summary>
+    class CacheFlusher {
+    public:
+        explicit CacheFlusher(std::size_t bytes) : buf(bytes / sizeof(std::uint64_t), 1) {}
+        void Flush() {
+            std::uint64_t acc = 0;
+            for (std::size_t i = 0; i < buf.size(); i += 8) { buf[i] += acc; acc += buf[i]; }
+            sink = acc;
+        }
+    private:
+        std::vector<std::uint64_t> buf;
+        volatile std::uint64_t sink = 0;
+    };
+
+    volatile double checksum = 0; // defeats dead-code elimination
+
+    // Measurement *****************************************************************
+    struct Result {
+        std::string method, regime, mode, cache;
+        std::size_t pairs;
+        int reps;
+        unsigned threads;     // batch worker threads (scalar: 1)
+        double nsPerPair;     // median over reps, wall time
+        double nsPerPairMin;  // best rep
+        double pairsPerSec;
+        // hardware counters per pair (NaN if not profiled/unavailable)
+        std::array<double, PerfCounters::Count> perPair;
+    };
+
+    /// <summary>
+    /// Time one (method, mode) over the pair set; warm runs repeat the
+    /// same small working set, cold runs flush the caches before each rep.
+    /// Batch runs use the GeodesyParallel thread count set by the caller
+    /// (recorded with the result), scalar runs one thread.
+    /// With perf counters, the counts of all timed passes are accumulated
+    /// and reported per pair.
+    /// </summary>
+    Result Measure(const Method& m, bool batch, const Pairs& p,
+                   bool cold, int reps, CacheFlusher& flusher,
+                   PerfCounters* perf) {
+        const std::size_t n = p.size();
+        std::vector<double> out(n);
+        std::vector<double> ns;
+
+        auto pass = [&] {
+            if (batch) {
+                m.batch(p.lat1.data(), p.lon1.data(), p.lat2.data(), p.lon2.data(),
+                        out.data(), n, Geodesy::Units::SI);
+            }
+            else {
+                for (std::size_t i = 0; i < n; ++i)
+                    out[i] = m.scalar(p.lat1[i], p.lon1[i], p.lat2[i], p.lon2[i],
+                                      Geodesy::Units::SI);
+            }
+        };
+
+        std::array<double, PerfCounters::Count> counts{};
+        if (!cold) pass(); // warm-up
+        for (int r = 0; r < reps; ++r) {
+            if (cold) flusher.Flush();
+            if (perf) perf->Start();
+            auto t0 = Clock::now();
+            pass();
+            auto t1 = Clock::now();
+            if (perf) {
+                auto c = perf->Stop();
+                for (int k = 0; k < PerfCounters::Count; ++k) counts[k] += c[k];
+            }
+            ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() / n);
+            checksum = checksum + out[n / 2];
+        }
+        std::sort(ns.begin(), ns.end());
+
+        Result res;
+        res.method = m.name;
+        res.mode = batch ? "batch" : "scalar";
+        res.cache = cold ? "cold" : "warm";
+        res.pairs = n;
+        res.reps = reps;
+        res.threads = batch ? GeodesyParallel::Threads() : 1u;
+        res.nsPerPair = ns[ns.size() / 2];
+        res.nsPerPairMin = ns.front();
+        res.pairsPerSec = 1e9 / res.nsPerPair;
+        for (int k = 0; k < PerfCounters::Count; ++k)
+            res.perPair[k] = perf ? counts[k] / (static_cast<double>(n) * reps)
+                                  : std::numeric_limits<double>::quiet_NaN();
+        return res;
+    }
+
+    // Output **********************************************************************
+    std::string Num(double v, const char* fmt, const char* missing) {
+        if (std::isnan(v)) return missing;
+        char buf[64];
+        std::snprintf(buf, sizeof buf, fmt, v);
+        return buf;
+    }
+
+    double IPC(const Result& r) {
+        return r.perPair[PerfCounters::Instructions] / r.perPair[PerfCounters::Cycles];
+    }
+
+    void WriteCSV(std::FILE* f, const std::vector<Result>& results, bool perf) {
+        std::fprintf(f, "method,regime,mode,cache,pairs,reps,threads,ns_per_pair,ns_per_pair_min,pairs_per_sec");
+        if (perf) {
+            for (const char* name : PerfCounters::names) std::fprintf(f, ",%s_per_pair", name);
+            std::fprintf(f, ",ipc");
+        }
+        std::fprintf(f, "\n");
+        for (const auto& r : results) {
+            std::fprintf(f, "%s,%s,%s,%s,%zu,%d,%u,%.3f,%.3f,%.0f",
+                r.method.c_str(), r.regime.c_str(), r.mode.c_str(), r.cache.c_str(),
+                r.pairs, r.reps, r.threads, r.nsPerPair, r.nsPerPairMin, r.pairsPerSec);
+            if (perf) {
+                for (double v : r.perPair) std::fprintf(f, ",%s", Num(v, "%.4f", "").c_str());
+                std::fprintf(f, ",%s", Num(IPC(r), "%.3f", "").c_str());
+            }
+            std::fprintf(f, "\n");
+        }
+    }
+
+    void WriteJSON(std::FILE* f, const std::vector<Result>& results, bool perf) {
+        std::fprintf(f, "{\n  \"benchmark\": \"geodesy\",\n  \"version\": \"20.1.001\",\n");
+#if defined(__clang__)
+        std::fprintf(f, "  \"compiler\": \"clang %s\",\n", __clang_version__);
+#elif defined(__GNUC__)
+        std::fprintf(f, "  \"compiler\": \"gcc %s\",\n", __VERSION__);
+#elif defined(_MSC_VER)
+        std::fprintf(f, "  \"compiler\": \"msvc %d\",\n", _MSC_VER);
+#endif
+        std::fprintf(f, "  \"results\": [\n");
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            std::fprintf(f, "    {\"method\": \"%s\", \"regime\": \"%s\", \"mode\": \"%s\", "
+                "\"cache\": \"%s\", \"pairs\": %zu, \"reps\": %d, \"threads\": %u, "
+                "\"ns_per_pair\": %.3f, \"ns_per_pair_min\": %.3f, \"pairs_per_sec\": %.0f",
+                r.method.c_str(), r.regime.c_str(), r.mode.c_str(), r.cache.c_str(),
+                r.pairs, r.reps, r.threads, r.nsPerPair, r.nsPerPairMin, r.pairsPerSec);
+            if (perf) {
+                for (int k = 0; k < PerfCounters::Count; ++k)
+                    std::fprintf(f, ", \"%s_per_pair\": %s", PerfCounters::names[k],
+                        Num(r.perPair[k], "%.4f", "null").c_str());
+                std::fprintf(f, ", \"ipc\": %s", Num(IPC(r), "%.3f", "null").c_str());
+            }
+            std::fprintf(f, "}%s\n", i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(f, "  ]\n}\n");
+    }
+
+    // Pathological inputs *********************************************************
+    struct StressResult {
+        std::string method, set;
+        std::size_t pairs = 0, failures = 0, nans = 0, noReference = 0;
+        double maxErr = 0;            // m vs. reference, successful pairs only
+        double meanIter = std::numeric_limits<double>::quiet_NaN();
+        int maxIter = -1;             // Vincenty with GEODESY_TELEMETRY only
+        double p50 = 0, p99 = 0, max = 0; // ns per call, incl. clock overhead
+    };
+
+    /// <summary>
+    /// Run one method over one pathological set: validate the results
+    /// against the reference geodesic, collect the Vincenty iteration
+    /// counts from the telemetry (if compiled in) and time every call.
+    /// </summary>
+    StressResult Stress(const Method& m, const StressSet& set,
+                        const std::vector<long double>& ref, int reps) {
+        const Pairs& p = set.pairs;
+        const std::size_t n = p.size();
+        std::vector<double> out(n);
+
+        StressResult res;
+        res.method = m.name;
+        res.set = set.name;
+        res.pairs = n;
+
+        GeodesyTelemetry::Reset();
+        m.batch(p.lat1.data(), p.lon1.data(), p.lat2.data(), p.lon2.data(),
+                out.data(), n, Geodesy::Units::SI);
+        auto vs = GeodesyTelemetry::Vincenty();
+        if (vs.enabled && vs.calls > 0) {
+            double sum = 0;
+            for (std::size_t k = 0; k < vs.iterations.size(); ++k) sum += double(k) * vs.iterations[k];
+            res.meanIter = sum / vs.calls;
+            res.maxIter = vs.maxIterations;
+        }
+
+        for (std::size_t i = 0; i < n; ++i) {
+            if (std::isnan(out[i])) { ++res.nans; continue; }
+            if (out[i] < 0) { ++res.failures; continue; }
+            if (std::isnan(ref[i])) ++res.noReference;
+            else res.maxErr = std::max(res.maxErr,
+                    static_cast<double>(std::fabs(out[i] * 1000.0L - ref[i])));
+        }
+
+        std::vector<double> ns;
+        ns.reserve(n * reps);
+        for (int r = 0; r < reps; ++r)
+            for (std::size_t i = 0; i < n; ++i) {
+                auto t0 = Clock::now();
+                out[i] = m.scalar(p.lat1[i], p.lon1[i], p.lat2[i], p.lon2[i], Geodesy::Units::SI);
+                auto t1 = Clock::now();
+                ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+            }
+        checksum = checksum + out[n / 2];
+        std::sort(ns.begin(), ns.end());
+        res.p50 = ns[ns.size() / 2];
+        res.p99 = ns[std::min(ns.size() - 1, ns.size() * 99 / 100)];
+        res.max = ns.back();
+        return res;
+    }
+
+    void WriteStressCSV(std::FILE* f, const std::vector<StressResult>& results) {
+        std::fprintf(f, "method,set,pairs,failures,nans,no_reference,max_err_m,mean_iter,max_iter,p50_ns,p99_ns,max_ns\n");
+        for (const auto& r : results)
+            std::fprintf(f, "%s,%s,%zu,%zu,%zu,%zu,%.6g,%s,%s,%.1f,%.1f,%.1f\n",
+                r.method.c_str(), r.set.c_str(), r.pairs, r.failures, r.nans,
+                r.noReference, r.maxErr,
+                Num(r.meanIter, "%.2f", "").c_str(),
+                r.maxIter < 0 ? "" : std::to_string(r.maxIter).c_str(), r.p50, r.p99, r.max);
+    }
+
+    void WriteStressJSON(std::FILE* f, const std::vector<StressResult>& results) {
+        std::fprintf(f, "{\n  \"benchmark\": \"geodesy-stress\",\n  \"version\": \"20.1.001\",\n"
+            "  \"results\": [\n");
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            std::fprintf(f, "    {\"method\": \"%s\", \"set\": \"%s\", \"pairs\": %zu, "
+                "\"failures\": %zu, \"nans\": %zu, \"no_reference\": %zu, \"max_err_m\": %.6g, "
+                "\"mean_iter\": %s, "
+                "\"max_iter\": %s, \"p50_ns\": %.1f, \"p99_ns\": %.1f, \"max_ns\": %.1f}%s\n",
+                r.method.c_str(), r.set.c_str(), r.pairs, r.failures, r.nans,
+                r.noReference, r.maxErr, Num(r.meanIter, "%.2f", "null").c_str(),
+                r.maxIter < 0 ? "null" : std::to_string(r.maxIter).c_str(),
+                r.p50, r.p99, r.max, i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(f, "  ]\n}\n");
+    }
+
+    // Reproducibility validation **************************************************
+    /// <summary>
+    /// Host-independent corpus: inputs derived from the integer output of
+    /// mt19937_64 with exact scaling (no libm, no distribution objects),
+    /// mixing sub-meter, city, continental and global separations.
+    /// </summary>
+    Pairs ValidationPairs(std::size_t n) {
+        std::mt19937_64 rng(57);
+        auto unit = [&] { return static_cast<double>(rng() >> 11) * 0x1p-53; };
+        const double scale[] = { 1e-5, 0.5, 40.0, 180.0 };
+        Pairs p;
+        for (std::size_t i = 0; i < n; ++i) {
+            double lat = unit() * 180.0 - 90.0, lon = unit() * 360.0 - 180.0;
+            double s = scale[i % 4];
+            double lat2 = std::clamp(lat + (unit() - 0.5) * s, -90.0, 90.0);
+            double lon2 = lon + (unit() - 0.5) * 2.0 * s;
+            if (lon2 > 180.0) lon2 -= 360.0;
+            if (lon2 < -180.0) lon2 += 360.0;
+            p.lat1.push_back(lat); p.lon1.push_back(lon);
+            p.lat2.push_back(lat2); p.lon2.push_back(lon2);
+        }
+        return p;
+    }
+
+    // FNV-1a over the bit patterns of the results
+    std::uint64_t Digest(const std::vector<double>& v) {
+        std::uint64_t h = 14695981039346656037ull;
+        for (double d : v) {
+            std::uint64_t bits = std::bit_cast<std::uint64_t>(d);
+            for (int k = 0; k < 8; ++k) { h ^= (bits >> (8 * k)) & 0xff; h *= 1099511628211ull; }
+        }
+        return h;
+    }
+
+    std::size_t Mismatches(const double* a, const double* b, std::size_t n) {
+        std::size_t m = 0;
+        for (std::size_t i = 0; i < n; ++i)
+            m += std::bit_cast<std::uint64_t>(a[i]) != std::bit_cast<std::uint64_t>(b[i]);
+        return m;
+    }
+
+    // digests of the reproducible-mode reference (ValidationPairs(validationPairs), km)
+    constexpr std::size_t validationPairs = 100003;
+    const std::uint64_t expectedDigest[] = {
+        0x260ea8818cc86559ull, 0xd391289769030a05ull, 0x15cf6c1db27a9517ull,
+        0x0c24362534a2a755ull, 0xf4750180d62e4629ull };
+    static_assert(std::size(expectedDigest) == std::size(methods), "one digest per method");
+
+    /// <summary>
+    /// Reproducible mode check: batch results over several thread counts
+    /// and misaligned sub-ranges must be bitwise identical to the scalar
+    /// reference path, and the digest of the reference must match the
+    /// digest recorded on the reference build (cross-host check).
+    /// </summary>
+    bool Validate(std::FILE* f) {
+        const Pairs p = ValidationPairs(validationPairs);
+        const std::size_t n = p.size();
+        bool pass = true;
+        const unsigned hw = GeodesyParallel::Threads();
+
+        std::fprintf(f, "check,method,config,mismatches\n");
+        for (std::size_t mi = 0; mi < std::size(methods); ++mi) {
+            const Method& m = methods[mi];
+            for (bool fixed : { true, false }) {
+                Geodesy::SetReproducible(fixed);
+                const char* mode = fixed ? "reproducible" : "default";
+
+                std::vector<double> ref(n), out(n);
+                for (std::size_t i = 0; i < n; ++i)
+                    ref[i] = m.scalar(p.lat1[i], p.lon1[i], p.lat2[i], p.lon2[i], Geodesy::Units::SI);
+
+                for (unsigned t : { 1u, 2u, 3u, 7u, hw }) {
+                    GeodesyParallel::SetThreads(t);
+                    for (std::size_t off : { std::size_t{ 0 }, std::size_t{ 1 }, std::size_t{ 3 } }) {
+                        m.batch(p.lat1.data() + off, p.lon1.data() + off, p.lat2.data() + off,
+                                p.lon2.data() + off, out.data() + off, n - off, Geodesy::Units::SI);
+                        std::size_t bad = Mismatches(ref.data() + off, out.data() + off, n - off);
+                        std::fprintf(f, "batch-vs-scalar,%s,%s/threads=%u/offset=%zu,%zu\n",
+                            m.name, mode, t, off, bad);
+                        if (fixed && bad) pass = false;
+                    }
+                }
+                GeodesyParallel::SetThreads(0);
+
+                if (fixed) {
+                    std::uint64_t d = Digest(ref);
+                    bool same = (d == expectedDigest[mi]);
+                    std::fprintf(f, "digest,%s,%016llx/expected=%016llx,%d\n", m.name,
+                        (unsigned long long)d, (unsigned long long)expectedDigest[mi], same ? 0 : 1);
+                    if (!same) pass = false;
+                }
+            }
+        }
+        Geodesy::SetReproducible(false);
+        std::fprintf(f, "result,%s,,\n", pass ? "PASS" : "FAIL");
+        return pass;
+    }
+
+    struct Options {
+        std::string format = "csv";
+        std::string out;
+        std::string method;
+        std::string regime;
+        std::size_t pairs = 4096;          // warm working set (fits in L1/L2)
+        std::size_t coldPairs = 1u << 20;  // cold working set (32 MB)
+        int reps = 11;
+        unsigned threads = 1;              // batch threads (0: hardware concurrency)
+        bool stress = false;               // pathological-input mode
+        bool validate = false;             // reproducible-mode validation
+        double maxP99 = 0;                 // stress budgets (0: none)
+        int maxIter = 0;
+        bool perf = false;                 // read hardware counters
+        std::uint64_t perfFP = 0;          // raw PMU config of FP ops
+    };
+
+    bool ParseArgs(int argc, char** argv, Options& o) {
+        for (int i = 1; i < argc; ++i) {
+            std::string a = argv[i];
+            auto next = [&]() -> const char* { return (i + 1 < argc) ? argv[++i] : nullptr; };
+            const char* v = nullptr;
+            if (a == "--format" && (v = next())) o.format = v;
+            else if (a == "--out" && (v = next())) o.out = v;
+            else if (a == "--method" && (v = next())) o.method = v;
+            else if (a == "--regime" && (v = next())) o.regime = v;
+            else if (a == "--pairs" && (v = next())) o.pairs = std::strtoull(v, nullptr, 10);
+            else if (a == "--cold-pairs" && (v = next())) o.coldPairs = std::strtoull(v, nullptr, 10);
+            else if (a == "--reps" && (v = next())) o.reps = std::atoi(v);
+            else if (a == "--threads" && (v = next())) o.threads = static_cast<unsigned>(std::strtoul(v, nullptr, 10));
+            else if (a == "--stress") o.stress = true;
+            else if (a == "--validate") o.validate = true;
+            else if (a == "--max-p99-ns" && (v = next())) o.maxP99 = std::atof(v);
+            else if (a == "--max-iter" && (v = next())) o.maxIter = std::atoi(v);
+            else if (a == "--perf") o.perf = true;
+            else if (a == "--perf-fp" && (v = next())) { o.perf = true; o.perfFP = std::strtoull(v, nullptr, 0); }
+            else return false;
+        }
+        return (o.format == "csv" || o.format == "json") &&
+            o.pairs > 0 && o.coldPairs > 0 && o.reps > 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseArgs(argc, argv, opt)) {
+        std::fprintf(stderr,
+            "usage: geodesy_bench [--format csv|json] [--out file] [--pairs N]\n"
+            "                     [--cold-pairs N] [--reps N] [--threads N] [--method name]\n"
+            "                     [--regime sub-meter|city|continental|near-antipodal]\n"
+            "                     [--perf] [--perf-fp RAWCONFIG]\n"
+            "                     [--stress [--max-p99-ns X] [--max-iter N]]\n"
+            "                     [--validate]\n");
+        return 1;
+    }
+
+    std::FILE* f = stdout;
+    if (!opt.out.empty() && !(f = std::fopen(opt.out.c_str(), "w"))) {
+        std::fprintf(stderr, "geodesy_bench: cannot open %s\n", opt.out.c_str());
+        return 1;
+    }
+
+    if (opt.validate) {
+        bool pass = Validate(f);
+        if (f != stdout) std::fclose(f);
+        return pass ? 0 : 2;
+    }
+
+    if (opt.stress) {
+        std::vector<StressResult> results;
+        bool overBudget = false, noReference = false;
+        for (const StressSet& set : StressCorpus()) {
+            std::vector<long double> ref(set.pairs.size());
+            std::size_t missing = 0;
+            for (std::size_t i = 0; i < ref.size(); ++i) {
+                ref[i] = Reference::Meters(set.pairs.lat1[i], set.pairs.lon1[i],
+                                           set.pairs.lat2[i], set.pairs.lon2[i]);
+                missing += std::isnan(ref[i]);
+            }
+            // the worst cases are the point of the run: errors over a
+            // subset of a set would pass for the whole
+            if (missing) {
+                std::fprintf(stderr, "geodesy_bench: %s: no reference for %zu of %zu pairs\n",
+                    set.name, missing, ref.size());
+                noReference = true;
+            }
+            for (const Method& m : methods) {
+                if (!opt.method.empty() && opt.method != m.name) continue;
+                StressResult r = Stress(m, set, ref, opt.reps);
+                if ((opt.maxP99 > 0 && r.p99 > opt.maxP99) ||
+                    (opt.maxIter > 0 && r.maxIter > opt.maxIter)) {
+                    std::fprintf(stderr, "geodesy_bench: %s/%s over budget "
+                        "(p99 %.1f ns, max iterations %d)\n",
+                        r.method.c_str(), r.set.c_str(), r.p99, r.maxIter);
+                    overBudget = true;
+                }
+                results.push_back(r);
+            }
+        }
+        if (opt.format == "json") WriteStressJSON(f, results);
+        else WriteStressCSV(f, results);
+        if (f != stdout) std::fclose(f);
+        return (overBudget || noReference) ? 2 : 0;
+    }
+
+    // batches single-threaded unless asked: per-pair costs then compare
+    // with the scalar rows; the perf counters see the calling thread only
+    if (opt.perf && opt.threads != 1) {
+        std::fprintf(stderr, "geodesy_bench: --perf counts the calling thread only; "
+            "batches run single-threaded\n");
+        opt.threads = 1;
+    }
+    GeodesyParallel::SetThreads(opt.threads);
+    const Regime regimes[] = { Regime::SubMeter, Regime::City,
+                               Regime::Continental, Regime::NearAntipodal };
+    CacheFlusher flusher(64u << 20);
+    std::vector<Result> results;
+
+    std::unique_ptr<PerfCounters> perf;
+    if (opt.perf) {
+        perf = std::make_unique<PerfCounters>(opt.perfFP);
+        if (!perf->Available())
+            std::fprintf(stderr, "geodesy_bench: perf_event counters unavailable "
+                "(check /proc/sys/kernel/perf_event_paranoid)\n");
+    }
+
+    for (Regime rg : regimes) {
+        if (!opt.regime.empty() && opt.regime != RegimeName(rg)) continue;
+        Pairs warm = MakePairs(rg, opt.pairs, 20110 + static_cast<int>(rg));
+        Pairs cold = MakePairs(rg, opt.coldPairs, 20250 + static_cast<int>(rg));
+
+        for (const Method& m : methods) {
+            if (!opt.method.empty() && opt.method != m.name) continue;
+            for (bool batch : { false, true }) {
+                for (bool isCold : { false, true }) {
+                    Result r = Measure(m, batch, isCold ? cold : warm,
+                                       isCold, opt.reps, flusher, perf.get());
+                    r.regime = RegimeName(rg);
+                    results.push_back(r);
+                }
+            }
+        }
+    }
+
+    if (opt.format == "json") WriteJSON(f, results, opt.perf);
+    else WriteCSV(f, results, opt.perf);
+    if (f != stdout) std::fclose(f);
+    return 0;
+}
@@ -0,0 +1,372 @@
+﻿/**********************************************************************************
+Module        : GeodesyBench.h | Header File | C++
+Description   : Shared input corpora and method table of the Geodesy benchmarks
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <numbers>
+#include <random>
+#include <utility>
+#include <vector>
+#include "Geodesy.h"
+
+namespace GeodesyBench {
+
+    // Distance regimes ************************************************************
+    /// <summary>
+    /// Input distributions: each regime generates pairs of geo-points
+    /// whose separation falls into a typical workload range.
+    /// </summary>
+    enum class Regime { SubMeter, City, Continental, NearAntipodal };
+
+    inline const char* RegimeName(Regime r) {
+        switch (r) {
+        case Regime::SubMeter:      return "sub-meter";
+        case Regime::City:          return "city";
+        case Regime::Continental:   return "continental";
+        case Regime::NearAntipodal: return "near-antipodal";
+        }
+        return "?";
+    }
+
+    // Structure-of-Arrays set of geo-point pairs (decimal degrees)
+    struct Pairs {
+        std::vector<double> lat1, lon1, lat2, lon2;
+        std::size_t size() const { return lat1.size(); }
+    };
+
+    inline double WrapLon(double lon) {
+        while (lon > 180.0) lon -= 360.0;
+        while (lon < -180.0) lon += 360.0;
+        return lon;
+    }
+
+    /// <summary>
+    /// Generate n pairs for the regime; the 1st point is uniform on the
+    /// sphere, the 2nd point lies at a regime-specific great-circle
+    /// distance and random bearing from it (spherical direct problem).
+    /// </summary>
+    inline Pairs MakePairs(Regime r, std::size_t n, std::uint64_t seed) {
+        std::mt19937_64 rng(seed);
+        std::uniform_real_distribution<double> u01(0.0, 1.0);
+        const double π = std::numbers::pi;
+        const double toDeg = 180.0 / π;
+        const double R = 6371.009;
+
+        Pairs p;
+        p.lat1.resize(n); p.lon1.resize(n); p.lat2.resize(n); p.lon2.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            double φ1 = std::asin(2.0 * u01(rng) - 1.0);
+            double lon = 360.0 * u01(rng) - 180.0;
+            double θ = 2.0 * π * u01(rng);
+
+            double δ = 0; // angular distance
+            switch (r) {
+            case Regime::SubMeter:      δ = 1e-3 * u01(rng) / R; break;
+            case Regime::City:          δ = (1.0 + 49.0 * u01(rng)) / R; break;
+            case Regime::Continental:   δ = (500.0 + 4500.0 * u01(rng)) / R; break;
+            case Regime::NearAntipodal: δ = π - 0.5 / toDeg * u01(rng); break;
+            }
+
+            double φ2 = std::asin(std::sin(φ1) * std::cos(δ) +
+                std::cos(φ1) * std::sin(δ) * std::cos(θ));
+            double Δλ = std::atan2(std::sin(θ) * std::sin(δ) * std::cos(φ1),
+                std::cos(δ) - std::sin(φ1) * std::sin(φ2));
+
+            p.lat1[i] = φ1 * toDeg; p.lon1[i] = lon;
+            p.lat2[i] = φ2 * toDeg; p.lon2[i] = WrapLon(lon + Δλ * toDeg);
+        }
+        return p;
+    }
+
+    // Real-world corpus **********************************************************
+    /// <summary>
+    /// Major airports plus high-latitude and polar sites; every unordered
+    /// pair of them forms the "real-world" corpus (trans-oceanic, polar
+    /// and near-antipodal routes included).
+    /// </summary>
+    struct Site { const char* code; double lat, lon; };
+
+    inline const Site sites[] = {
+        { "JFK",  40.641766,  -73.780968 }, { "LHR",  51.470020,   -0.454295 },
+        { "LAX",  33.942791, -118.410042 }, { "HND",  35.549393,  139.779839 },
+        { "SYD", -33.939923,  151.175276 }, { "GRU", -23.435556,  -46.473056 },
+        { "JNB", -26.133694,   28.242317 }, { "DXB",  25.253175,   55.365673 },
+        { "SIN",   1.364420,  103.991531 }, { "CDG",  49.009691,    2.547925 },
+        { "FRA",  50.037933,    8.562152 }, { "ORD",  41.974162,  -87.907321 },
+        { "ATL",  33.640411,  -84.419853 }, { "PEK",  40.079857,  116.603112 },
+        { "DEL",  28.556160,   77.100281 }, { "MEX",  19.436081,  -99.072098 },
+        { "SCL", -33.392975,  -70.785803 }, { "AKL", -37.008056,  174.791667 },
+        { "ANC",  61.174320, -149.996186 }, { "KEF",  63.985000,  -22.605556 },
+        { "HNL",  21.318681, -157.922428 }, { "CPT", -33.971463,   18.602085 },
+        { "EZE", -34.815004,  -58.534828 }, { "YVR",  49.196691, -123.181512 },
+        { "SVO",  55.972642,   37.414589 }, { "IST",  41.275278,   28.751944 },
+        { "CAI",  30.121944,   31.405556 }, { "NBO",  -1.319167,   36.927778 },
+        { "BOM",  19.089560,   72.865614 }, { "BKK",  13.689999,  100.750112 },
+        { "HKG",  22.308047,  113.918480 }, { "ICN",  37.460191,  126.440696 },
+        { "PER", -31.940278,  115.966944 }, { "LIM", -12.021889,  -77.114319 },
+        { "BOG",   4.701594,  -74.146947 }, { "MIA",  25.795865,  -80.287046 },
+        { "SFO",  37.621313, -122.378955 }, { "YYZ",  43.677717,  -79.624819 },
+        { "MAD",  40.498332,   -3.567598 }, { "LOS",   6.577369,    3.321156 },
+        { "ADD",   8.977889,   38.799319 }, { "TLV",  32.011389,   34.886667 },
+        { "MNL",  14.508647,  121.019581 }, { "CGK",  -6.125567,  106.655897 },
+        { "LYR",  78.246111,   15.465556 }, { "USH", -54.843278,  -68.295683 },
+        { "MCM", -77.850000,  166.670000 }, { "NPL",  90.000000,    0.000000 },
+        { "SPL", -90.000000,    0.000000 },
+    };
+
+    inline Pairs RealWorldPairs() {
+        Pairs p;
+        const std::size_t n = std::size(sites);
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t j = i + 1; j < n; ++j) {
+                p.lat1.push_back(sites[i].lat); p.lon1.push_back(sites[i].lon);
+                p.lat2.push_back(sites[j].lat); p.lon2.push_back(sites[j].lon);
+            }
+        return p;
+    }
+
+    // Pathological corpus *********************************************************
+    /// <summary>
+    /// Worst-case inputs of the inverse Vincenty iteration, by category:
+    /// coincident points, equatorial lines (cos²α -> 0), meridional and
+    /// pole-to-pole paths, pairs straddling the antimeridian, exact and
+    /// near-antipodal pairs (incl. equatorial ones, where the geodesic
+    /// leaves the equator and the iteration is slowest to converge).
+    /// </summary>
+    struct StressSet { const char* name; Pairs pairs; };
+
+    inline std::vector<StressSet> StressCorpus(std::size_t perSet = 512,
+                                               std::uint64_t seed = 56) {
+        std::mt19937_64 rng(seed);
+        std::uniform_real_distribution<double> u01(0.0, 1.0);
+        auto lat = [&] { return 180.0 * u01(rng) - 90.0; };
+        auto lon = [&] { return 360.0 * u01(rng) - 180.0; };
+        // offsets spanning 1e-9 .. 1 degree, log-uniform
+        auto tiny = [&] { return std::pow(10.0, -9.0 + 9.0 * u01(rng)); };
+        auto sign = [&] { return u01(rng) < 0.5 ? -1.0 : 1.0; };
+
+        std::vector<StressSet> sets;
+        auto add = [&](const char* name, auto gen) {
+            StressSet s{ name, {} };
+            for (std::size_t i = 0; i < perSet; ++i) {
+                double a, b, c, d;
+                gen(a, b, c, d);
+                s.pairs.lat1.push_back(a); s.pairs.lon1.push_back(b);
+                s.pairs.lat2.push_back(c); s.pairs.lon2.push_back(d);
+            }
+            sets.push_back(std::move(s));
+        };
+
+        add("coincident", [&](double& a, double& b, double& c, double& d) {
+            // includes poles and the antimeridian
+            double φ = (u01(rng) < 0.1) ? 90.0 * sign() : lat();
+            double λ = (u01(rng) < 0.1) ? 180.0 * sign() : lon();
+            a = c = φ; b = d = λ;
+        });
+        add("equatorial", [&](double& a, double& b, double& c, double& d) {
+            a = c = 0.0; b = lon(); d = WrapLon(b + sign() * 179.0 * u01(rng));
+        });
+        add("equatorial-antipodal", [&](double& a, double& b, double& c, double& d) {
+            // Δλ in (179.4, 180]: beyond (1-f)·180 the geodesic is not equatorial
+            a = 0.0; c = sign() * tiny() * 1e-3; b = lon();
+            d = WrapLon(b + 180.0 - 0.6 * u01(rng));
+        });
+        add("meridional", [&](double& a, double& b, double& c, double& d) {
+            a = lat(); c = lat(); b = lon(); d = (u01(rng) < 0.5) ? b : WrapLon(b + 180.0);
+        });
+        add("pole-to-pole", [&](double& a, double& b, double& c, double& d) {
+            a = 90.0 - tiny(); c = -90.0 + tiny(); b = lon(); d = lon();
+        });
+        add("antimeridian", [&](double& a, double& b, double& c, double& d) {
+            a = lat(); c = lat(); b = 180.0 - tiny(); d = -180.0 + tiny();
+        });
+        add("exact-antipodal", [&](double& a, double& b, double& c, double& d) {
+            a = lat(); b = lon(); c = -a; d = WrapLon(b + 180.0);
+        });
+        add("near-antipodal", [&](double& a, double& b, double& c, double& d) {
+            a = lat(); b = lon();
+            c = std::clamp(-a + sign() * tiny(), -90.0, 90.0);
+            d = WrapLon(b + 180.0 + sign() * tiny());
+        });
+        return sets;
+    }
+
+    // Reference geodesic **********************************************************
+    /// <summary>
+    /// High-precision reference: the inverse geodesic problem on the WGS84
+    /// ellipsoid in long double, in Karney's formulation (Algorithms for
+    /// geodesics, 2013). The points are put in canonical order (λ12 in
+    /// [0, π], β1 <= 0, |β2| <= |β1|), where the longitude difference
+    /// λ12(α1) reached by the geodesic leaving point 1 at azimuth α1 grows
+    /// with α1 in [0, π]; the root of λ12(α1) = Δλ is bracketed and found
+    /// by bracketed regula falsi, so it converges for every pair,
+    /// antipodal and equatorial ones included. The distance and λ integrals
+    /// over the auxiliary sphere are evaluated by Gauss-Legendre quadrature
+    /// (error far below 1e-9 m) instead of series.
+    /// </summary>
+    class Reference {
+    public:
+        // distance, meters; NaN only for invalid (non-finite) input
+        static long double Meters(double lat1, double lon1, double lat2, double lon2) {
+            const L π = std::numbers::pi_v<L>, toRad = π / 180;
+            if (!std::isfinite(lat1) || !std::isfinite(lon1) || !std::isfinite(lat2) || !std::isfinite(lon2))
+                return std::numeric_limits<L>::quiet_NaN();
+
+            // canonical order: |lat1| >= |lat2|, lat1 <= 0
+            L Δλ = std::fabs(std::remainder((static_cast<L>(lon2) - lon1) * toRad, 2 * π));
+            L φ1 = lat1 * toRad, φ2 = lat2 * toRad;
+            if (std::fabs(φ1) < std::fabs(φ2)) std::swap(φ1, φ2);
+            if (φ1 > 0) { φ1 = -φ1; φ2 = -φ2; }
+
+            Ends e{};
+            Reduced(φ1, e.sβ1, e.cβ1);
+            Reduced(φ2, e.sβ2, e.cβ2);
+
+            // along the equator up to (1-f)·π the geodesic is the equator
+            if (e.sβ1 == 0 && e.sβ2 == 0 && Δλ <= (1 - f) * π) return a * Δλ;
+
+            // bracket [0, π] of α1: λ12(0) <= Δλ <= λ12(π)
+            L lo = 0, hi = π, s = 0;
+            L vlo = Lambda(e, 0, s) - Δλ;
+            if (vlo >= 0) return s;
+            L vhi = Lambda(e, π, s) - Δλ;
+            if (vhi <= 0) return s;
+            // regula falsi, Illinois variant (the retained end's residual is
+            // halved), until the endpoint is off by less than a·|v| ~ 1e-10 m
+            int side = 0;
+            for (int it = 0; it < 200 && hi - lo > 4 * std::numeric_limits<L>::epsilon(); ++it) {
+                L α = lo - vlo * (hi - lo) / (vhi - vlo);
+                if (!(α > lo && α < hi)) α = (lo + hi) / 2;
+                L v = Lambda(e, α, s) - Δλ;
+                if (std::fabs(v) < 1e-17L) return s;
+                if (v < 0) { lo = α; vlo = v; if (side < 0) vhi /= 2; side = -1; }
+                else { hi = α; vhi = v; if (side > 0) vlo /= 2; side = 1; }
+            }
+            Lambda(e, (lo + hi) / 2, s);
+            return s;
+        }
+
+    private:
+        using L = long double;
+        static constexpr L a = 6378137.0L;
+        static constexpr L f = 1.0L / 298.257223563L;
+        static constexpr L b = a * (1.0L - f);
+        static constexpr L ep2 = (a * a - b * b) / (b * b);  // second eccentricity²
+
+        // sine and cosine of the reduced latitudes of both points
+        struct Ends { L sβ1, cβ1, sβ2, cβ2; };
+
+        static void Reduced(L φ, L& sβ, L& cβ) {
+            L y = (1 - f) * std::sin(φ), x = std::cos(φ), r = std::hypot(y, x);
+            sβ = y / r;
+            cβ = std::max(x / r, std::numeric_limits<L>::min()); // poles: tiny, not 0
+        }
+
+        /// <summary>
+        /// Longitude difference λ12 reached at the latitude of point 2 by the
+        /// geodesic leaving point 1 at azimuth α1, and its length s, meters:
+        ///   λ12 = ω12 - f·sinα0 ∫ (2 - f) / (1 + (1 - f)·√(1 + k²sin²σ)) dσ,
+        ///   s = b ∫ √(1 + k²sin²σ) dσ,   k² = e'²cos²α0, σ over [σ1, σ2].
+        /// </summary>
+        static L Lambda(const Ends& e, L α1, L& s) {
+            const L π = std::numbers::pi_v<L>;
+            const L sα1 = (α1 == π) ? L(0) : std::sin(α1), cα1 = std::cos(α1);
+            const L sα0 = sα1 * e.cβ1, cα0 = std::hypot(cα1, sα1 * e.sβ1);
+            // azimuth at point 2 (heading away from the vertex)
+            L cα2 = std::fabs(cα1);
+            if (e.cβ2 != e.cβ1 || std::fabs(e.sβ2) != -e.sβ1) {
+                L d = (e.cβ1 < -e.sβ1) ? (e.cβ2 - e.cβ1) * (e.cβ1 + e.cβ2)
+                                       : (e.sβ1 - e.sβ2) * (e.sβ1 + e.sβ2);
+                cα2 = std::sqrt(std::max(L(0), cα1 * e.cβ1 * cα1 * e.cβ1 + d)) / e.cβ2;
+            }
+            const L σ1 = std::atan2(e.sβ1, cα1 * e.cβ1), ω1 = std::atan2(sα0 * e.sβ1, cα1 * e.cβ1);
+            const L σ2 = std::atan2(e.sβ2, cα2 * e.cβ2), ω2 = std::atan2(sα0 * e.sβ2, cα2 * e.cβ2);
+            // arcs folded into [0, π]
+            const L σ12 = std::atan2(std::max(L(0), std::sin(σ2 - σ1)), std::cos(σ2 - σ1));
+            const L ω12 = std::atan2(std::max(L(0), std::sin(ω2 - ω1)), std::cos(ω2 - ω1));
+
+            const L k2 = ep2 * cα0 * cα0;
+            L I1 = 0, I3 = 0;
+            const int pieces = 1 + static_cast<int>(σ12 / (π / 4));
+            const L h = σ12 / pieces;
+            const Rule& g = Gauss();
+            for (int p = 0; p < pieces; ++p) {
+                const L mid = σ1 + (p + L(0.5)) * h;
+                for (int q = 0; q < nodes; ++q) {
+                    const L sσ = std::sin(mid + h / 2 * g.x[q]);
+                    const L r = std::sqrt(1 + k2 * sσ * sσ);
+                    I1 += g.w[q] * r;
+                    I3 += g.w[q] * (2 - f) / (1 + (1 - f) * r);
+                }
+            }
+            s = b * I1 * h / 2;
+            return ω12 - f * sα0 * I3 * h / 2;
+        }
+
+        // n-point Gauss-Legendre rule on [-1, 1]: nodes (Newton on the
+        // Legendre polynomial) and weights, computed once in long double
+        static constexpr int nodes = 16;
+        struct Rule {
+            L x[nodes], w[nodes];
+            Rule() {
+                const L π = std::numbers::pi_v<L>;
+                for (int i = 0; i < nodes; ++i) {
+                    L z = std::cos(π * (i + L(0.75)) / (nodes + L(0.5))), dp = 0;
+                    for (int it = 0; it < 100; ++it) {
+                        L p0 = 1, p1 = z;
+                        for (int k = 2; k <= nodes; ++k) {
+                            L p2 = ((2 * k - 1) * z * p1 - (k - 1) * p0) / k;
+                            p0 = p1; p1 = p2;
+                        }
+                        dp = nodes * (z * p1 - p0) / (z * z - 1);
+                        L Δ = p1 / dp;
+                        z -= Δ;
+                        if (std::fabs(Δ) < 1e-20L) break;
+                    }
+                    x[i] = z;
+                    w[i] = 2 / ((1 - z * z) * dp * dp);
+                }
+            }
+        };
+
+        static const Rule& Gauss() {
+            static const Rule rule;
+            return rule;
+        }
+    };
+
+    // Methods under test **********************************************************
+    using ScalarFn = double (*)(double, double, double, double, Geodesy::Units);
+    using BatchFn = void (*)(const double*, const double*, const double*,
+                             const double*, double*, std::size_t, Geodesy::Units);
+
+    struct Method {
+        const char* name;
+        ScalarFn scalar;
+        BatchFn batch;
+    };
+
+    inline const Method methods[] = {
+        { "Haversine",         &Geodesy::Haversine,         &Geodesy::HaversineBatch },
+        { "SLC",               &Geodesy::SLC,               &Geodesy::SLCBatch },
+        { "Vincenty",          &Geodesy::Vincenty,          &Geodesy::VincentyBatch },
+        { "HaversineAtan2",    &Geodesy::HaversineAtan2,    &Geodesy::HaversineAtan2Batch },
+        { "SphericalVincenty", &Geodesy::SphericalVincenty, &Geodesy::SphericalVincentyBatch },
+    };
+}
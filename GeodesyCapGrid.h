@@ -0,0 +1,155 @@
+﻿/**********************************************************************************
+Module        : GeodesyCapGrid.h | Header File | C++
+Description   : Grid index of spherical caps (fences, polygons) over unit vectors
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <utility>
+#include <vector>
+#include "GeodesyKernels.h"
+
+/// <summary>
+/// Class GeodesyCapGrid indexes spherical caps (of geofences, polygons)
+/// on a grid over unit vectors (Earth-centered cubes of edge h, the
+/// median cap diameter): each cap is listed in the cells its bounding
+/// cube overlaps, and a point finds the caps of its cell through an
+/// open-addressing table (linear probing, as GeodesyIndex). Caps of a
+/// hemisphere or more, or over maxCells cells, are candidates of every
+/// point. Caps are given by their unit center and chord radius; the
+/// index holds no geometry, callers test the candidates themselves.
+/// </summary>
+template<class T = double>
+class GeodesyCapGrid {
+
+public:
+    using Vec3 = GeodesyKernels::Vec3<T>;
+
+    static constexpr std::size_t maxCells = 512; // per cap, else a candidate of every point
+
+    /// <summary>
+    /// Index of caps 0 .. n-1: cap(k, center) returns the chord radius
+    /// of cap k and sets its unit center; a negative radius leaves cap k
+    /// out, infinity makes it a candidate of every point
+    /// </summary>
+    template<class F>
+    void Build(std::size_t n, F&& cap) {
+        std::vector<Vec3> center(n);
+        std::vector<T> chord(n);
+        for (std::size_t k = 0; k < n; ++k) chord[k] = cap(k, center[k]);
+        // cell edge: median cap diameter
+        std::vector<T> diameter;
+        for (T r : chord)
+            if (r >= 0 && r < hemisphere) diameter.push_back(2 * r);
+        h = 2;
+        if (!diameter.empty()) {
+            std::nth_element(diameter.begin(), diameter.begin() + diameter.size() / 2, diameter.end());
+            h = std::clamp(diameter[diameter.size() / 2], T(1e-5), T(2));
+        }
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> cell; // (cell key, cap)
+        global.clear();
+        for (std::size_t k = 0; k < n; ++k) {
+            const T r = chord[k];
+            if (!(r >= 0)) continue;
+            if (!(r < hemisphere)) { global.push_back(static_cast<std::uint32_t>(k)); continue; }
+            const Vec3& c = center[k];
+            auto lo = Cell({ c.x - r, c.y - r, c.z - r }), hi = Cell({ c.x + r, c.y + r, c.z + r });
+            double cells = double(hi[0] - lo[0] + 1) * (hi[1] - lo[1] + 1) * (hi[2] - lo[2] + 1);
+            if (cells > maxCells) { global.push_back(static_cast<std::uint32_t>(k)); continue; }
+            for (std::int64_t x = lo[0]; x <= hi[0]; ++x)
+                for (std::int64_t y = lo[1]; y <= hi[1]; ++y)
+                    for (std::int64_t z = lo[2]; z <= hi[2]; ++z)
+                        cell.emplace_back(Key({ x, y, z }), static_cast<std::uint32_t>(k));
+        }
+        std::sort(cell.begin(), cell.end());
+
+        // CSR: caps of each cell, ascending
+        std::vector<std::uint64_t> cellKey;
+        cellStart.clear();
+        cellCap.resize(cell.size());
+        for (std::size_t i = 0; i < cell.size(); ++i) {
+            if (i == 0 || cell[i].first != cell[i - 1].first) {
+                cellKey.push_back(cell[i].first);
+                cellStart.push_back(static_cast<std::uint32_t>(i));
+            }
+            cellCap[i] = cell[i].second;
+        }
+        cellStart.push_back(static_cast<std::uint32_t>(cell.size()));
+        // linear probing, load factor at most 1/2
+        std::size_t size = 16;
+        while (size < 2 * cellKey.size()) size *= 2;
+        slotKey.assign(size, empty);
+        slotCell.assign(size, 0);
+        for (std::size_t c = 0; c < cellKey.size(); ++c) {
+            std::size_t j = Hash(cellKey[c]) & (size - 1);
+            while (slotKey[j] != empty) j = (j + 1) & (size - 1);
+            slotKey[j] = cellKey[c];
+            slotCell[j] = static_cast<std::uint32_t>(c);
+        }
+    }
+
+    /// <summary>
+    /// Call fn(k) for every candidate cap k of unit vector p (the caps of
+    /// its cell merged with those of every point), in ascending order
+    /// </summary>
+    template<class F>
+    void Candidates(const Vec3& p, F&& fn) const {
+        std::size_t lo, hi;
+        Find(Key(Cell(p)), lo, hi);
+        std::size_t g = 0;
+        while (lo < hi || g < global.size()) {
+            if (g == global.size() || (lo < hi && cellCap[lo] < global[g])) fn(static_cast<std::size_t>(cellCap[lo++]));
+            else fn(static_cast<std::size_t>(global[g++]));
+        }
+    }
+
+private:
+    static constexpr T hemisphere = std::numbers::sqrt2_v<T>;   // chord radius of a hemisphere
+    static constexpr std::uint64_t empty = ~std::uint64_t{ 0 };
+
+    std::vector<std::uint32_t> cellStart, cellCap;  // CSR: caps of each cell, ascending
+    std::vector<std::uint64_t> slotKey;             // open addressing: cell key -> cell
+    std::vector<std::uint32_t> slotCell;
+    std::vector<std::uint32_t> global;              // candidates of every point, ascending
+    T h = 2;                                        // cell edge (chord units)
+
+    std::array<std::int64_t, 3> Cell(const Vec3& v) const {
+        auto f = [&](T x) { return static_cast<std::int64_t>(std::floor((std::clamp(x, T(-1), T(1)) + 1) / h)); };
+        return { f(v.x), f(v.y), f(v.z) };
+    }
+
+    static std::uint64_t Key(const std::array<std::int64_t, 3>& c) {
+        return (std::uint64_t(c[0]) << 42) | (std::uint64_t(c[1]) << 21) | std::uint64_t(c[2]);
+    }
+
+    static std::uint64_t Hash(std::uint64_t k) {
+        k ^= k >> 33; k *= 0xff51afd7ed558ccdull; k ^= k >> 33;
+        return k;
+    }
+
+    // caps of the cell of key k: cellCap[lo .. hi-1]
+    void Find(std::uint64_t k, std::size_t& lo, std::size_t& hi) const {
+        lo = hi = 0;
+        if (slotKey.empty()) return;
+        const std::size_t mask = slotKey.size() - 1;
+        for (std::size_t j = Hash(k) & mask;; j = (j + 1) & mask) {
+            if (slotKey[j] == k) { lo = cellStart[slotCell[j]]; hi = cellStart[slotCell[j] + 1]; return; }
+            if (slotKey[j] == empty) return;
+        }
+    }
+};
@@ -0,0 +1,212 @@
+﻿/**********************************************************************************
+Module        : GeodesyCluster.h | Header File | C++
+Description   : Density-based clustering (DBSCAN) of geo-points on a grid index
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "GeodesyIndex.h"
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+
+/// <summary>
+/// Class GeodesyCluster groups geo-points by density (DBSCAN): a point
+/// with at least minPts points (itself included) within eps is a core
+/// point, core points within eps of each other share a cluster, and other
+/// points join the cluster of their nearest core point within eps or are
+/// noise. Neighborhoods come from a GeodesyIndex whose cells have a
+/// diagonal of eps, so a cell holding minPts points is all core and its
+/// core points are connected without any distance evaluated. The eps test
+/// is a squared-chord comparison between unit vectors (no square root or
+/// inverse trigonometry); for Vincenty it preselects candidates that are
+/// confirmed with P::Distance.
+/// Core detection, cluster merging (lock-free union-find) and border
+/// assignment run in parallel; labels do not depend on the thread count.
+/// </summary>
+class GeodesyCluster {
+
+public:
+    static constexpr std::int32_t noise = -1;
+
+    struct Result {
+        std::vector<std::int32_t> label; // cluster of each input point, or noise
+        std::size_t clusters = 0;        // numbered 0 .. clusters-1 in input order
+        std::size_t core = 0;            // number of core points
+    };
+
+    /// <summary>
+    /// DBSCAN of n points (decimal degrees)
+    /// </summary>
+    /// <param name="eps">T: neighborhood radius, P::Units</param>
+    /// <param name="minPts">size_t: neighbors (self included) of a core point</param>
+    template<class P, class T>
+    static Result DBSCAN(const T* lat, const T* lon, std::size_t n, T eps, std::size_t minPts) {
+        using Index = GeodesyIndex<P, T>;
+        using Id = typename Index::Id;
+
+        Result res;
+        res.label.assign(n, noise);
+        if (n == 0 || !(eps >= 0)) return res;
+        minPts = std::max<std::size_t>(minPts, 1);
+
+        const T c = Index::Chord(eps), c2 = c * c;
+        Index index(lat, lon, n, Index::FromChord(c / std::sqrt(T(3))) * T(1 - 1e-9));
+        // mostly single-point cells: eps-sized cells visit ~5x fewer neighbors
+        if (index.Cells() * 2 > n) index = Index(lat, lon, n, eps * T(1 + 1e-9));
+        // a whole cell is within eps of each of its points
+        const bool solid = (P::boundF == 0) && index.Edge() * std::sqrt(T(3)) <= c;
+        const std::size_t cells = index.Cells();
+
+        auto near = [&](Id a, Id b) {
+            if (Index::Chord2(index.Vector(a), index.Vector(b)) > c2) return false;
+            if (P::boundF == 0) return true;
+            Id i = index.Original(a), j = index.Original(b);
+            T d = P::Distance(lat[i], lon[i], lat[j], lon[j]);
+            return d >= 0 && d <= eps;
+        };
+
+        // core points (stored order)
+        std::vector<char> core(n, 0);
+        GeodesyParallel::For(cells, [&](std::size_t lo, std::size_t hi) {
+            std::vector<std::size_t> adj;
+            for (std::size_t ci = lo; ci < hi; ++ci) {
+                const Id b = index.Begin(ci), e = index.End(ci);
+                if (solid && e - b >= minPts) { std::fill(core.begin() + b, core.begin() + e, 1); continue; }
+                index.NearCells(ci, c, adj);
+                for (Id a = b; a < e; ++a) {
+                    std::size_t count = solid ? e - b : 0;
+                    for (std::size_t cj : adj) {
+                        if (solid && cj == ci) continue;
+                        for (Id x = index.Begin(cj); x < index.End(cj) && count < minPts; ++x)
+                            count += near(a, x);
+                        if (count >= minPts) break;
+                    }
+                    core[a] = (count >= minPts);
+                }
+            }
+        }, 64);
+
+        // merge core points within eps: union-find, larger root linked
+        // under the smaller, so every cluster ends rooted at its first
+        // stored core point whatever the order of the unions
+        std::vector<std::atomic<Id>> parent(n);
+        for (std::size_t k = 0; k < n; ++k) parent[k].store(static_cast<Id>(k), std::memory_order_relaxed);
+        auto find = [&](Id a) {
+            for (;;) {
+                Id p = parent[a].load(std::memory_order_relaxed);
+                if (p == a) return a;
+                Id g = parent[p].load(std::memory_order_relaxed);
+                if (g != p) parent[a].compare_exchange_weak(p, g, std::memory_order_relaxed);
+                a = g;
+            }
+        };
+        auto unite = [&](Id a, Id b) {
+            for (;;) {
+                a = find(a); b = find(b);
+                if (a == b) return;
+                if (a < b) std::swap(a, b);
+                Id expected = a;
+                if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) return;
+            }
+        };
+
+        GeodesyParallel::For(cells, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t ci = lo; ci < hi; ++ci) {
+                const Id b = index.Begin(ci), e = index.End(ci);
+                Id first = e;
+                for (Id a = b; a < e; ++a) {
+                    if (!core[a]) continue;
+                    if (first == e) first = a;
+                    if (solid) { unite(first, a); continue; }
+                    for (Id x = b; x < a; ++x)
+                        if (core[x] && find(x) != find(a) && near(a, x)) unite(a, x);
+                }
+            }
+        }, 64);
+
+        // then across neighboring cells, each pair once
+        GeodesyParallel::For(cells, [&](std::size_t lo, std::size_t hi) {
+            std::vector<std::size_t> adj;
+            for (std::size_t ci = lo; ci < hi; ++ci) {
+                const Id b = index.Begin(ci), e = index.End(ci);
+                Id first = b;
+                while (first < e && !core[first]) ++first;
+                if (first == e) continue;
+                index.NearCells(ci, c, adj);
+                for (std::size_t cj : adj) {
+                    if (cj <= ci) continue;
+                    bool joined = false;
+                    if (solid) {
+                        // solid cells: one connecting pair joins all their core points
+                        Id y = index.Begin(cj);
+                        while (y < index.End(cj) && !core[y]) ++y;
+                        joined = (y == index.End(cj)) || find(y) == find(first);
+                    }
+                    for (Id a = first; a < e && !joined; ++a) {
+                        if (!core[a]) continue;
+                        for (Id x = index.Begin(cj); x < index.End(cj); ++x) {
+                            if (!core[x] || find(x) == find(a)) continue;
+                            if (near(a, x)) { unite(a, x); joined = solid; if (joined) break; }
+                        }
+                    }
+                }
+            }
+        }, 64);
+
+        // border points: nearest core point within eps
+        std::vector<Id> owner(n);
+        GeodesyParallel::For(cells, [&](std::size_t lo, std::size_t hi) {
+            std::vector<std::size_t> adj;
+            for (std::size_t ci = lo; ci < hi; ++ci) {
+                const Id b = index.Begin(ci), e = index.End(ci);
+                bool border = false;
+                for (Id a = b; a < e; ++a) {
+                    owner[a] = core[a] ? find(a) : Index::none;
+                    border |= !core[a];
+                }
+                if (!border) continue;
+                index.NearCells(ci, c, adj);
+                for (Id a = b; a < e; ++a) {
+                    if (core[a]) continue;
+                    T best = std::numeric_limits<T>::infinity();
+                    for (std::size_t cj : adj)
+                        for (Id x = index.Begin(cj); x < index.End(cj); ++x) {
+                            if (!core[x]) continue;
+                            T d2 = Index::Chord2(index.Vector(a), index.Vector(x));
+                            if (d2 < best && near(a, x)) { best = d2; owner[a] = find(x); }
+                        }
+                }
+            }
+        }, 64);
+
+        // number the clusters in order of their first input point
+        std::vector<Id> stored(n);
+        for (std::size_t k = 0; k < n; ++k) stored[index.Original(k)] = static_cast<Id>(k);
+        std::vector<std::int32_t> number(n, noise);
+        for (std::size_t i = 0; i < n; ++i) {
+            Id k = stored[i];
+            res.core += core[k] != 0;
+            Id root = owner[k];
+            if (root == Index::none) continue;
+            if (number[root] == noise) number[root] = static_cast<std::int32_t>(res.clusters++);
+            res.label[i] = number[root];
+        }
+        return res;
+    }
+};
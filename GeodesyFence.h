@@ -0,0 +1,307 @@
+﻿/**********************************************************************************
+Module        : GeodesyFence.h | Header File | C++
+Description   : Streaming geofence engine: enter, exit and dwell events
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numbers>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "GeodesyCapGrid.h"
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+#include "GeodesyPolygon.h"
+#include "GeodesySegment.h"
+
+/// <summary>
+/// Class GeodesyFence turns a stream of object positions into geofence
+/// events. Fences are circles (center, radius) or polygons
+/// (GeodesyPolygon); each object's state is the set of fences it is in.
+///   Enter: the object is inside a fence by at least the margin;
+///   Exit: the object is outside a fence it was in by more than the
+///   margin (hysteresis: positions jittering across a boundary raise no
+///   events while within the margin of it);
+///   Dwell: the object has been in a fence for the dwell time (once per
+///   stay).
+/// Fences are indexed on a grid over unit vectors by their bounding caps,
+/// grown by the margin (GeodesyCapGrid), so an update tests only the
+/// fences of its cell.
+/// Circles compare squared chords (spherical methods; Vincenty confirms
+/// near the radius with P::Distance); polygon margins use the distance to
+/// the boundary (GeodesySegment::Polyline), evaluated only when the
+/// containment disagrees with the state. Object states are sharded by
+/// object id: a batch of updates runs in parallel over the shards, each
+/// object's updates in input order; an object has a state only while it
+/// is in a fence. Distances are in P::Units; times are
+/// in any unit, non-decreasing per object.
+/// </summary>
+template<class P, class T = double>
+class GeodesyFence {
+
+public:
+    enum class Type : std::uint8_t { Enter, Exit, Dwell };
+
+    struct Event {
+        std::uint64_t object;
+        std::size_t fence;
+        Type type;
+        double time;
+    };
+
+    /// <param name="margin">T: hysteresis distance, P::Units</param>
+    /// <param name="dwell">double: time in a fence for a Dwell event; 0: none</param>
+    /// <param name="shards">size_t: object state partitions (parallelism of a batch)</param>
+    explicit GeodesyFence(T margin = 0, double dwell = 0, std::size_t shards = 64)
+        : margin(std::max(margin, T(0))), dwell(dwell), shard(std::max<std::size_t>(shards, 1)) {}
+
+    std::size_t AddCircle(T lat, T lon, T radius) {
+        Fence f;
+        f.lat = lat; f.lon = lon; f.radius = radius;
+        f.center = Unit(lat, lon);
+        f.bound = GeodesyPolicy::BoundVector<P>(lat, lon);
+        T in = std::max(radius - margin, T(0)), out = radius + margin;
+        f.chordIn = (radius >= margin) ? K::Chord2Of(in / Radius()) : T(-1);
+        f.chordOut = K::Chord2Of(out / Radius());
+        f.capAngle = out / T(P::boundR * P::Units::perKm);
+        return Add(std::move(f));
+    }
+
+    std::size_t AddPolygon(const T* lat, const T* lon, std::size_t n) {
+        Fence f;
+        f.polygon = true;
+        f.shape = GeodesyPolygon<P, T>(lat, lon, n);
+        if (margin > 0 && n > 0) {
+            // closed boundary for the distance to it
+            std::vector<T> la(lat, lat + n), lo(lon, lon + n);
+            la.push_back(lat[0]); lo.push_back(lon[0]);
+            f.boundary = std::make_unique<const Boundary>(la.data(), lo.data(), la.size());
+        }
+        f.center = f.shape.CapCenter();
+        f.capAngle = (f.shape.CapCos() > -1) ? std::acos(std::min(f.shape.CapCos(), T(1))) + margin / Radius() * T(1.01)
+                                             : std::numbers::pi_v<T>;
+        return Add(std::move(f));
+    }
+
+    std::size_t Fences() const { return fence.size(); }
+
+    // objects in at least one fence
+    std::size_t Objects() const {
+        std::size_t n = 0;
+        for (const auto& s : shard) n += s.size();
+        return n;
+    }
+
+    /// <summary>
+    /// Update of object id at time t to (lat, lon): event(Event) for each
+    /// fence entered, left or dwelt in, in fence order
+    /// </summary>
+    template<class F>
+    void Update(std::uint64_t id, double t, T lat, T lon, F&& event) {
+        Prepare();
+        Scratch s;
+        Apply(shard[id % shard.size()], id, t, lat, lon, s, event);
+    }
+
+    /// <summary>
+    /// Batch of n updates (id[i], t[i], lat[i], lon[i]): shards run in
+    /// parallel, each object's updates in input order; events are then
+    /// passed to event(Event) ordered by update
+    /// </summary>
+    template<class I, class F>
+    void Update(const I* id, const double* t, const T* lat, const T* lon, std::size_t n, F&& event) {
+        Prepare();
+        const std::size_t S = shard.size();
+        // updates grouped by shard, in input order (counting sort into
+        // packed records: sequential reads, one write stream per shard)
+        struct Item { std::uint64_t id; double t; T lat, lon; std::size_t i; };
+        std::vector<std::size_t> start(S + 1, 0);
+        for (std::size_t i = 0; i < n; ++i) ++start[static_cast<std::uint64_t>(id[i]) % S + 1];
+        for (std::size_t s = 0; s < S; ++s) start[s + 1] += start[s];
+        std::vector<Item> item(n);
+        {
+            std::vector<std::size_t> next(start.begin(), start.end() - 1);
+            for (std::size_t i = 0; i < n; ++i) {
+                const std::uint64_t o = static_cast<std::uint64_t>(id[i]);
+                item[next[o % S]++] = { o, t[i], lat[i], lon[i], i };
+            }
+        }
+        std::vector<std::vector<std::pair<std::size_t, Event>>> found(S);
+        GeodesyParallel::For(S, [&](std::size_t lo, std::size_t hi) {
+            Scratch scratch;
+            for (std::size_t s = lo; s < hi; ++s)
+                for (std::size_t k = start[s]; k < start[s + 1]; ++k) {
+                    const Item& u = item[k];
+                    Apply(shard[s], u.id, u.t, u.lat, u.lon, scratch,
+                          [&](const Event& e) { found[s].emplace_back(u.i, e); });
+                }
+        }, 1);
+        std::vector<std::pair<std::size_t, Event>> all;
+        for (auto& f : found) all.insert(all.end(), f.begin(), f.end());
+        std::stable_sort(all.begin(), all.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (const auto& e : all) event(e.second);
+    }
+
+    // fences object id is in, ascending
+    std::vector<std::size_t> Inside(std::uint64_t id) const {
+        std::vector<std::size_t> out;
+        const auto& s = shard[id % shard.size()];
+        auto it = s.find(id);
+        if (it != s.end())
+            for (const Member& m : it->second) out.push_back(m.fence);
+        return out;
+    }
+
+private:
+    using Vec3 = GeodesyPolicy::Vec3<T>;
+    using M = typename P::Math;
+    using K = GeodesyKernels;
+    using Boundary = GeodesySegment::Polyline<P, T>;
+
+    struct Fence {
+        bool polygon = false;
+        T lat = 0, lon = 0, radius = 0;
+        Vec3 center{}, bound{};
+        T chordIn = -1, chordOut = 0;                // circle: squared chords of radius -+ margin
+        GeodesyPolygon<P, T> shape;
+        std::unique_ptr<const Boundary> boundary;   // polygon with a margin
+        T capAngle = 0;                               // index cap, rad
+    };
+
+    struct Member {
+        std::uint32_t fence;
+        double since;
+        bool dwelt;
+    };
+
+    using Object = std::vector<Member>;
+    using Shard = std::unordered_map<std::uint64_t, Object>;   // a shard: objects in a fence
+
+    struct Scratch {
+        Object next;
+    };
+
+    enum class Zone : std::uint8_t { In, Out, Keep };
+
+    T margin;
+    double dwell;
+    std::vector<Fence> fence;
+    std::vector<Shard> shard;
+    GeodesyCapGrid<T> grid;
+    bool dirty = false;
+
+    static T Radius() { return T(P::Ellipsoid::R * P::Units::perKm); }
+
+    static Vec3 Unit(T lat, T lon) { return GeodesyKernels::UnitVector<M>(lat, lon); }
+
+    std::size_t Add(Fence&& f) {
+        fence.push_back(std::move(f));
+        dirty = true;
+        return fence.size() - 1;
+    }
+
+    /// <summary>
+    /// Index of the fence caps (GeodesyCapGrid, as GeodesyPolygon::Set);
+    /// caps are padded for Vincenty by the largest difference of geodetic
+    /// and geocentric latitude (BoundVector)
+    /// </summary>
+    void Prepare() {
+        if (!dirty) return;
+        dirty = false;
+        const T pad = (P::boundF == 0) ? T(0) : T(2 * P::boundF);
+        grid.Build(fence.size(), [&](std::size_t k, Vec3& center) {
+            const Fence& f = fence[k];
+            if (!(f.capAngle + pad < std::numbers::pi_v<T> / 2)) return std::numeric_limits<T>::infinity();
+            center = f.center;
+            return std::sqrt(K::Chord2Of(f.capAngle + pad)) * T(1 + 1e-9);
+        });
+    }
+
+    // where the position is relative to fence k, given the object's state
+    Zone Classify(const Fence& f, const Vec3& p, T lat, T lon, bool member) const {
+        if (!f.polygon) {
+            if constexpr (P::boundF == 0) {
+                T c2 = K::Chord2(p, f.center);
+                if (c2 <= f.chordIn) return Zone::In;
+                return (c2 > f.chordOut) ? Zone::Out : Zone::Keep;
+            }
+            else {
+                // chord lower bound first (GeodesyPolicy::LowerBound)
+                T lb = GeodesyPolicy::LowerBound<P>(GeodesyPolicy::BoundVector<P>(lat, lon), f.bound);
+                if (lb > f.radius + margin) return Zone::Out;
+                T d = P::Distance(lat, lon, f.lat, f.lon);
+                if (d < 0) return Zone::Keep;
+                if (d <= f.radius - margin) return Zone::In;
+                return (d > f.radius + margin) ? Zone::Out : Zone::Keep;
+            }
+        }
+        const bool in = f.shape.Contains(p);
+        if (in == member) return Zone::Keep;
+        if (!f.boundary) return in ? Zone::In : Zone::Out;
+        T d = f.boundary->Distance(lat, lon).distance;
+        if (d < 0 || d < margin) return Zone::Keep;
+        return in ? Zone::In : Zone::Out;
+    }
+
+    /// <summary>
+    /// One update: the candidate fences (GeodesyCapGrid, ascending) merged
+    /// with the object's fences (ascending); fences of the object that are
+    /// not candidates are left (the position is outside their grown caps).
+    /// The object's state is created on its first Enter and erased when it
+    /// is in no fence.
+    /// </summary>
+    template<class F>
+    void Apply(Shard& map, std::uint64_t id, double t, T lat, T lon, Scratch& s, F&& event) const {
+        const Vec3 p = Unit(lat, lon);
+        const auto it = map.find(id);
+        const Object none;
+        const Object& obj = (it != map.end()) ? it->second : none;
+
+        Object& next = s.next;
+        next.clear();
+        std::size_t m = 0;
+        auto leave = [&](const Member& x) { event(Event{ id, x.fence, Type::Exit, t }); };
+        auto stay = [&](Member x) {
+            if (dwell > 0 && !x.dwelt && t - x.since >= dwell) {
+                x.dwelt = true;
+                event(Event{ id, x.fence, Type::Dwell, t });
+            }
+            next.push_back(x);
+        };
+        grid.Candidates(p, [&](std::size_t c) {
+            const std::uint32_t k = static_cast<std::uint32_t>(c);
+            for (; m < obj.size() && obj[m].fence < k; ++m) leave(obj[m]);
+            const bool member = m < obj.size() && obj[m].fence == k;
+            Zone z = Classify(fence[k], p, lat, lon, member);
+            if (member) {
+                if (z == Zone::Out) leave(obj[m]);
+                else stay(obj[m]);
+                ++m;
+            }
+            else if (z == Zone::In) {
+                event(Event{ id, k, Type::Enter, t });
+                stay(Member{ k, t, false });
+            }
+        });
+        for (; m < obj.size(); ++m) leave(obj[m]);
+        if (next.empty()) { if (it != map.end()) map.erase(it); }
+        else if (it != map.end()) it->second.assign(next.begin(), next.end());
+        else map.emplace(id, next);
+    }
+};
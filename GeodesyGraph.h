@@ -0,0 +1,94 @@
+﻿/**********************************************************************************
+Module        : GeodesyGraph.h | Header File | C++
+Description   : Geodesic edge lengths of graphs in CSR (compressed sparse row) form
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+
+/// <summary>
+/// Class GeodesyGraph computes geodesic quantities of graphs (e.g. road
+/// networks) stored in CSR form: node u (0 <= u < nodes) has the edges
+/// e = offsets[u] .. offsets[u+1]-1 to the nodes targets[e]; node
+/// coordinates are the SoA arrays lat[], lon[] (decimal degrees).
+/// Template parameters: P, a GeodesyPolicy method (e.g.
+/// GeodesyPolicy::Haversine<GeodesyPolicy::Meters>); T, the precision;
+/// I and J, the integer types of offsets and targets (e.g. 64-bit
+/// offsets and 32-bit targets for graphs with more than 2^32 edges).
+/// </summary>
+class GeodesyGraph {
+
+public:
+    template<class T>
+    using Point = GeodesyPolicy::Point<T>;
+
+    /// <summary>
+    /// Prepared points of all nodes (trigonometry evaluated once per node)
+    /// </summary>
+    template<class P, class T>
+    static std::vector<Point<T>> Points(const T* lat, const T* lon, std::size_t nodes) {
+        std::vector<Point<T>> pts(nodes);
+        Point<T>* out = pts.data();
+        GeodesyParallel::For(nodes, [=](std::size_t lo, std::size_t hi) {
+            for (std::size_t u = lo; u < hi; ++u) out[u] = P::Prepare(lat[u], lon[u]);
+        }, GeodesyParallel::grain / P::cost);
+        return pts;
+    }
+
+    /// <summary>
+    /// Length of every edge: length[e] = distance between node u and node
+    /// targets[e] for offsets[u] <= e < offsets[u+1], in P::Units; -1 for
+    /// failed edges (Vincenty non-convergence). The per-node trigonometry
+    /// is evaluated once per node, so each edge costs only the pairwise
+    /// part of the method (Haversine: two sin, one sqrt, one asin instead
+    /// of four sin/cos more; Vincenty: no atan/tan of the reduced
+    /// latitudes). Edges, not nodes, are split evenly over the worker
+    /// threads, so skewed degree distributions stay balanced.
+    /// </summary>
+    /// <param name="length">T*: output array indexed like targets</param>
+    template<class P, class T, class I, class J>
+    static void EdgeLengths(const T* lat, const T* lon, std::size_t nodes,
+                            const I* offsets, const J* targets,
+                            T* length) {
+        std::vector<Point<T>> pts = Points<P>(lat, lon, nodes);
+        EdgeLengths<P>(pts.data(), nodes, offsets, targets, length);
+    }
+
+    /// <summary>
+    /// Edge lengths from the prepared node points (see Points), e.g. to
+    /// reuse them over several rebuilds of the edge set
+    /// </summary>
+    template<class P, class T, class I, class J>
+    static void EdgeLengths(const Point<T>* pts, std::size_t nodes,
+                            const I* offsets, const J* targets,
+                            T* length) {
+        if (nodes == 0) return;
+        const std::size_t first = static_cast<std::size_t>(offsets[0]);
+        const std::size_t edges = static_cast<std::size_t>(offsets[nodes]) - first;
+
+        GeodesyParallel::For(edges, [=](std::size_t lo, std::size_t hi) {
+            // source node of the first edge of the range, then walk forward
+            std::size_t e = first + lo;
+            std::size_t u = static_cast<std::size_t>(
+                std::upper_bound(offsets, offsets + nodes + 1, static_cast<I>(e)) - offsets) - 1;
+            for (; e < first + hi; ++e) {
+                while (static_cast<std::size_t>(offsets[u + 1]) <= e) ++u;
+                length[e] = P::Distance(pts[u], pts[static_cast<std::size_t>(targets[e])]);
+            }
+        }, GeodesyParallel::grain / P::cost);
+    }
+};
@@ -0,0 +1,324 @@
+﻿/**********************************************************************************
+Module        : GeodesyIndex.h | Header File | C++
+Description   : Grid spatial index of geo-points for radius and nearest queries
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <utility>
+#include <vector>
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+
+/// <summary>
+/// Class GeodesyIndex is a uniform grid over the unit vectors of a point
+/// set (Earth-centered cubes of edge h), so that queries have no special
+/// cases at the poles or the antimeridian. Distances are compared in
+/// chord space: for the spherical methods of policy P the chord between
+/// unit vectors is monotone in the distance, so radius and nearest
+/// queries are exact (up to rounding) without inverse trigonometry; for
+/// Vincenty the chord bound (GeodesyPolicy::LowerBound) selects a
+/// superset that Within refines with P::Distance.
+/// Points are stored in cell order (ids map back to the input index).
+/// </summary>
+template<class P, class T = double>
+class GeodesyIndex {
+
+public:
+    using Vec3 = GeodesyPolicy::Vec3<T>;
+    using Id = std::uint32_t;
+    static constexpr Id none = std::numeric_limits<Id>::max();
+
+    /// <summary>
+    /// Build the index of n points (decimal degrees).
+    /// </summary>
+    /// <param name="cell">T: cell size in P::Units; 0 selects ~4 points per occupied cell</param>
+    GeodesyIndex(const T* lat, const T* lon, std::size_t n, T cell = 0)
+        : lat(lat), lon(lon), vec(n), id(n) {
+        std::vector<Vec3> v(n);
+        Vec3* out = v.data();
+        GeodesyParallel::For(n, [=](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i)
+                out[i] = GeodesyPolicy::BoundVector<P>(lat[i], lon[i]);
+        });
+
+        h = (cell > 0) ? Chord(cell) : AutoCell(v);
+        h = std::max(h, T(1e-6)); // 2/h cells per axis must fit in 21 bits
+
+        // sort the points by cell key
+        std::vector<std::pair<std::uint64_t, Id>> key(n);
+        GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i) key[i] = { Key(Cell(v[i])), static_cast<Id>(i) };
+        });
+        std::sort(key.begin(), key.end());
+        for (std::size_t i = 0; i < n; ++i) {
+            id[i] = key[i].second;
+            vec[i] = v[key[i].second];
+            if (i == 0 || key[i].first != key[i - 1].first) {
+                cellKey.push_back(key[i].first);
+                cellStart.push_back(static_cast<Id>(i));
+            }
+        }
+        cellStart.push_back(static_cast<Id>(n));
+        BuildTable();
+    }
+
+    std::size_t Size() const { return vec.size(); }
+    std::size_t Cells() const { return cellKey.size(); }
+
+    // unit vector and input index of the k-th stored point
+    const Vec3& Vector(std::size_t k) const { return vec[k]; }
+    Id Original(std::size_t k) const { return id[k]; }
+
+    Vec3 Unit(T la, T lo) const { return GeodesyPolicy::BoundVector<P>(la, lo); }
+
+    /// <summary>
+    /// Chord length between unit vectors bounding distance d (P::Units):
+    /// points within d have chord <= Chord(d) (equivalent on the sphere)
+    /// </summary>
+    static T Chord(T d) {
+        T σ = d / T(P::boundR * P::Units::perKm);
+        return σ >= std::numbers::pi_v<T> ? T(2) : 2 * std::sin(σ / 2);
+    }
+
+    /// <summary>
+    /// Inverse of Chord: distance (P::Units) subtending chord c
+    /// </summary>
+    static T FromChord(T c) {
+        return 2 * std::asin(std::clamp(c / 2, T(0), T(1))) * T(P::boundR * P::Units::perKm);
+    }
+
+    static T Chord2(const Vec3& a, const Vec3& b) { return GeodesyKernels::Chord2(a, b); }
+
+    // cell edge (chord units); stored points of cell ci: Begin(ci) .. End(ci)-1
+    T Edge() const { return h; }
+    Id Begin(std::size_t ci) const { return cellStart[ci]; }
+    Id End(std::size_t ci) const { return cellStart[ci + 1]; }
+
+    /// <summary>
+    /// Occupied cells (ci included) that can hold a point within chord c
+    /// of a point of cell ci, in ascending order
+    /// </summary>
+    void NearCells(std::size_t ci, T c, std::vector<std::size_t>& out) const {
+        out.clear();
+        const auto cc = Unpack(cellKey[ci]);
+        const std::int64_t r = static_cast<std::int64_t>(std::floor(c / h)) + 1;
+        const T c2 = c * c;
+        auto gap = [&](std::int64_t d) { T g = T(std::max<std::int64_t>(std::abs(d) - 1, 0)) * h; return g * g; };
+        // squared distance range from the origin over [i·h - 1, (i+1)·h - 1]
+        auto span = [&](std::int64_t i, T& lo2, T& hi2) {
+            T a = T(i) * h - 1, b = a + h;
+            lo2 = (a <= 0 && b >= 0) ? T(0) : std::min(a * a, b * b);
+            hi2 = std::max(a * a, b * b);
+        };
+        for (std::int64_t x = -r; x <= r; ++x)
+            for (std::int64_t y = -r; y <= r; ++y) {
+                if (gap(x) + gap(y) > c2) continue;
+                T xl, xh, yl, yh;
+                span(cc[0] + x, xl, xh);
+                span(cc[1] + y, yl, yh);
+                for (std::int64_t z = -r; z <= r; ++z) {
+                    if (gap(x) + gap(y) + gap(z) > c2) continue;
+                    // skip cells that do not cross the unit sphere
+                    T zl, zh;
+                    span(cc[2] + z, zl, zh);
+                    if (xl + yl + zl > 1 + T(1e-9) || xh + yh + zh < 1 - T(1e-9)) continue;
+                    std::size_t cj = Find(Key({ cc[0] + x, cc[1] + y, cc[2] + z }));
+                    if (cj != npos) out.push_back(cj);
+                }
+            }
+        std::sort(out.begin(), out.end());
+    }
+
+    /// <summary>
+    /// Call fn(k, c2) for every stored point k whose squared chord to q is
+    /// at most c * c (c2 = squared chord); no square roots or trigonometry.
+    /// </summary>
+    template<class F>
+    void Chordal(const Vec3& q, T c, F&& fn) const {
+        const T c2 = c * c;
+        auto scan = [&](std::size_t ci) {
+            for (Id k = cellStart[ci]; k < cellStart[ci + 1]; ++k) {
+                T d2 = Chord2(q, vec[k]);
+                if (d2 <= c2) fn(static_cast<std::size_t>(k), d2);
+            }
+        };
+        auto lo = Cell({ q.x - c, q.y - c, q.z - c }), hi = Cell({ q.x + c, q.y + c, q.z + c });
+        double cube = double(hi[0] - lo[0] + 1) * (hi[1] - lo[1] + 1) * (hi[2] - lo[2] + 1);
+        if (cube > double(Cells())) {
+            // large radius: visit the occupied cells instead of the cube
+            for (std::size_t ci = 0; ci < Cells(); ++ci) {
+                auto cc = Unpack(cellKey[ci]);
+                if (cc[0] >= lo[0] && cc[0] <= hi[0] && cc[1] >= lo[1] && cc[1] <= hi[1] &&
+                    cc[2] >= lo[2] && cc[2] <= hi[2]) scan(ci);
+            }
+            return;
+        }
+        for (std::int64_t x = lo[0]; x <= hi[0]; ++x)
+            for (std::int64_t y = lo[1]; y <= hi[1]; ++y)
+                for (std::int64_t z = lo[2]; z <= hi[2]; ++z) {
+                    std::size_t ci = Find(Key({ x, y, z }));
+                    if (ci != npos) scan(ci);
+                }
+    }
+
+    /// <summary>
+    /// Call fn(i) for every input point i within distance r (P::Units) of
+    /// (la, lo); Vincenty candidates are confirmed with P::Distance.
+    /// </summary>
+    template<class F>
+    void Within(T la, T lo, T r, F&& fn) const {
+        Chordal(Unit(la, lo), Chord(r), [&](std::size_t k, T) {
+            Id i = id[k];
+            if (P::boundF == 0) fn(i);
+            else {
+                T d = P::Distance(la, lo, lat[i], lon[i]);
+                if (d >= 0 && d <= r) fn(i);
+            }
+        });
+    }
+
+    /// <summary>
+    /// Up to k nearest stored points to q by central angle (the distance
+    /// order of the spherical methods), nearest first, as (squared chord,
+    /// stored index) pairs; stored index skip is excluded. Cells are
+    /// visited in shells of growing size around q, keeping the k best in
+    /// a bounded max-heap, until no unvisited cell can hold a closer point.
+    /// </summary>
+    std::vector<std::pair<T, Id>> Nearest(const Vec3& q, std::size_t k, Id skip = none) const {
+        std::vector<std::pair<T, Id>> best;
+        if (k == 0) return best;
+        best.reserve(k + 1);
+        auto offer = [&](T d2, Id s) {
+            if (s == skip) return;
+            if (best.size() < k) { best.emplace_back(d2, s); std::push_heap(best.begin(), best.end()); }
+            else if (d2 < best.front().first) {
+                std::pop_heap(best.begin(), best.end());
+                best.back() = { d2, s };
+                std::push_heap(best.begin(), best.end());
+            }
+        };
+        std::size_t scanned = 0;
+        auto scan = [&](std::size_t ci) {
+            for (Id s = cellStart[ci]; s < cellStart[ci + 1]; ++s) offer(Chord2(q, vec[s]), s);
+            scanned += cellStart[ci + 1] - cellStart[ci];
+        };
+
+        const auto c = Cell(q);
+        std::size_t visited = 0;
+        for (std::int64_t r = 0;; ++r) {
+            // shell r: cells at Chebyshev distance r from q's cell
+            std::size_t shell = (r == 0) ? 1 : std::size_t((2 * r + 1) * (2 * r + 1) * (2 * r + 1) -
+                                                           (2 * r - 1) * (2 * r - 1) * (2 * r - 1));
+            if (visited + shell > 4 * Cells() + 64) {
+                // sparse surroundings: finish with a scan of all cells
+                best.clear();
+                for (std::size_t ci = 0; ci < Cells(); ++ci) scan(ci);
+                break;
+            }
+            visited += shell;
+            for (std::int64_t x = c[0] - r; x <= c[0] + r; ++x)
+                for (std::int64_t y = c[1] - r; y <= c[1] + r; ++y) {
+                    bool face = (x == c[0] - r || x == c[0] + r || y == c[1] - r || y == c[1] + r);
+                    for (std::int64_t z = c[2] - r; z <= c[2] + r; z += (face ? 1 : 2 * std::max<std::int64_t>(r, 1))) {
+                        std::size_t ci = Find(Key({ x, y, z }));
+                        if (ci != npos) scan(ci);
+                    }
+                }
+            // every unvisited point is more than r·h away from q
+            T reach = T(r) * h;
+            if (best.size() == k && best.front().first <= reach * reach) break;
+            if (scanned == Size()) break;
+        }
+        std::sort_heap(best.begin(), best.end());
+        return best;
+    }
+
+private:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    const T* lat;
+    const T* lon;
+    T h = 1;                         // cell edge (chord units)
+    std::vector<Vec3> vec;           // unit vectors in cell order
+    std::vector<Id> id;              // input index of each stored point
+    std::vector<std::uint64_t> cellKey;
+    std::vector<Id> cellStart;       // points of cell c: cellStart[c] .. cellStart[c+1]-1
+    std::vector<std::uint64_t> slotKey; // open-addressing table: key -> cell
+    std::vector<Id> slotCell;
+
+    std::array<std::int64_t, 3> Cell(const Vec3& v) const {
+        auto f = [&](T x) { return static_cast<std::int64_t>(std::floor((std::clamp(x, T(-1), T(1)) + 1) / h)); };
+        return { f(v.x), f(v.y), f(v.z) };
+    }
+
+    // 21 bits per axis; out-of-range cells map to an unused key
+    static std::uint64_t Key(const std::array<std::int64_t, 3>& c) {
+        constexpr std::int64_t m = (1 << 21) - 1;
+        if (c[0] < 0 || c[1] < 0 || c[2] < 0 || c[0] > m || c[1] > m || c[2] > m)
+            return ~std::uint64_t{ 0 };
+        return (std::uint64_t(c[0]) << 42) | (std::uint64_t(c[1]) << 21) | std::uint64_t(c[2]);
+    }
+
+    static std::array<std::int64_t, 3> Unpack(std::uint64_t k) {
+        constexpr std::uint64_t m = (1 << 21) - 1;
+        return { std::int64_t(k >> 42), std::int64_t((k >> 21) & m), std::int64_t(k & m) };
+    }
+
+    static std::uint64_t Hash(std::uint64_t k) {
+        k ^= k >> 33; k *= 0xff51afd7ed558ccdull; k ^= k >> 33;
+        return k;
+    }
+
+    void BuildTable() {
+        std::size_t size = 16;
+        while (size < 2 * Cells()) size *= 2;
+        slotKey.assign(size, ~std::uint64_t{ 0 });
+        slotCell.assign(size, 0);
+        for (std::size_t c = 0; c < Cells(); ++c) {
+            std::size_t s = Hash(cellKey[c]) & (size - 1);
+            while (slotKey[s] != ~std::uint64_t{ 0 }) s = (s + 1) & (size - 1);
+            slotKey[s] = cellKey[c];
+            slotCell[s] = static_cast<Id>(c);
+        }
+    }
+
+    std::size_t Find(std::uint64_t k) const {
+        if (k == ~std::uint64_t{ 0 }) return npos;
+        const std::size_t mask = slotKey.size() - 1;
+        for (std::size_t s = Hash(k) & mask;; s = (s + 1) & mask) {
+            if (slotKey[s] == k) return slotCell[s];
+            if (slotKey[s] == ~std::uint64_t{ 0 }) return npos;
+        }
+    }
+
+    // cell edge for ~4 points per occupied cell, from the area spanned
+    // by the points (their bounding box seen from its thinnest axis)
+    static T AutoCell(const std::vector<Vec3>& v) {
+        if (v.empty()) return 1;
+        Vec3 lo = v[0], hi = v[0];
+        for (const Vec3& p : v) {
+            lo = { std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z) };
+            hi = { std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z) };
+        }
+        T ex = hi.x - lo.x, ey = hi.y - lo.y, ez = hi.z - lo.z;
+        T area = std::max({ ex * ey, ey * ez, ex * ez });
+        return std::sqrt(std::max(area, T(1e-12)) * 4 / T(v.size()));
+    }
+};
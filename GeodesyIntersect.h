@@ -0,0 +1,412 @@
+﻿/**********************************************************************************
+Module        : GeodesyIntersect.h | Header File | C++
+Description   : Great-circle intersections and closest point of approach
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+
+/// <summary>
+/// Class GeodesyIntersect locates crossings of great-circle paths, for
+/// conflict detection, with n-vector geometry: a path A -> B is its unit
+/// vectors and the pole N = A x B / |A x B| of its great circle.
+///   GreatCircles: the two (antipodal) crossings of two great circles,
+///   N1 x N2 and its opposite;
+///   Segments: the crossing of two segments, if any;
+///   SmallCircle: where a segment enters and leaves a circle of given
+///   radius around a point (p . C = cos r on the path, one atan2 and one
+///   acos per path);
+///   ClosestApproach: time and separation of the closest approach of two
+///   objects moving along great circles at constant speed.
+/// Template parameter P, a GeodesyPolicy method: the geometry is that of
+/// the sphere of radius E::R (geodetic latitude as spherical latitude);
+/// Vincenty measures the separation at closest approach with P::Distance.
+/// Distances and the circle radius are in P::Units; speeds in P::Units
+/// per unit of time, times in that unit. Failures return -1 (count 0).
+/// </summary>
+class GeodesyIntersect {
+
+public:
+    /// <summary>
+    /// Up to two crossings, in order along the (first) path, with their
+    /// distance from its start
+    /// </summary>
+    template<class T>
+    struct Points {
+        int count = 0;
+        T lat[2]{}, lon[2]{};
+        T along[2]{};
+    };
+
+    /// <summary>
+    /// Object moving along a great circle: position (decimal degrees),
+    /// initial bearing (degrees clockwise from North), speed
+    /// </summary>
+    template<class T>
+    struct Motion {
+        T lat, lon, bearing, speed;
+    };
+
+    template<class T>
+    struct Approach {
+        T time = -1;                      // of the closest approach, 0 .. horizon
+        T distance = -1;                  // separation then
+        T lat1 = 0, lon1 = 0, lat2 = 0, lon2 = 0; // positions then
+    };
+
+    /// <summary>
+    /// Crossings of the great circles through (lat1, lon1), (lat2, lon2)
+    /// and (lat3, lon3), (lat4, lon4): the first one met going from the
+    /// first point towards the second, then its antipode; none if either
+    /// circle is undefined or the circles coincide
+    /// </summary>
+    template<class P, class T>
+    static Points<T> GreatCircles(T lat1, T lon1, T lat2, T lon2,
+                                  T lat3, T lon3, T lat4, T lon4) {
+        Points<T> r;
+        const Path<P, T> s(lat1, lon1, lat2, lon2), u(lat3, lon3, lat4, lon4);
+        Vec3<T> x;
+        if (!Crossing(s, u, x)) return r;
+        T α = s.Angle(x);
+        if (α >= std::numbers::pi_v<T>) { x = Neg(x); α -= std::numbers::pi_v<T>; }
+        r.count = 2;
+        Put(r, 0, x, α * Scale<P, T>());
+        Put(r, 1, Neg(x), (α + std::numbers::pi_v<T>) * Scale<P, T>());
+        return r;
+    }
+
+    /// <summary>
+    /// Crossing of the segments (lat1, lon1) -> (lat2, lon2) and
+    /// (lat3, lon3) -> (lat4, lon4), minor arcs, end points included
+    /// </summary>
+    template<class P, class T>
+    static Points<T> Segments(T lat1, T lon1, T lat2, T lon2,
+                              T lat3, T lon3, T lat4, T lon4) {
+        const Path<P, T> s(lat1, lon1, lat2, lon2);
+        return Segments(s, Path<P, T>(lat3, lon3, lat4, lon4));
+    }
+
+    /// <summary>
+    /// Crossings of the segment (lat1, lon1) -> (lat2, lon2) with the
+    /// circle of radius r around (clat, clon): where it enters the circle
+    /// first, then where it leaves; only those within the segment
+    /// </summary>
+    template<class P, class T>
+    static Points<T> SmallCircle(T lat1, T lon1, T lat2, T lon2, T clat, T clon, T radius) {
+        const Path<P, T> s(lat1, lon1, lat2, lon2);
+        return SmallCircle(s, Circle<P, T>(clat, clon, radius));
+    }
+
+    template<class P, class T>
+    static Approach<T> ClosestApproach(const Motion<T>& m1, const Motion<T>& m2, T horizon) {
+        return ClosestApproach<P>(Mover<P, T>(m1), Mover<P, T>(m2), horizon);
+    }
+
+    // Batch: one path or object vs. many ***********************************************
+    /// <summary>
+    /// Crossing of segment (lat1, lon1) -> (lat2, lon2) with each segment
+    /// i of the arrays a/b: hit[i] = 1 and the crossing in lat[i], lon[i]
+    /// if they cross, else hit[i] = 0
+    /// </summary>
+    template<class P, class T>
+    static void Segments(T lat1, T lon1, T lat2, T lon2,
+                         const T* alat, const T* alon, const T* blat, const T* blon, std::size_t n,
+                         T* lat, T* lon, std::uint8_t* hit) {
+        const Path<P, T> s(lat1, lon1, lat2, lon2);
+        GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i) {
+                Points<T> r = Segments(s, Path<P, T>(alat[i], alon[i], blat[i], blon[i]));
+                hit[i] = static_cast<std::uint8_t>(r.count);
+                lat[i] = r.lat[0];
+                lon[i] = r.lon[0];
+            }
+        }, GeodesyParallel::grain / 4);
+    }
+
+    /// <summary>
+    /// Segments i (lat1[i], lon1[i]) -> (lat2[i], lon2[i]) against one
+    /// circle: enter[i] and exit[i] are the distances along the segment
+    /// where it enters and leaves the circle, -1 where it does not
+    /// (within the segment)
+    /// </summary>
+    template<class P, class T>
+    static void SmallCircle(const T* lat1, const T* lon1, const T* lat2, const T* lon2, std::size_t n,
+                            T clat, T clon, T radius, T* enter, T* exit) {
+        const Circle<P, T> c(clat, clon, radius);
+        GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i) {
+                const Path<P, T> s(lat1[i], lon1[i], lat2[i], lon2[i]);
+                T θ[2];
+                Side side[2];
+                int k = c.Cross(s, θ, side);
+                enter[i] = exit[i] = -1;
+                for (int j = 0; j < k; ++j) (side[j] == Side::enter ? enter[i] : exit[i]) = θ[j] * Scale<P, T>();
+            }
+        }, GeodesyParallel::grain / 4);
+    }
+
+    /// <summary>
+    /// Closest approach of object own to each object i of the arrays
+    /// (lat, lon, bearing, speed) within the horizon: time[i], distance[i]
+    /// </summary>
+    template<class P, class T>
+    static void ClosestApproach(const Motion<T>& own,
+                                const T* lat, const T* lon, const T* bearing, const T* speed, std::size_t n,
+                                T horizon, T* time, T* distance) {
+        const Mover<P, T> m1(own);
+        GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i) {
+                Approach<T> r = ClosestApproach<P>(m1, Mover<P, T>(Motion<T>{ lat[i], lon[i], bearing[i], speed[i] }), horizon);
+                time[i] = r.time;
+                distance[i] = r.distance;
+            }
+        }, GeodesyParallel::grain / 16);
+    }
+
+private:
+    template<class T>
+    using Vec3 = GeodesyPolicy::Vec3<T>;
+    using K = GeodesyKernels;
+
+    template<class T>
+    static Vec3<T> Neg(const Vec3<T>& a) { return { -a.x, -a.y, -a.z }; }
+
+    template<class T>
+    static Vec3<T> Combine(const Vec3<T>& a, T s, const Vec3<T>& b, T t) {
+        return { a.x * s + b.x * t, a.y * s + b.y * t, a.z * s + b.z * t };
+    }
+
+    // radius (km) times units: distance per radian on the sphere
+    template<class P, class T>
+    static T Scale() { return T(P::Ellipsoid::R * P::Units::perKm); }
+
+    template<class T>
+    static T Lat(const Vec3<T>& v) {
+        return std::atan2(v.z, std::sqrt(v.x * v.x + v.y * v.y)) / GeodesyKernels::toRad<T>;
+    }
+
+    template<class T>
+    static T Lon(const Vec3<T>& v) { return std::atan2(v.y, v.x) / GeodesyKernels::toRad<T>; }
+
+    template<class T>
+    static void Put(Points<T>& r, int k, const Vec3<T>& x, T α) {
+        r.lat[k] = Lat(x);
+        r.lon[k] = Lon(x);
+        r.along[k] = α;
+    }
+
+    /// <summary>
+    /// Path A -> B: unit pole N and the unit tangent U = N x A at A, so
+    /// the circle is A cos θ + U sin θ, θ the angle travelled from A
+    /// </summary>
+    template<class P, class T>
+    struct Path {
+        using M = typename P::Math;
+        Vec3<T> a{}, b{}, n{}, u{};
+        T length = 0;                   // angle A -> B, rad
+        bool valid = false;             // A != ±B
+
+        Path(T lat1, T lon1, T lat2, T lon2)
+            : a(GeodesyKernels::UnitVector<M>(lat1, lon1)), b(GeodesyKernels::UnitVector<M>(lat2, lon2)) {
+            Vec3<T> c = K::Cross(a, b);
+            T s = M::Sqrt(K::Dot(c, c));
+            valid = s > 0;
+            if (!valid) return;
+            n = { c.x / s, c.y / s, c.z / s };
+            u = K::Cross(n, a);
+            length = M::Atan2(s, K::Dot(a, b));
+        }
+
+        // angle from A to x on the circle, 0 .. 2π
+        T Angle(const Vec3<T>& x) const {
+            T α = M::Atan2(K::Dot(x, u), K::Dot(x, a));
+            return (α < 0) ? α + 2 * std::numbers::pi_v<T> : α;
+        }
+
+        Vec3<T> At(T θ) const { return Combine(a, M::Cos(θ), u, M::Sin(θ)); }
+    };
+
+    // crossing direction N1 x N2 of two circles; false if undefined
+    template<class P, class T>
+    static bool Crossing(const Path<P, T>& s, const Path<P, T>& t, Vec3<T>& x) {
+        if (!s.valid || !t.valid) return false;
+        Vec3<T> c = K::Cross(s.n, t.n);
+        T l = std::sqrt(K::Dot(c, c));
+        if (!(l > 1e-15)) return false;
+        x = { c.x / l, c.y / l, c.z / l };
+        return true;
+    }
+
+    template<class P, class T>
+    static Points<T> Segments(const Path<P, T>& s, const Path<P, T>& t) {
+        Points<T> r;
+        Vec3<T> x;
+        if (!Crossing(s, t, x)) return r;
+        // of ±x, the one within both segments (end points with a tolerance;
+        // an angle just short of 2π is at the start)
+        constexpr T tol = T(1e-12);
+        auto within = [](T α, T length) { return α <= length + tol || α >= 2 * std::numbers::pi_v<T> - tol; };
+        for (int k = 0; k < 2; ++k, x = Neg(x)) {
+            T α = s.Angle(x);
+            if (!within(α, s.length) || !within(t.Angle(x), t.length)) continue;
+            r.count = 1;
+            Put(r, 0, x, (α > s.length + tol ? T(0) : std::min(α, s.length)) * Scale<P, T>());
+            break;
+        }
+        return r;
+    }
+
+    enum class Side : std::uint8_t { enter, exit };
+
+    /// <summary>
+    /// Small circle p . C = cos(r / R): on a path A cos θ + U sin θ it is
+    /// (A.C) cos θ + (U.C) sin θ = ρ cos(θ - θ0) = cos(r / R), so the
+    /// crossings are θ0 -+ δ, δ = acos(cos(r / R) / ρ): entering first
+    /// </summary>
+    template<class P, class T>
+    struct Circle {
+        using M = typename P::Math;
+        Vec3<T> c;
+        T k;
+
+        Circle(T lat, T lon, T radius)
+            : c(GeodesyKernels::UnitVector<M>(lat, lon)),
+              k(radius >= 0 ? M::Cos(std::min(radius / Scale<P, T>(), std::numbers::pi_v<T>)) : T(2)) {}
+
+        // crossings within the segment, by angle from A
+        int Cross(const Path<P, T>& s, T* θ, Side* side) const {
+            if (!s.valid) return 0;
+            T x = K::Dot(s.a, c), y = K::Dot(s.u, c), ρ = M::Sqrt(x * x + y * y);
+            if (!(ρ > std::fabs(k))) return 0;
+            T θ0 = M::Atan2(y, x), δ = M::Acos(k / ρ);
+            int count = 0;
+            for (int j = 0; j < 2; ++j) {
+                T t = std::remainder(j ? θ0 + δ : θ0 - δ, 2 * std::numbers::pi_v<T>);
+                if (t < 0) t += 2 * std::numbers::pi_v<T>;
+                if (t > s.length) continue;
+                θ[count] = t;
+                side[count++] = j ? Side::exit : Side::enter;
+            }
+            if (count == 2 && θ[1] < θ[0]) { std::swap(θ[0], θ[1]); std::swap(side[0], side[1]); }
+            return count;
+        }
+    };
+
+    template<class P, class T>
+    static Points<T> SmallCircle(const Path<P, T>& s, const Circle<P, T>& c) {
+        Points<T> r;
+        T θ[2];
+        Side side[2];
+        r.count = c.Cross(s, θ, side);
+        for (int j = 0; j < r.count; ++j) Put(r, j, s.At(θ[j]), θ[j] * Scale<P, T>());
+        return r;
+    }
+
+    /// <summary>
+    /// Constant-speed great-circle motion p(t) = A cos ωt + E sin ωt, E the
+    /// unit direction of the initial bearing, ω the angular speed
+    /// </summary>
+    template<class P, class T>
+    struct Mover {
+        using M = typename P::Math;
+        Vec3<T> a{}, e{};
+        T ω = 0;
+        bool valid = false;
+
+        explicit Mover(const Motion<T>& m) {
+            T φ = m.lat * GeodesyKernels::toRad<T>, λ = m.lon * GeodesyKernels::toRad<T>;
+            T θ = m.bearing * GeodesyKernels::toRad<T>;
+            T sφ = M::Sin(φ), cφ = M::Cos(φ), sλ = M::Sin(λ), cλ = M::Cos(λ);
+            a = { cφ * cλ, cφ * sλ, sφ };
+            Vec3<T> north{ -sφ * cλ, -sφ * sλ, cφ }, east{ -sλ, cλ, 0 };
+            e = Combine(north, M::Cos(θ), east, M::Sin(θ));
+            ω = m.speed / Scale<P, T>();
+            valid = (m.speed >= 0) && std::isfinite(ω) && std::isfinite(m.bearing);
+        }
+
+        Vec3<T> At(T t) const { return Combine(a, M::Cos(ω * t), e, M::Sin(ω * t)); }
+        // derivative: ω (E cos ωt - A sin ωt)
+        Vec3<T> Velocity(T t) const { return Combine(e, ω * M::Cos(ω * t), a, -ω * M::Sin(ω * t)); }
+    };
+
+    /// <summary>
+    /// Closest approach: the maximum of f(t) = p1(t) . p2(t) on
+    /// [0, horizon]. The horizon is split into pieces over which neither
+    /// object turns more than π/8 of its circle, where f' changes sign at
+    /// most once in practice; a maximum is bracketed by f' going from + to -
+    /// and refined by safeguarded Newton steps (f'' in closed form, since
+    /// p'' = -ω² p). The end points are candidates too. The cost grows
+    /// with the turns over the horizon (16 pieces per revolution); more
+    /// pieces than a size_t counts is a failure.
+    /// </summary>
+    template<class P, class T>
+    static Approach<T> ClosestApproach(const Mover<P, T>& m1, const Mover<P, T>& m2, T horizon) {
+        Approach<T> r;
+        if (!m1.valid || !m2.valid || !(horizon >= 0) || !std::isfinite(horizon)) return r;
+
+        auto f = [&](T t) { return K::Dot(m1.At(t), m2.At(t)); };
+        auto g = [&](T t) { return K::Dot(m1.Velocity(t), m2.At(t)) + K::Dot(m1.At(t), m2.Velocity(t)); };
+        auto dg = [&](T t) {
+            Vec3<T> p1 = m1.At(t), p2 = m2.At(t);
+            return 2 * K::Dot(m1.Velocity(t), m2.Velocity(t)) - (m1.ω * m1.ω + m2.ω * m2.ω) * K::Dot(p1, p2);
+        };
+
+        T best = 0, fBest = f(0);
+        auto consider = [&](T t) {
+            T v = f(t);
+            if (v > fBest) { fBest = v; best = t; }
+        };
+        consider(horizon);
+
+        const T turn = std::max(m1.ω, m2.ω) * horizon;
+        const T count = std::ceil(turn / (std::numbers::pi_v<T> / 8)) + 1;
+        if (!(count < T(std::numeric_limits<std::size_t>::max() / 2))) return r;
+        const std::size_t pieces = static_cast<std::size_t>(count);
+        T lo = 0, gLo = g(0);
+        for (std::size_t k = 1; k <= pieces; ++k) {
+            T hi = (k == pieces) ? horizon : horizon * T(k) / T(pieces), gHi = g(hi);
+            if (gLo > 0 && gHi < 0) {
+                T a = lo, b = hi, t = (a + b) / 2;
+                for (int it = 0; it < 60 && b - a > (horizon + 1) * T(1e-15); ++it) {
+                    T v = g(t);
+                    if (v > 0) a = t; else b = t;
+                    T d = dg(t);
+                    T next = (d < 0) ? t - v / d : (a + b) / 2;
+                    if (!(next > a && next < b)) next = (a + b) / 2;
+                    if (std::fabs(next - t) <= (horizon + 1) * T(1e-15)) { t = next; break; }
+                    t = next;
+                }
+                consider(t);
+            }
+            lo = hi; gLo = gHi;
+        }
+
+        const Vec3<T> p1 = m1.At(best), p2 = m2.At(best);
+        r.time = best;
+        r.lat1 = Lat(p1); r.lon1 = Lon(p1);
+        r.lat2 = Lat(p2); r.lon2 = Lon(p2);
+        if (P::boundF == 0) {
+            Vec3<T> c = K::Cross(p1, p2);
+            r.distance = std::atan2(std::sqrt(K::Dot(c, c)), K::Dot(p1, p2)) * Scale<P, T>();
+        }
+        else r.distance = P::Distance(r.lat1, r.lon1, r.lat2, r.lon2);
+        return r;
+    }
+};
@@ -0,0 +1,339 @@
+﻿/**********************************************************************************
+Module        : GeodesyKernels.h | Header File | C++
+Description   : Inline distance kernels shared by Geodesy and the policy templates
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+/// <summary>
+/// Class GeodesyKernels contains the per-pair formulas of the Geodesy
+/// methods as inline templates, so that callers specialized at compile
+/// time (Geodesy batch methods, GeodesyPolicy) inline them into their
+/// loops. Template parameter M supplies the elementary functions
+/// (GeodesyKernels::StdMath or the fixed GeodesyMath kernels), T the
+/// floating-point type (float, double, long double) of the arguments,
+/// constants and intermediate results; the double instantiation is the
+/// one used by the Geodesy methods. GeodesyMath is double only, so it
+/// adds no precision to long double. Inputs are decimal degrees.
+/// </summary>
+class GeodesyKernels {
+
+public:
+    // degrees to radians in precision T
+    template<class T>
+    static constexpr T toRad = std::numbers::pi_v<T> / T(180);
+
+    // elementary functions of the C runtime (default mode), overloaded
+    // for float, double and long double
+    struct StdMath {
+        template<class T> static T Sin(T x) { return std::sin(x); }
+        template<class T> static T Cos(T x) { return std::cos(x); }
+        template<class T> static T Tan(T x) { return std::tan(x); }
+        template<class T> static T Atan(T x) { return std::atan(x); }
+        template<class T> static T Atan2(T y, T x) { return std::atan2(y, x); }
+        template<class T> static T Asin(T x) { return std::asin(x); }
+        template<class T> static T Acos(T x) { return std::acos(x); }
+        template<class T> static T Sqrt(T x) { return std::sqrt(x); }
+    };
+
+    // Prepared points *****************************************************************
+    /// <summary>
+    /// Geo-point with its trigonometry evaluated once, for points used in
+    /// many pairs (graph nodes, index entries): sinφ/cosφ of the latitude
+    /// (SpherePoint) or of the reduced latitude (EllipsoidPoint).
+    /// The Point overloads of the kernels return the same values as the
+    /// latitude/longitude ones.
+    /// </summary>
+    template<class T>
+    struct Point {
+        T φ;          // latitude, rad
+        T lon;        // longitude, decimal degrees
+        T sinφ, cosφ;
+    };
+
+    template<class M, class T>
+    static Point<T> SpherePoint(T lat, T lon) {
+        T φ = lat * toRad<T>;
+        return { φ, lon, M::Sin(φ), M::Cos(φ) };
+    }
+
+    template<class M, class T>
+    static Point<T> EllipsoidPoint(T lat, T lon, T f) {
+        T φ = lat * toRad<T>;
+        T U = M::Atan((1 - f) * M::Tan(φ));
+        return { φ, lon, M::Sin(U), M::Cos(U) };
+    }
+
+    // Unit vectors ********************************************************************
+    template<class T>
+    struct Vec3 { T x, y, z; };
+
+    /// <summary>
+    /// Unit vector (Earth-centered, z to the North pole) of a geo-point;
+    /// with flattening f != 0, the direction of the point on that
+    /// ellipsoid (geocentric latitude).
+    /// </summary>
+    template<class M, class T>
+    static Vec3<T> UnitVector(T lat, T lon, T f = 0) {
+        T φ = lat * toRad<T>, λ = lon * toRad<T>;
+        T sinφ = M::Sin(φ), cosφ = M::Cos(φ);
+        if (f != 0) {
+            T e = (1 - f) * (1 - f);
+            T r = M::Sqrt(e * e * sinφ * sinφ + cosφ * cosφ);
+            sinφ = e * sinφ / r;
+            cosφ = cosφ / r;
+        }
+        return { cosφ * M::Cos(λ), cosφ * M::Sin(λ), sinφ };
+    }
+
+    /// <summary>
+    /// Central angle (rad) between two unit vectors from their chord
+    /// length: 2·asin(|p - q| / 2)
+    /// </summary>
+    template<class M, class T>
+    static T ChordCA(const Vec3<T>& p, const Vec3<T>& q) {
+        T c = M::Sqrt(Chord2(p, q));
+        return 2 * M::Asin(std::min(c / 2, T(1)));
+    }
+
+    template<class T>
+    static T Dot(const Vec3<T>& a, const Vec3<T>& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+    template<class T>
+    static Vec3<T> Cross(const Vec3<T>& a, const Vec3<T>& b) {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    // squared chord |a - b|²
+    template<class T>
+    static T Chord2(const Vec3<T>& a, const Vec3<T>& b) {
+        T dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    /// <summary>
+    /// Squared chord of a central angle σ (rad): (2·sin(σ/2))², 4 from
+    /// the antipode on; compared with Chord2 instead of the angle
+    /// </summary>
+    template<class T>
+    static T Chord2Of(T σ) {
+        if (!(σ < std::numbers::pi_v<T>)) return T(4);
+        T c = 2 * std::sin(σ / 2);
+        return c * c;
+    }
+
+    /// <summary>
+    /// Haversine central angle (rad) between two geo-points
+    /// </summary>
+    template<class M, class T>
+    static T HaversineCA(T lat1, T lon1,
+                         T lat2, T lon2) {
+        T φ1 = lat1 * toRad<T>;
+        T φ2 = lat2 * toRad<T>;
+
+        T a = M::Sin((φ2 - φ1) / 2);
+        a *= a;
+
+        T b = M::Sin(((lon2 - lon1) / 2) * toRad<T>);
+        b *= b * M::Cos(φ1) * M::Cos(φ2);
+
+        return 2 * M::Asin(M::Sqrt(a + b));
+    }
+
+    template<class M, class T>
+    static T HaversineCA(const Point<T>& p, const Point<T>& q) {
+        T a = M::Sin((q.φ - p.φ) / 2);
+        a *= a;
+
+        T b = M::Sin(((q.lon - p.lon) / 2) * toRad<T>);
+        b *= b * p.cosφ * q.cosφ;
+
+        return 2 * M::Asin(M::Sqrt(a + b));
+    }
+
+    /// <summary>
+    /// Spherical Law of Cosines central angle (rad) between two geo-points
+    /// </summary>
+    template<class M, class T>
+    static T SLCCA(T lat1, T lon1,
+                   T lat2, T lon2) {
+        T φ1 = lat1 * toRad<T>;
+        T φ2 = lat2 * toRad<T>;
+        T Δλ = (lon1 - lon2) * toRad<T>;
+
+        return M::Acos(M::Sin(φ1) * M::Sin(φ2) +
+            M::Cos(φ1) * M::Cos(φ2) * M::Cos(Δλ));
+    }
+
+    template<class M, class T>
+    static T SLCCA(const Point<T>& p, const Point<T>& q) {
+        T Δλ = (p.lon - q.lon) * toRad<T>;
+
+        return M::Acos(p.sinφ * q.sinφ +
+            p.cosφ * q.cosφ * M::Cos(Δλ));
+    }
+
+    /// <summary>
+    /// Haversine central angle (rad) via 2·atan2(√h, √(1-h)), h clamped
+    /// to 1 against rounding (no NaN). As accurate as 2·asin(√h): near
+    /// antipodal points h itself carries the rounding (~3e-8 rad).
+    /// </summary>
+    template<class M, class T>
+    static T HaversineAtan2CA(T lat1, T lon1,
+                              T lat2, T lon2) {
+        T φ1 = lat1 * toRad<T>;
+        T φ2 = lat2 * toRad<T>;
+
+        T a = M::Sin((φ2 - φ1) / 2);
+        a *= a;
+
+        T b = M::Sin(((lon2 - lon1) / 2) * toRad<T>);
+        b *= b * M::Cos(φ1) * M::Cos(φ2);
+
+        T h = std::min(a + b, T(1));
+        return 2 * M::Atan2(M::Sqrt(h), M::Sqrt(1 - h));
+    }
+
+    template<class M, class T>
+    static T HaversineAtan2CA(const Point<T>& p, const Point<T>& q) {
+        T a = M::Sin((q.φ - p.φ) / 2);
+        a *= a;
+
+        T b = M::Sin(((q.lon - p.lon) / 2) * toRad<T>);
+        b *= b * p.cosφ * q.cosφ;
+
+        T h = std::min(a + b, T(1));
+        return 2 * M::Atan2(M::Sqrt(h), M::Sqrt(1 - h));
+    }
+
+    /// <summary>
+    /// Vincenty formula for the sphere: central angle (rad) as
+    /// atan2(sin σ, cos σ) of the chord components, well-conditioned from
+    /// coincident to antipodal points (~1e-16 rad).
+    /// </summary>
+    template<class M, class T>
+    static T SphericalVincentyCA(T lat1, T lon1,
+                                 T lat2, T lon2) {
+        T φ1 = lat1 * toRad<T>;
+        T φ2 = lat2 * toRad<T>;
+        T Δλ = (lon2 - lon1) * toRad<T>;
+
+        T sinφ1 = M::Sin(φ1), cosφ1 = M::Cos(φ1);
+        T sinφ2 = M::Sin(φ2), cosφ2 = M::Cos(φ2);
+        T sinΔλ = M::Sin(Δλ), cosΔλ = M::Cos(Δλ);
+
+        T y1 = cosφ2 * sinΔλ;
+        T y2 = cosφ1 * sinφ2 - sinφ1 * cosφ2 * cosΔλ;
+        T x = sinφ1 * sinφ2 + cosφ1 * cosφ2 * cosΔλ;
+
+        return M::Atan2(M::Sqrt(y1 * y1 + y2 * y2), x);
+    }
+
+    template<class M, class T>
+    static T SphericalVincentyCA(const Point<T>& p, const Point<T>& q) {
+        T Δλ = (q.lon - p.lon) * toRad<T>;
+        T sinΔλ = M::Sin(Δλ), cosΔλ = M::Cos(Δλ);
+
+        T y1 = q.cosφ * sinΔλ;
+        T y2 = p.cosφ * q.sinφ - p.sinφ * q.cosφ * cosΔλ;
+        T x = p.sinφ * q.sinφ + p.cosφ * q.cosφ * cosΔλ;
+
+        return M::Atan2(M::Sqrt(y1 * y1 + y2 * y2), x);
+    }
+
+    /// <summary>
+    /// Inverse Vincenty iteration: distance (km) on the ellipsoid with
+    /// equatorial radius a (m) and flattening f between two geo-points;
+    /// returns -1 if the iteration does not converge. The convergence
+    /// threshold on λ is 1e-12 rad, relaxed to 8 ulp(1) in float.
+    /// </summary>
+    /// <param name="iterations">int: number of iterations performed</param>
+    template<class M, class T>
+    static T VincentyKm(T lat1, T lon1,
+                        T lat2, T lon2,
+                        T a, T f,
+                        int& iterations) {
+        return VincentyKm<M>(EllipsoidPoint<M>(lat1, lon1, f),
+                             EllipsoidPoint<M>(lat2, lon2, f), a, f, iterations);
+    }
+
+    /// <summary>
+    /// Inverse Vincenty iteration between two points prepared by
+    /// EllipsoidPoint with the same flattening f
+    /// </summary>
+    template<class M, class T>
+    static T VincentyKm(const Point<T>& p, const Point<T>& q,
+                        T a, T f,
+                        int& iterations) {
+        const T b = a * (T(1.0) - f);
+
+        T Δλ = (q.lon - p.lon) * toRad<T>;
+
+        T sinU1 = p.sinφ, cosU1 = p.cosφ;
+        T sinU2 = q.sinφ, cosU2 = q.cosφ;
+
+        T λ = Δλ, λPrev;
+        int iterLimit = 100;
+        const T ε = std::max(T(1e-12), 8 * std::numeric_limits<T>::epsilon());
+
+        T sinσ, cosσ, σ, sinα, cos2α, cos2σM;
+        T u2, A, B, Δσ;
+
+        iterations = 0;
+        do {
+            ++iterations;
+            T sinλ = M::Sin(λ), cosλ = M::Cos(λ);
+            T term1 = cosU2 * sinλ;
+            T term2 = cosU1 * sinU2 - sinU1 * cosU2 * cosλ;
+
+            sinσ = M::Sqrt(term1 * term1 + term2 * term2);
+            if (sinσ == 0) return 0; // coincident points
+
+            cosσ = sinU1 * sinU2 + cosU1 * cosU2 * cosλ;
+            σ = M::Atan2(sinσ, cosσ);
+
+            sinα = (cosU1 * cosU2 * sinλ) / sinσ;
+            T sin2α = sinα * sinα;
+            cos2α = T(1.0) - sin2α;
+
+            cos2σM = (cos2α != 0) ? cosσ - (T(2.0) * sinU1 * sinU2) / cos2α : T(0.0);
+
+            u2 = (cos2α * (a * a - b * b)) / (b * b);
+
+            A = T(1.0) + (u2 / T(16384.0)) *
+                (T(4096.0) + u2 * (T(-768.0) + u2 * (T(320.0) - T(175.0) * u2)));
+            B = (u2 / T(1024.0)) * (T(256.0) + u2 * (T(-128.0) + u2 * (T(74.0) - T(47.0) * u2)));
+
+            T cos2αM2 = cos2σM * cos2σM;
+            Δσ = B * sinσ * (cos2σM + (B / T(4.0)) * (cosσ * (T(-1.0) + T(2.0) * cos2αM2) -
+                (B / T(6.0)) * cos2σM * (T(-3.0) + T(4.0) * sinσ * sinσ) *
+                (T(-3.0) + T(4.0) * cos2αM2)));
+
+            T C = (f / T(16.0)) * cos2α * (T(4.0) + f * (T(4.0) - T(3.0) * cos2α));
+
+            λPrev = λ;
+            λ = Δλ + (T(1.0) - C) * f * sinα *
+                (σ + C * sinσ * (cos2σM + C * cosσ * (T(-1.0) + T(2.0) * cos2αM2)));
+
+            if (std::fabs(λ - λPrev) < ε) break;
+        } while (--iterLimit > 0);
+
+        if (iterLimit == 0) return -1; // no convergence
+
+        return b * A * (σ - Δσ) / T(1000.0);
+    }
+};
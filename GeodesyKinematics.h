@@ -0,0 +1,216 @@
+﻿/**********************************************************************************
+Module        : GeodesyKinematics.h | Header File | C++
+Description   : Speed, acceleration, bearing and outlier flags of GPS fix streams
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+
+/// <summary>
+/// Class GeodesyKinematics derives the motion of timestamped GPS fixes
+/// (SoA arrays t[], lat[], lon[]; decimal degrees, time in any unit) in
+/// one pass, and flags fixes that break configurable limits. For fix i,
+/// from fix i-1:
+///   distance: P::Distance (P::Units), each fix prepared once (P::Prepare)
+///   and shared by its two legs;
+///   speed: distance / Δt;
+///   acceleration: change of speed over the time between leg midpoints;
+///   bearing: initial great-circle bearing of the leg, degrees [0, 360);
+///   turn rate: change of bearing over the same time, degrees per unit.
+/// Fix 0 of a stream has zeros. Fixes are processed in blocks: the legs
+/// of a block (independent of each other) first, then a sequential scan
+/// for the derivatives and flags. Streams of many vehicles in CSR form
+/// are split over the threads.
+/// </summary>
+class GeodesyKinematics {
+
+public:
+    // outlier flags of a fix, or-ed
+    enum Flag : std::uint8_t {
+        None = 0,
+        Speed = 1,          // leg from the previous fix faster than maxSpeed
+        Acceleration = 2,   // |acceleration| above maxAcceleration
+        Turn = 4,           // |turn rate| above maxTurnRate
+        Time = 8,           // Δt not above minInterval (duplicate or out of order)
+        Spike = 16,         // both legs too fast, but not the previous to the next fix: a teleport
+        Invalid = 32        // coordinates failed, or the distance from a valid previous fix
+    };
+
+    template<class T>
+    struct Limits {
+        T maxSpeed = std::numeric_limits<T>::infinity();         // P::Units per time unit
+        T maxAcceleration = std::numeric_limits<T>::infinity();  // P::Units per time unit²
+        T maxTurnRate = std::numeric_limits<T>::infinity();      // degrees per time unit
+        T minInterval = 0;                                        // time units
+        T minDistance = 0;      // legs shorter than this have no reliable bearing (no Turn check)
+    };
+
+    /// <summary>
+    /// Output arrays, indexed as the fixes; any may be null
+    /// </summary>
+    template<class T>
+    struct Output {
+        T* distance = nullptr;
+        T* speed = nullptr;
+        T* acceleration = nullptr;
+        T* bearing = nullptr;
+        std::uint8_t* flags = nullptr;
+    };
+
+    /// <summary>
+    /// One stream of n fixes; returns the number of flagged fixes
+    /// </summary>
+    template<class P, class T>
+    static std::size_t Process(const T* t, const T* lat, const T* lon, std::size_t n,
+                               const Limits<T>& limits, const Output<T>& out) {
+        return Stream<P>(t, lat, lon, n, limits, out);
+    }
+
+    /// <summary>
+    /// Batch: stream k is the fixes offsets[k] .. offsets[k+1]-1 (CSR);
+    /// streams are split over the threads. Returns the flagged fixes.
+    /// </summary>
+    template<class P, class T, class I>
+    static std::size_t Process(const T* t, const T* lat, const T* lon, const I* offsets, std::size_t count,
+                               const Limits<T>& limits, const Output<T>& out) {
+        if (count == 0) return 0;
+        const std::size_t fixes = static_cast<std::size_t>(offsets[count] - offsets[0]);
+        const std::size_t grain = std::max<std::size_t>(1, GeodesyParallel::grain / P::cost * count / std::max<std::size_t>(fixes, 1));
+        std::atomic<std::size_t> flagged{ 0 };
+        GeodesyParallel::For(count, [&](std::size_t lo, std::size_t hi) {
+            std::size_t f = 0;
+            for (std::size_t k = lo; k < hi; ++k) {
+                const std::size_t first = static_cast<std::size_t>(offsets[k]);
+                f += Stream<P>(t + first, lat + first, lon + first, static_cast<std::size_t>(offsets[k + 1]) - first,
+                               limits, Shift(out, first));
+            }
+            flagged.fetch_add(f, std::memory_order_relaxed);
+        }, grain);
+        return flagged.load();
+    }
+
+private:
+    static constexpr std::size_t block = 256;
+
+    template<class T>
+    static Output<T> Shift(const Output<T>& o, std::size_t k) {
+        auto at = [k](auto* p) { return p ? p + k : p; };
+        return { at(o.distance), at(o.speed), at(o.acceleration), at(o.bearing), at(o.flags) };
+    }
+
+    // bearing difference wrapped to [-180, 180)
+    template<class T>
+    static T Wrap(T b1, T b0) {
+        T d = b1 - b0;
+        return d - 360 * std::floor((d + 180) / 360);
+    }
+
+    template<class P, class T>
+    static std::size_t Stream(const T* t, const T* lat, const T* lon, std::size_t n,
+                              const Limits<T>& limits, const Output<T>& out) {
+        using M = typename P::Math;
+        using Point = GeodesyPolicy::Point<T>;
+        constexpr T toRad = GeodesyKernels::toRad<T>;
+        if (n == 0) return 0;
+
+        // legs of a block: d[j], b[j] from fix i-1 to fix i = base + j
+        T d[block], b[block];
+        std::uint8_t bad[block];
+        Point prev = P::Prepare(lat[0], lon[0]);
+        T sPrev = 0, cPrev = 0;                       // sin, cos of latitude, for the bearing
+        {
+            T φ = lat[0] * toRad;
+            sPrev = M::Sin(φ); cPrev = M::Cos(φ);
+        }
+        auto valid = [](T la, T lo) { return std::fabs(la) <= 90 && std::isfinite(lo); };
+
+        // scan state: previous evaluated leg's speed, bearing and mid time,
+        // and its fix (the leg from iLast-1 to iLast)
+        T vLast = 0, bLast = 0, dLast = 0, mLast = 0;
+        bool haveLeg = false;
+        std::size_t iLast = 0;
+        std::size_t flagged = 0;
+        std::uint8_t pending = valid(lat[0], lon[0]) ? None : Invalid; // flags of the previous fix
+
+        auto emit = [&](std::size_t i, std::uint8_t f) {
+            if (out.flags) out.flags[i] = f;
+            flagged += (f != None);
+        };
+
+        if (out.distance) out.distance[0] = 0;
+        if (out.speed) out.speed[0] = 0;
+        if (out.acceleration) out.acceleration[0] = 0;
+        if (out.bearing) out.bearing[0] = 0;
+
+        for (std::size_t base = 1; base < n; base += block) {
+            const std::size_t m = std::min(block, n - base);
+            // legs: independent, no carried state but the previous fix
+            for (std::size_t j = 0; j < m; ++j) {
+                const std::size_t i = base + j;
+                const Point p = P::Prepare(lat[i], lon[i]);
+                const T φ = lat[i] * toRad, s = M::Sin(φ), c = M::Cos(φ);
+                const T Δλ = (lon[i] - lon[i - 1]) * toRad;
+                d[j] = P::Distance(prev, p);
+                T β = M::Atan2(M::Sin(Δλ) * c, cPrev * s - sPrev * c * M::Cos(Δλ)) / toRad;
+                b[j] = (β < 0) ? β + 360 : β;
+                bad[j] = !valid(lat[i - 1], lon[i - 1]) || !valid(lat[i], lon[i]) || !(d[j] >= 0);
+                prev = p; sPrev = s; cPrev = c;
+            }
+            // scan: derivatives and flags in fix order
+            for (std::size_t j = 0; j < m; ++j) {
+                const std::size_t i = base + j;
+                const T Δt = t[i] - t[i - 1];
+                // a leg from an invalid fix is not evaluated; that fix has the flag
+                std::uint8_t f = (!valid(lat[i], lon[i]) || (bad[j] && valid(lat[i - 1], lon[i - 1]))) ? Invalid : None;
+                T v = 0, a = 0;
+                if (!(Δt > limits.minInterval) || !(Δt > 0)) f |= Time;
+                else if (!bad[j]) {
+                    v = d[j] / Δt;
+                    if (v > limits.maxSpeed) f |= Speed;
+                    const T mid = (t[i] + t[i - 1]) / 2;
+                    if (haveLeg && mid > mLast) {
+                        a = (v - vLast) / (mid - mLast);
+                        if (std::fabs(a) > limits.maxAcceleration) f |= Acceleration;
+                        if (d[j] >= limits.minDistance && dLast >= limits.minDistance &&
+                            std::fabs(Wrap(b[j], bLast)) / (mid - mLast) > limits.maxTurnRate) f |= Turn;
+                    }
+                    // a fix reached and left too fast (both legs evaluated),
+                    // though its neighbors are not too far apart for the time
+                    // between them: a spike
+                    if ((f & Speed) && haveLeg && iLast == i - 1 && vLast > limits.maxSpeed) {
+                        T bypass = P::Distance(lat[i - 2], lon[i - 2], lat[i], lon[i]);
+                        if (bypass >= 0 && bypass <= limits.maxSpeed * (t[i] - t[i - 2])) pending |= Spike;
+                    }
+                    vLast = v; bLast = b[j]; dLast = d[j]; mLast = mid;
+                    haveLeg = true; iLast = i;
+                }
+                if (out.distance) out.distance[i] = bad[j] ? T(-1) : d[j];
+                if (out.speed) out.speed[i] = v;
+                if (out.acceleration) out.acceleration[i] = a;
+                if (out.bearing) out.bearing[i] = b[j];
+                // the previous fix is final now (Spike needs its outgoing leg)
+                emit(i - 1, pending);
+                pending = f;
+            }
+        }
+        emit(n - 1, pending);
+        return flagged;
+    }
+};
@@ -0,0 +1,193 @@
+﻿/**********************************************************************************
+Module        : GeodesyMath.cpp | Class Lib | C++
+Description   : Fixed elementary-function kernels for reproducible results
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************
+Polynomial coefficients: fdlibm (Copyright (C) 1993 by Sun Microsystems, Inc.
+Permission to use, copy, modify, and distribute this software is freely granted,
+provided that this notice is preserved.)
+***********************************************************************************/
+
+// no FMA contraction: a*b+c must round twice on every host
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+#include <cmath>
+#include "GeodesyMath.h"
+
+namespace {
+
+    // π/2 split into 33-bit chunks: n·pio2_k is exact for |n| < 2^20
+    constexpr double invpio2 = 6.36619772367581382433e-01;
+    constexpr double pio2_1  = 1.57079632673412561417e+00;
+    constexpr double pio2_2  = 6.07710050630396597660e-11;
+    constexpr double pio2_3  = 2.02226624871116645580e-21;
+
+    constexpr double S1 = -1.66666666666666324348e-01;
+    constexpr double S2 =  8.33333333332248946124e-03;
+    constexpr double S3 = -1.98412698298579493134e-04;
+    constexpr double S4 =  2.75573137070700676789e-06;
+    constexpr double S5 = -2.50507602534068634195e-08;
+    constexpr double S6 =  1.58969099521155010221e-10;
+
+    constexpr double C1 =  4.16666666666666019037e-02;
+    constexpr double C2 = -1.38888888888741095749e-03;
+    constexpr double C3 =  2.48015872894767294178e-05;
+    constexpr double C4 = -2.75573143513906633035e-07;
+    constexpr double C5 =  2.08757232129817482790e-09;
+    constexpr double C6 = -1.13596475577881948265e-11;
+
+    constexpr double atanhi[] = {
+        4.63647609000806093515e-01, 7.85398163397448278999e-01,
+        9.82793723247329054082e-01, 1.57079632679489655800e+00 };
+    constexpr double atanlo[] = {
+        2.26987774529616870924e-17, 3.06161699786838301793e-17,
+        1.39033110312309984516e-17, 6.12323399573676603587e-17 };
+    constexpr double aT[] = {
+         3.33333333333329318027e-01, -1.99999999998764832476e-01,
+         1.42857142725034663711e-01, -1.11111104054623557880e-01,
+         9.09088713343650656196e-02, -7.69187620504482999495e-02,
+         6.66107313738753120669e-02, -5.83357013379057348645e-02,
+         4.97687799461593236017e-02, -3.65315727442169155270e-02,
+         1.62858201153657823623e-02 };
+
+    constexpr double pi    = 3.1415926535897931160e+00;
+    constexpr double pi_lo = 1.2246467991473531772e-16;
+    constexpr double pio2  = 1.5707963267948965580e+00;
+
+    // sin/cos on [-π/4, π/4]
+    double KernelSin(double x) {
+        double z = x * x;
+        double v = z * x;
+        double r = S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)));
+        return x + v * (S1 + z * r);
+    }
+
+    double KernelCos(double x) {
+        double z = x * x;
+        double w = z * z;
+        double r = z * (C1 + z * (C2 + z * C3)) + w * w * (C4 + z * (C5 + z * C6));
+        double hz = 0.5 * z;
+        w = 1.0 - hz;
+        return w + (((1.0 - w) - hz) + z * r);
+    }
+
+    // x = n·π/2 + r, |r| <= π/4; returns n mod 4
+    int Reduce(double x, double& r) {
+        if (std::fabs(x) <= 7.85398163397448278999e-01) { r = x; return 0; }
+        double fn = std::floor(x * invpio2 + 0.5);
+        r = ((x - fn * pio2_1) - fn * pio2_2) - fn * pio2_3;
+        return static_cast<int>(static_cast<long long>(fn) & 3);
+    }
+}
+
+// Trigonometric functions *********************************************************
+double GeodesyMath::Sin(double x) {
+    if (!std::isfinite(x)) return x - x; // NaN
+    double r;
+    switch (Reduce(x, r)) {
+    case 0:  return KernelSin(r);
+    case 1:  return KernelCos(r);
+    case 2:  return -KernelSin(r);
+    default: return -KernelCos(r);
+    }
+}
+
+double GeodesyMath::Cos(double x) {
+    if (!std::isfinite(x)) return x - x;
+    double r;
+    switch (Reduce(x, r)) {
+    case 0:  return KernelCos(r);
+    case 1:  return -KernelSin(r);
+    case 2:  return -KernelCos(r);
+    default: return KernelSin(r);
+    }
+}
+
+double GeodesyMath::Tan(double x) {
+    return Sin(x) / Cos(x);
+}
+
+// Inverse trigonometric functions *************************************************
+/// <summary>
+/// Arc tangent: argument reduction to |x| < 7/16 around atan(1/2),
+/// atan(1), atan(3/2) and π/2, then an odd polynomial of degree 23.
+/// </summary>
+double GeodesyMath::Atan(double x) {
+    if (std::isnan(x)) return x;
+    double ax = std::fabs(x);
+    if (ax >= 7.37869762948382064640e+19) // 2^66
+        return std::signbit(x) ? -(atanhi[3] + atanlo[3]) : atanhi[3] + atanlo[3];
+
+    int id;
+    if (ax < 0.4375) {
+        if (ax < 7.45058059692382812500e-09) return x; // 2^-27
+        id = -1;
+    }
+    else if (ax < 1.1875) {
+        if (ax < 0.6875) { id = 0; ax = (2.0 * ax - 1.0) / (2.0 + ax); }
+        else { id = 1; ax = (ax - 1.0) / (ax + 1.0); }
+    }
+    else if (ax < 2.4375) { id = 2; ax = (ax - 1.5) / (1.0 + 1.5 * ax); }
+    else { id = 3; ax = -1.0 / ax; }
+
+    double t = (id < 0) ? x : ax;
+    double z = t * t;
+    double w = z * z;
+    double s1 = z * (aT[0] + w * (aT[2] + w * (aT[4] + w * (aT[6] + w * (aT[8] + w * aT[10])))));
+    double s2 = w * (aT[1] + w * (aT[3] + w * (aT[5] + w * (aT[7] + w * aT[9]))));
+    if (id < 0) return t - t * (s1 + s2);
+
+    double r = atanhi[id] - ((t * (s1 + s2) - atanlo[id]) - t);
+    return std::signbit(x) ? -r : r;
+}
+
+double GeodesyMath::Atan2(double y, double x) {
+    if (std::isnan(x) || std::isnan(y)) return x + y;
+    if (y == 0.0) {
+        if (std::signbit(x)) return std::signbit(y) ? -pi : pi;
+        return y; // ±0
+    }
+    if (x == 0.0) return std::signbit(y) ? -pio2 : pio2;
+    if (std::isinf(x) || std::isinf(y)) {
+        double q = std::isinf(y) ? (std::isinf(x) ? (std::signbit(x) ? 3 * pi / 4 : pi / 4) : pio2)
+                                 : (std::signbit(x) ? pi : 0.0);
+        return std::signbit(y) ? -q : q;
+    }
+
+    double q = std::fabs(y / x);
+    double z;
+    if (q > 1.15292150460684697600e+18) z = pio2 + 0.5 * pi_lo; // 2^60
+    else if (std::signbit(x) && q < 8.67361737988403547206e-19) z = 0.0; // 2^-60
+    else z = Atan(q);
+
+    if (!std::signbit(x)) return std::signbit(y) ? -z : z;
+    return std::signbit(y) ? (z - pi_lo) - pi : pi - (z - pi_lo);
+}
+
+double GeodesyMath::Asin(double x) {
+    return Atan2(x, Sqrt((1.0 - x) * (1.0 + x)));
+}
+
+double GeodesyMath::Acos(double x) {
+    return Atan2(Sqrt((1.0 - x) * (1.0 + x)), x);
+}
+
+// square root is exactly rounded by IEEE-754
+double GeodesyMath::Sqrt(double x) {
+    return std::sqrt(x);
+}
@@ -0,0 +1,45 @@
+﻿/**********************************************************************************
+Module        : GeodesyMath.h | Header File | C++
+Description   : Fixed elementary-function kernels for reproducible results
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+
+/// <summary>
+/// Class GeodesyMath implements the elementary functions used by the
+/// Geodesy kernels with fixed polynomial approximations (fdlibm-derived
+/// minimax coefficients, Cody-Waite range reduction) built only from
+/// IEEE-754 +, -, *, / and sqrt, which are exactly rounded on every
+/// conforming host. Unlike the C runtime (e.g. glibc selects FMA or SSE2
+/// variants of sin/cos at load time) they return bit-identical results
+/// on every CPU, provided that:
+/// - floating-point contraction is off (GeodesyMath.cpp and Geodesy.cpp
+///   request it via pragmas; otherwise compile with -ffp-contract=off);
+/// - no value-changing optimizations are enabled (no -ffast-math, /fp:fast);
+/// - double arithmetic is evaluated in double (FLT_EVAL_METHOD == 0,
+///   i.e. SSE2 or later on x86, any AArch64).
+/// Accuracy is within 3 ulp of the exact result for the argument
+/// ranges used by the library (|x| < 2^20).
+/// </summary>
+class GeodesyMath {
+
+public:
+    static double Sin(double x);
+    static double Cos(double x);
+    static double Tan(double x);
+    static double Atan(double x);
+    static double Atan2(double y, double x);
+    static double Asin(double x);
+    static double Acos(double x);
+    static double Sqrt(double x);
+};
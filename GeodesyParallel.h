@@ -0,0 +1,182 @@
+﻿/**********************************************************************************
+Module        : GeodesyParallel.h | Header File | C++
+Description   : Multithreaded execution of the Geodesy batch methods
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// <summary>
+/// Class GeodesyParallel splits batch work over [0, n) into contiguous
+/// ranges processed by worker threads. Element-wise kernels produce the
+/// same results for any split; reductions use fixed-size chunks combined
+/// in index order, so their results do not depend on the thread count.
+/// The workers are a persistent pool, started on first use and parked
+/// between calls, so a batch call costs a wake-up, not thread creation
+/// (nor per-thread telemetry blocks). One parallel call runs at a time:
+/// a call made while the pool is busy (from another thread, or nested
+/// inside a worker) runs on the calling thread.
+/// </summary>
+class GeodesyParallel {
+
+public:
+    // minimum elements per worker thread
+    static constexpr std::size_t grain = 16384;
+
+    // reduction chunk size (fixed: part of the reproducible summation order)
+    static constexpr std::size_t chunk = 4096;
+
+    /// <summary>
+    /// Number of worker threads of the batch methods; 0 (default) selects
+    /// std::thread::hardware_concurrency(), 1 disables threading.
+    /// </summary>
+    static void SetThreads(unsigned n) { threads.store(n, std::memory_order_relaxed); }
+
+    static unsigned Threads() {
+        unsigned n = threads.load(std::memory_order_relaxed);
+        if (n == 0) n = std::max(1u, std::thread::hardware_concurrency());
+        return n;
+    }
+
+    /// <summary>
+    /// Call fn(begin, end) over contiguous ranges covering [0, n),
+    /// in parallel when n is large enough; returns after all ranges finish.
+    /// </summary>
+    template<class F>
+    static void For(std::size_t n, F&& fn, std::size_t minGrain = grain) {
+        std::size_t t = std::min<std::size_t>(Threads(), (n + minGrain - 1) / std::max<std::size_t>(minGrain, 1));
+        if (t <= 1 || worker) { if (n) fn(std::size_t{ 0 }, n); return; }
+        Pool& pool = Workers();
+        std::unique_lock<std::mutex> busy(pool.busy, std::try_to_lock);
+        if (!busy.owns_lock()) { fn(std::size_t{ 0 }, n); return; }
+
+        const std::size_t step = (n + t - 1) / t;
+        auto part = [&fn, n, step](std::size_t k) {
+            std::size_t lo = k * step, hi = std::min(n, lo + step);
+            if (lo < hi) fn(lo, hi);
+        };
+        pool.Run(t, part);
+    }
+
+    /// <summary>
+    /// Deterministic sum of term(begin, end) partial sums: chunk
+    /// boundaries are fixed and partials are added in chunk order,
+    /// independent of the number of threads. The result has the type
+    /// returned by term (double, float, long double).
+    /// </summary>
+    template<class F>
+    static auto Sum(std::size_t n, F&& term) {
+        using T = std::invoke_result_t<F&, std::size_t, std::size_t>;
+        std::size_t chunks = (n + chunk - 1) / chunk;
+        std::vector<T> partial(chunks);
+        For(chunks, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t c = lo; c < hi; ++c)
+                partial[c] = term(c * chunk, std::min(n, (c + 1) * chunk));
+        }, std::max<std::size_t>(1, grain / chunk));
+        T s = 0;
+        for (T p : partial) s += p;
+        return s;
+    }
+
+private:
+    static inline std::atomic<unsigned> threads{ 0 };
+    static inline thread_local bool worker = false;
+
+    /// <summary>
+    /// Persistent workers: Run(parts, part) publishes a job, the caller
+    /// and the woken workers take parts k = 0 .. parts-1 from a shared
+    /// counter, and Run returns once every part is done and no worker is
+    /// still inside the job.
+    /// </summary>
+    struct Pool {
+        std::mutex busy;                  // one job at a time
+        std::mutex lock;
+        std::condition_variable wake, idle;
+        std::vector<std::thread> team;
+        void (*call)(const void*, std::size_t) = nullptr;
+        const void* job = nullptr;
+        std::size_t parts = 0, active = 0;
+        std::atomic<std::size_t> next{ 0 }, done{ 0 };
+        std::uint64_t generation = 0;
+        bool stop = false;
+
+        ~Pool() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stop = true;
+            }
+            wake.notify_all();
+            for (auto& t : team) t.join();
+        }
+
+        template<class G>
+        void Run(std::size_t count, G& part) {
+            {
+                // workers woken late for the previous job must leave it first
+                std::unique_lock<std::mutex> guard(lock);
+                idle.wait(guard, [this] { return active == 0; });
+                while (team.size() + 1 < count) team.emplace_back([this] { Loop(); });
+                call = [](const void* g, std::size_t k) { (*static_cast<const G*>(g))(k); };
+                job = &part;
+                parts = count;
+                next.store(0, std::memory_order_relaxed);
+                done.store(0, std::memory_order_relaxed);
+                ++generation;
+            }
+            wake.notify_all();
+            Work();
+            std::unique_lock<std::mutex> guard(lock);
+            idle.wait(guard, [this] { return done.load(std::memory_order_acquire) == parts && active == 0; });
+            job = nullptr;
+        }
+
+        void Work() {
+            for (std::size_t k; (k = next.fetch_add(1, std::memory_order_relaxed)) < parts; ) {
+                call(job, k);
+                if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == parts) {
+                    std::lock_guard<std::mutex> guard(lock);
+                    idle.notify_all();
+                }
+            }
+        }
+
+        void Loop() {
+            worker = true;
+            std::uint64_t seen = 0;
+            std::unique_lock<std::mutex> guard(lock);
+            for (;;) {
+                wake.wait(guard, [&] { return stop || generation != seen; });
+                if (stop) return;
+                seen = generation;
+                ++active;
+                guard.unlock();
+                Work();
+                guard.lock();
+                if (--active == 0) idle.notify_all();
+            }
+        }
+    };
+
+    static Pool& Workers() {
+        static Pool pool;
+        return pool;
+    }
+};
@@ -0,0 +1,119 @@
+﻿/**********************************************************************************
+Module        : GeodesyPerf.h | Header File | C++
+Description   : Hardware performance counters (Linux perf_event) for benchmarks
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// Class PerfCounters reads Linux perf_event hardware counters of the
+/// calling thread around a code region: cycles, instructions, LLC misses,
+/// branch mispredicts and (optionally) floating-point operations.
+/// FP operations have no generic perf event; pass the raw PMU encoding
+/// of the host, e.g. Intel FP_ARITH_INST_RETIRED.SCALAR_DOUBLE = 0x01c7,
+/// AMD Zen retired FLOPs = 0xff03.
+/// Counters that cannot be opened (non-Linux, perf_event_paranoid,
+/// virtualized PMU) or were never scheduled on the PMU read as NaN; the
+/// counters are scaled for multiplexing.
+/// Only the calling thread is counted: work handed to other threads (the
+/// GeodesyParallel pool, whose workers outlive the region, so inherited
+/// counters would not report them) is missed; profile single-threaded.
+/// </summary>
+class PerfCounters {
+
+public:
+    enum Event { Cycles, Instructions, CacheMisses, BranchMisses, FPOps, Count };
+
+    static constexpr const char* names[Count] = {
+        "cycles", "instructions", "cache_misses", "branch_misses", "fp_ops" };
+
+    explicit PerfCounters(std::uint64_t fpRawConfig = 0) {
+        fd.fill(-1);
+#ifdef __linux__
+        Open(Cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        Open(Instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        Open(CacheMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        Open(BranchMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        if (fpRawConfig) Open(FPOps, PERF_TYPE_RAW, fpRawConfig);
+#else
+        (void)fpRawConfig;
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int f : fd) if (f >= 0) close(f);
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool Available() const {
+        for (int f : fd) if (f >= 0) return true;
+        return false;
+    }
+
+    // reset and start all counters
+    void Start() {
+#ifdef __linux__
+        for (int f : fd) if (f >= 0) { ioctl(f, PERF_EVENT_IOC_RESET, 0); ioctl(f, PERF_EVENT_IOC_ENABLE, 0); }
+#endif
+    }
+
+    // stop all counters and return their (multiplex-scaled) values
+    std::array<double, Count> Stop() {
+        std::array<double, Count> v;
+        v.fill(std::numeric_limits<double>::quiet_NaN());
+#ifdef __linux__
+        for (int i = 0; i < Count; ++i) if (fd[i] >= 0) ioctl(fd[i], PERF_EVENT_IOC_DISABLE, 0);
+        for (int i = 0; i < Count; ++i) {
+            if (fd[i] < 0) continue;
+            std::uint64_t buf[3]; // value, time enabled, time running
+            if (read(fd[i], buf, sizeof buf) != static_cast<ssize_t>(sizeof buf)) continue;
+            // never running: not counted, rather than zero events
+            v[i] = buf[2] ? static_cast<double>(buf[0]) * buf[1] / buf[2]
+                          : std::numeric_limits<double>::quiet_NaN();
+        }
+#endif
+        return v;
+    }
+
+private:
+    std::array<int, Count> fd;
+
+#ifdef __linux__
+    void Open(Event e, std::uint32_t type, std::uint64_t config) {
+        perf_event_attr attr{};
+        attr.size = sizeof attr;
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fd[e] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+};
@@ -0,0 +1,303 @@
+﻿/**********************************************************************************
+Module        : GeodesyPolicy.h | Header File | C++
+Description   : Compile-time selection of distance method, ellipsoid and units
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include "GeodesyKernels.h"
+#include "GeodesyParallel.h"
+
+/// <summary>
+/// Namespace GeodesyPolicy provides the Geodesy methods as policy types,
+/// to be passed as template parameters instead of function pointers or a
+/// run-time method switch: generic code (batch, matrix, track and index
+/// algorithms) is then specialized for the chosen method, ellipsoid and
+/// units, and the distance kernel is inlined into its loops, e.g.
+///   using P = GeodesyPolicy::Haversine<GeodesyPolicy::Miles>;
+///   GeodesyPolicy::Matrix<P>(lat1, lon1, n1, lat2, lon2, n2, d);
+/// A method policy P provides:
+///   template<class T> static T Distance(lat1, lon1, lat2, lon2): distance
+///     in P::Units computed in precision T (float, double, long double),
+///     negative if the method fails for the pair (Vincenty non-convergence);
+///   template<class T> static Point<T> Prepare(lat, lon) and
+///   template<class T> static T Distance(const Point<T>&, const Point<T>&):
+///     the same distance between points whose trigonometry was evaluated
+///     once (e.g. per graph node or index entry);
+///   static constexpr std::size_t cost: relative cost per pair (work split);
+///   static constexpr double boundR, boundF: Distance >= boundR (km) times
+///     the central angle between the points' UnitVector(lat, lon, boundF)
+///     (see LowerBound: the sphere of the spherical methods; for Vincenty
+///     the sphere of the polar radius, onto which the ellipsoid projects
+///     radially without lengthening any path).
+/// With the default StdMath a policy returns the same values as the
+/// corresponding Geodesy method; pass M = GeodesyMath for the fixed
+/// kernels of reproducible mode (Geodesy::SetReproducible does not apply
+/// to policies). Policy calls are not counted by GeodesyTelemetry.
+/// The generic algorithms take the precision from their array type, e.g.
+/// Batch<P>(const float*, ...) runs the float kernel end to end.
+/// </summary>
+namespace GeodesyPolicy {
+
+    // Units: distance units per kilometer *****************************************
+    struct Kilometers { static constexpr double perKm = 1.0; };
+    struct Miles { static constexpr double perKm = 1.0 / 1.609344; };
+    struct Meters { static constexpr double perKm = 1000.0; };
+
+    // Ellipsoids **********************************************************************
+    // a: equatorial radius (m), f: flattening, R: mean radius (km) of the
+    // spherical methods
+    struct WGS84 {
+        static constexpr double a = 6378137.0;
+        static constexpr double f = 1.0 / 298.257223563;
+        static constexpr double R = 6371.009;
+    };
+
+    struct GRS80 {
+        static constexpr double a = 6378137.0;
+        static constexpr double f = 1.0 / 298.257222101;
+        static constexpr double R = 6371.009;
+    };
+
+    // Methods *************************************************************************
+    using StdMath = GeodesyKernels::StdMath;
+
+    template<class T>
+    using Point = GeodesyKernels::Point<T>;
+
+    /// <summary>
+    /// Haversine great-circle distance on the sphere of radius E::R
+    /// </summary>
+    template<class U = Kilometers, class E = WGS84, class M = StdMath>
+    struct Haversine {
+        using Units = U;
+        using Ellipsoid = E;
+        using Math = M;
+        static constexpr std::size_t cost = 1;
+        static constexpr double boundR = E::R, boundF = 0;
+
+        template<class T>
+        static T Distance(T lat1, T lon1, T lat2, T lon2) {
+            return GeodesyKernels::HaversineCA<M>(lat1, lon1, lat2, lon2) * T(E::R) * T(U::perKm);
+        }
+
+        template<class T>
+        static Point<T> Prepare(T lat, T lon) {
+            return GeodesyKernels::SpherePoint<M>(lat, lon);
+        }
+
+        template<class T>
+        static T Distance(const Point<T>& p, const Point<T>& q) {
+            return GeodesyKernels::HaversineCA<M>(p, q) * T(E::R) * T(U::perKm);
+        }
+    };
+
+    /// <summary>
+    /// Spherical Law of Cosines great-circle distance on the sphere of radius E::R
+    /// </summary>
+    template<class U = Kilometers, class E = WGS84, class M = StdMath>
+    struct SLC {
+        using Units = U;
+        using Ellipsoid = E;
+        using Math = M;
+        static constexpr std::size_t cost = 1;
+        static constexpr double boundR = E::R, boundF = 0;
+
+        template<class T>
+        static T Distance(T lat1, T lon1, T lat2, T lon2) {
+            return GeodesyKernels::SLCCA<M>(lat1, lon1, lat2, lon2) * T(E::R) * T(U::perKm);
+        }
+
+        template<class T>
+        static Point<T> Prepare(T lat, T lon) {
+            return GeodesyKernels::SpherePoint<M>(lat, lon);
+        }
+
+        template<class T>
+        static T Distance(const Point<T>& p, const Point<T>& q) {
+            return GeodesyKernels::SLCCA<M>(p, q) * T(E::R) * T(U::perKm);
+        }
+    };
+
+    /// <summary>
+    /// Haversine with the atan2 central angle and h clamped to 1 (no NaN)
+    /// </summary>
+    template<class U = Kilometers, class E = WGS84, class M = StdMath>
+    struct HaversineAtan2 {
+        using Units = U;
+        using Ellipsoid = E;
+        using Math = M;
+        static constexpr std::size_t cost = 1;
+        static constexpr double boundR = E::R, boundF = 0;
+
+        template<class T>
+        static T Distance(T lat1, T lon1, T lat2, T lon2) {
+            return GeodesyKernels::HaversineAtan2CA<M>(lat1, lon1, lat2, lon2) * T(E::R) * T(U::perKm);
+        }
+
+        template<class T>
+        static Point<T> Prepare(T lat, T lon) {
+            return GeodesyKernels::SpherePoint<M>(lat, lon);
+        }
+
+        template<class T>
+        static T Distance(const Point<T>& p, const Point<T>& q) {
+            return GeodesyKernels::HaversineAtan2CA<M>(p, q) * T(E::R) * T(U::perKm);
+        }
+    };
+
+    /// <summary>
+    /// Vincenty formula on the sphere of radius E::R (closed form)
+    /// </summary>
+    template<class U = Kilometers, class E = WGS84, class M = StdMath>
+    struct SphericalVincenty {
+        using Units = U;
+        using Ellipsoid = E;
+        using Math = M;
+        static constexpr std::size_t cost = 1;
+        static constexpr double boundR = E::R, boundF = 0;
+
+        template<class T>
+        static T Distance(T lat1, T lon1, T lat2, T lon2) {
+            return GeodesyKernels::SphericalVincentyCA<M>(lat1, lon1, lat2, lon2) * T(E::R) * T(U::perKm);
+        }
+
+        template<class T>
+        static Point<T> Prepare(T lat, T lon) {
+            return GeodesyKernels::SpherePoint<M>(lat, lon);
+        }
+
+        template<class T>
+        static T Distance(const Point<T>& p, const Point<T>& q) {
+            return GeodesyKernels::SphericalVincentyCA<M>(p, q) * T(E::R) * T(U::perKm);
+        }
+    };
+
+    /// <summary>
+    /// Inverse Vincenty distance on the ellipsoid E; -1 if not converged
+    /// </summary>
+    template<class U = Kilometers, class E = WGS84, class M = StdMath>
+    struct Vincenty {
+        using Units = U;
+        using Ellipsoid = E;
+        using Math = M;
+        static constexpr std::size_t cost = 8;
+        static constexpr double boundR = E::a * (1 - E::f) / 1000, boundF = E::f;
+
+        template<class T>
+        static T Distance(T lat1, T lon1, T lat2, T lon2) {
+            int iterations;
+            T s = GeodesyKernels::VincentyKm<M>(lat1, lon1, lat2, lon2, T(E::a), T(E::f), iterations);
+            return (s < 0) ? -1 : s * T(U::perKm);
+        }
+
+        template<class T>
+        static Point<T> Prepare(T lat, T lon) {
+            return GeodesyKernels::EllipsoidPoint<M>(lat, lon, T(E::f));
+        }
+
+        template<class T>
+        static T Distance(const Point<T>& p, const Point<T>& q) {
+            int iterations;
+            T s = GeodesyKernels::VincentyKm<M>(p, q, T(E::a), T(E::f), iterations);
+            return (s < 0) ? -1 : s * T(U::perKm);
+        }
+    };
+
+    // Lower bounds ********************************************************************
+    template<class T>
+    using Vec3 = GeodesyKernels::Vec3<T>;
+
+    /// <summary>
+    /// Unit vector of a geo-point for LowerBound<P>
+    /// </summary>
+    template<class P, class T>
+    Vec3<T> BoundVector(T lat, T lon) {
+        return GeodesyKernels::UnitVector<typename P::Math>(lat, lon, T(P::boundF));
+    }
+
+    /// <summary>
+    /// Lower bound of P::Distance from the BoundVector of both points
+    /// (no more than a square root and an asin), e.g. an admissible and
+    /// consistent A* heuristic; reduced by 1e-9 relative to absorb rounding.
+    /// </summary>
+    template<class P, class T>
+    T LowerBound(const Vec3<T>& p, const Vec3<T>& q) {
+        return GeodesyKernels::ChordCA<typename P::Math>(p, q) *
+            T(P::boundR * P::Units::perKm * (1 - 1e-9));
+    }
+
+    /// <summary>
+    /// Squared chord between BoundVectors above which LowerBound exceeds
+    /// d (P::Units): pairs farther in chord need no P::Distance
+    /// </summary>
+    template<class P, class T>
+    T Chord2Above(T d) {
+        return GeodesyKernels::Chord2Of(d / T(P::boundR * P::Units::perKm * (1 - 1e-9))) * (1 + T(1e-12));
+    }
+
+    // Generic algorithms **************************************************************
+    /// <summary>
+    /// Batch (SoA): dist[i] = P::Distance(lat1[i], lon1[i], lat2[i], lon2[i])
+    /// </summary>
+    template<class P, class T>
+    void Batch(const T* lat1, const T* lon1,
+               const T* lat2, const T* lon2,
+               T* dist, std::size_t n) {
+        GeodesyParallel::For(n, [=](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i)
+                dist[i] = P::Distance(lat1[i], lon1[i], lat2[i], lon2[i]);
+        }, GeodesyParallel::grain / P::cost);
+    }
+
+    /// <summary>
+    /// Distance matrix, row-major n1 x n2:
+    /// d[i * n2 + j] = P::Distance(lat1[i], lon1[i], lat2[j], lon2[j])
+    /// </summary>
+    template<class P, class T>
+    void Matrix(const T* lat1, const T* lon1, std::size_t n1,
+                const T* lat2, const T* lon2, std::size_t n2,
+                T* d) {
+        if (n2 == 0) return;
+        GeodesyParallel::For(n1, [=](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i) {
+                const T φ = lat1[i], λ = lon1[i];
+                T* row = d + i * n2;
+                for (std::size_t j = 0; j < n2; ++j)
+                    row[j] = P::Distance(φ, λ, lat2[j], lon2[j]);
+            }
+        }, std::max<std::size_t>(1, GeodesyParallel::grain / P::cost / n2));
+    }
+
+    /// <summary>
+    /// Length of the track (lat[0], lon[0]) .. (lat[n-1], lon[n-1]): sum of
+    /// its n-1 legs in the deterministic GeodesyParallel::Sum order;
+    /// -1 if any leg fails.
+    /// </summary>
+    template<class P, class T>
+    T PathLength(const T* lat, const T* lon, std::size_t n) {
+        if (n < 2) return 0;
+        T s = GeodesyParallel::Sum(n - 1, [=](std::size_t lo, std::size_t hi) {
+            T sum = 0;
+            for (std::size_t i = lo; i < hi; ++i) {
+                T d = P::Distance(lat[i], lon[i], lat[i + 1], lon[i + 1]);
+                if (d < 0) return std::numeric_limits<T>::quiet_NaN();
+                sum += d;
+            }
+            return sum;
+        });
+        return (s >= 0) ? s : -1;
+    }
+}
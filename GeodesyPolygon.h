@@ -0,0 +1,291 @@
+﻿/**********************************************************************************
+Module        : GeodesyPolygon.h | Header File | C++
+Description   : Point-in-spherical-polygon tests with edge and polygon-set indexes
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <utility>
+#include <vector>
+#include "GeodesyArea.h"
+#include "GeodesyCapGrid.h"
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+
+/// <summary>
+/// Class GeodesyPolygon tests whether geo-points lie inside a spherical
+/// polygon: a ring of vertices (decimal degrees, closing edge implied)
+/// joined by great-circle arcs, whose inside is the smaller of the two
+/// regions it bounds (either orientation). A point is inside iff the
+/// half-meridian from it to the North pole crosses the ring an odd
+/// number of times, xor the pole itself is inside (found once from the
+/// ring's signed area and winding), so antimeridian and polar rings
+/// need no special cases. Crossings are found with unit vectors and dot
+/// products only, among the edges of the point's longitude bin (edge
+/// index), after a bounding-cap rejection test.
+/// Template parameters: P, the GeodesyPolicy method whose Math evaluates
+/// the unit vectors; T, the precision.
+/// </summary>
+template<class P, class T = double>
+class GeodesyPolygon {
+
+private:
+    using Vec3 = GeodesyPolicy::Vec3<T>;
+    using M = typename P::Math;
+    using K = GeodesyKernels;
+
+public:
+    GeodesyPolygon() = default;
+
+    GeodesyPolygon(const T* lat, const T* lon, std::size_t n) {
+        // a repeated closing vertex is dropped
+        if (n > 1 && lat[0] == lat[n - 1] && lon[0] == lon[n - 1]) --n;
+        vertex.resize(n);
+        for (std::size_t i = 0; i < n; ++i) vertex[i] = Unit(lat[i], lon[i]);
+        if (n < 3) return;
+        Reference(lat, lon, n);
+        BuildBins(lon, n);
+        BuildCap();
+    }
+
+    std::size_t Vertices() const { return vertex.size(); }
+
+    // bounding cap: unit center and cosine of its angular radius (-2: none)
+    const Vec3& CapCenter() const { return cap; }
+    T CapCos() const { return capCos; }
+
+    bool Contains(T lat, T lon) const { return Contains(Unit(lat, lon)); }
+
+    bool Contains(const Vec3& p) const {
+        if (vertex.size() < 3) return false;
+        if (K::Dot(p, cap) < capCos) return false;
+        // half-plane of the point's meridian: normal m, direction d
+        const Vec3 m{ -p.y, p.x, 0 }, d{ p.x, p.y, 0 };
+        if (m.x == 0 && m.y == 0) return (p.z > 0) ? north : south;
+        T λ = M::Atan2(p.y, p.x) / GeodesyKernels::toRad<T>;
+        std::size_t bin = Bin(λ);
+        bool inside = north;
+        for (std::uint32_t k = binStart[bin]; k < binStart[bin + 1]; ++k) {
+            std::uint32_t e = binEdge[k];
+            const Vec3& a = vertex[e];
+            const Vec3& b = vertex[(e + 1 == vertex.size()) ? 0 : e + 1];
+            T sa = K::Dot(a, m), sb = K::Dot(b, m);
+            if ((sa >= 0) == (sb >= 0)) continue;
+            // crossing of the arc with the meridian plane
+            T w = (sa > sb) ? T(1) : T(-1);
+            Vec3 x{ w * (sa * b.x - sb * a.x), w * (sa * b.y - sb * a.y), w * (sa * b.z - sb * a.z) };
+            if (K::Dot(x, d) <= 0) continue; // on the opposite half-meridian
+            // north of p: (p x x) . m < 0
+            T px = (p.y * x.z - p.z * x.y) * m.x + (p.z * x.x - p.x * x.z) * m.y;
+            if (px < 0) inside = !inside;
+        }
+        return inside;
+    }
+
+    /// <summary>
+    /// Batch: inside[i] = Contains(lat[i], lon[i]), many points vs. this
+    /// polygon in parallel; the cap test runs first over a whole block
+    /// (a straight dot-product loop), so rejected points cost no more
+    /// than their unit vector
+    /// </summary>
+    void Contains(const T* lat, const T* lon, std::size_t n, std::uint8_t* inside) const {
+        GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+            constexpr std::size_t block = 256;
+            Vec3 v[block];
+            T c[block];
+            for (std::size_t i0 = lo; i0 < hi; i0 += block) {
+                const std::size_t m = std::min(block, hi - i0);
+                for (std::size_t j = 0; j < m; ++j) v[j] = Unit(lat[i0 + j], lon[i0 + j]);
+                for (std::size_t j = 0; j < m; ++j) c[j] = v[j].x * cap.x + v[j].y * cap.y + v[j].z * cap.z;
+                for (std::size_t j = 0; j < m; ++j)
+                    inside[i0 + j] = (c[j] >= capCos) && Contains(v[j]);
+            }
+        }, GeodesyParallel::grain / 4);
+    }
+
+    static Vec3 Unit(T lat, T lon) { return GeodesyKernels::UnitVector<M>(lat, lon); }
+
+    /// <summary>
+    /// Set of polygons (e.g. geofences) in CSR form, polygon k being the
+    /// ring offsets[k] .. offsets[k+1]-1, with a grid over the unit
+    /// vectors (GeodesyCapGrid): each polygon is listed in the cells its bounding cap
+    /// overlaps, so a point is tested only against the polygons of its
+    /// cell. Polygons with caps too large for the grid are tested always.
+    /// </summary>
+    class Set {
+
+    public:
+        template<class I>
+        Set(const T* lat, const T* lon, const I* offsets, std::size_t count) : poly(count) {
+            GeodesyParallel::For(count, [&](std::size_t lo, std::size_t hi) {
+                for (std::size_t k = lo; k < hi; ++k) {
+                    const std::size_t first = static_cast<std::size_t>(offsets[k]);
+                    poly[k] = GeodesyPolygon(lat + first, lon + first, static_cast<std::size_t>(offsets[k + 1]) - first);
+                }
+            }, 64);
+            Build();
+        }
+
+        std::size_t Size() const { return poly.size(); }
+        const GeodesyPolygon& operator[](std::size_t k) const { return poly[k]; }
+
+        /// <summary>
+        /// Call fn(k) for every polygon k containing the point, in
+        /// ascending order of k
+        /// </summary>
+        template<class F>
+        void Containing(T lat, T lon, F&& fn) const {
+            const Vec3 p = Unit(lat, lon);
+            grid.Candidates(p, [&](std::size_t k) { if (poly[k].Contains(p)) fn(k); });
+        }
+
+        std::vector<std::uint32_t> Containing(T lat, T lon) const {
+            std::vector<std::uint32_t> out;
+            Containing(lat, lon, [&](std::size_t k) { out.push_back(static_cast<std::uint32_t>(k)); });
+            return out;
+        }
+
+        /// <summary>
+        /// Batch: polygons containing each of n points, as CSR: point i
+        /// is in polygons ids[offsets[i] .. offsets[i+1]-1]; points are
+        /// processed in parallel in fixed blocks concatenated in order
+        /// </summary>
+        void Containing(const T* lat, const T* lon, std::size_t n,
+                        std::vector<std::size_t>& offsets, std::vector<std::uint32_t>& ids) const {
+            constexpr std::size_t block = 4096;
+            const std::size_t blocks = (n + block - 1) / block;
+            std::vector<std::vector<std::uint32_t>> part(blocks);
+            offsets.assign(n + 1, 0);
+            GeodesyParallel::For(blocks, [&](std::size_t lo, std::size_t hi) {
+                for (std::size_t b = lo; b < hi; ++b)
+                    for (std::size_t i = b * block; i < std::min(n, (b + 1) * block); ++i) {
+                        Containing(lat[i], lon[i], [&](std::size_t k) { part[b].push_back(static_cast<std::uint32_t>(k)); });
+                        offsets[i + 1] = part[b].size();
+                    }
+            }, 1);
+            ids.clear();
+            for (std::size_t b = 0; b < blocks; ++b) {
+                const std::size_t base = ids.size();
+                for (std::size_t i = b * block; i < std::min(n, (b + 1) * block); ++i) offsets[i + 1] += base;
+                ids.insert(ids.end(), part[b].begin(), part[b].end());
+            }
+        }
+
+    private:
+        std::vector<GeodesyPolygon> poly;
+        GeodesyCapGrid<T> grid;
+
+        // caps: chord radius 2 sin(R/2) = sqrt(2 - 2 cos R); rings under
+        // three vertices are left out, rings without a cap always tested
+        void Build() {
+            grid.Build(poly.size(), [&](std::size_t k, Vec3& center) {
+                const GeodesyPolygon& q = poly[k];
+                if (q.Vertices() < 3) return T(-1);
+                if (!(q.CapCos() > -1)) return std::numeric_limits<T>::infinity();
+                center = q.CapCenter();
+                return std::sqrt(std::max(T(0), 2 - 2 * q.CapCos()));
+            });
+        }
+    };
+
+private:
+    std::vector<Vec3> vertex;
+    bool north = false, south = false;   // poles inside
+    Vec3 cap{ 0, 0, 0 };
+    T capCos = -2;                       // no cap: every point is tested
+    std::vector<std::uint32_t> binStart, binEdge; // longitude bins of the edges
+
+    static T Normalize(T lon) {
+        lon = std::remainder(lon, T(360));
+        return (lon == -180) ? T(180) : lon;
+    }
+
+    std::size_t Bins() const { return binStart.size() - 1; }
+
+    std::size_t Bin(T λ) const {
+        const std::size_t b = static_cast<std::size_t>(std::floor((λ + 180) / 360 * T(Bins())));
+        return std::min(b, Bins() - 1);
+    }
+
+    // poles inside: a ring that winds around the polar axis (odd count of
+    // prime-meridian crossings) has one pole on its left, the North pole
+    // if it runs east; the inside is the left side iff the signed area is
+    // positive (GeodesyArea normalizes it to the smaller region). Any other
+    // ring has both poles on one side: the inside if the other side, the
+    // raw excess, covers more than a hemisphere.
+    void Reference(const T* lat, const T* lon, std::size_t n) {
+        GeodesyArea::Ring<GeodesyPolicy::Haversine<>, T> ring;
+        for (std::size_t i = 0; i < n; ++i) ring.Add(lat[i], lon[i]);
+        int c = 0;
+        const T excess = ring.RawExcess(c);
+        if (!(c & 1)) {
+            north = south = std::fabs(excess) > 2 * std::numbers::pi_v<T>;
+            return;
+        }
+        const bool left = ring.Area() > 0;
+        north = (c > 0) == left;
+        south = !north;
+    }
+
+    // every edge is listed in the bins its longitude span overlaps (a
+    // minor arc not through a pole spans |Δλ| < 180 monotonically)
+    void BuildBins(const T* lon, std::size_t n) {
+        const std::size_t bins = std::clamp<std::size_t>(n, 1, 4096);
+        binStart.assign(bins + 1, 0);
+        auto span = [&](std::size_t e, auto&& fn) {
+            std::size_t j = (e + 1 == n) ? 0 : e + 1;
+            T λ1 = Normalize(lon[e]), Δλ = Normalize(lon[j] - λ1);
+            T lo = std::min(λ1, λ1 + Δλ), hi = std::max(λ1, λ1 + Δλ);
+            auto b0 = static_cast<std::int64_t>(std::floor((lo + 180) / 360 * T(bins)));
+            auto b1 = static_cast<std::int64_t>(std::floor((hi + 180) / 360 * T(bins)));
+            if (std::fabs(Δλ) >= 180 || b1 - b0 + 1 >= std::int64_t(bins)) { b0 = 0; b1 = std::int64_t(bins) - 1; }
+            for (std::int64_t b = b0; b <= b1; ++b)
+                fn(static_cast<std::size_t>(((b % std::int64_t(bins)) + std::int64_t(bins)) % std::int64_t(bins)));
+        };
+        for (std::size_t e = 0; e < n; ++e) span(e, [&](std::size_t b) { ++binStart[b + 1]; });
+        for (std::size_t b = 0; b < bins; ++b) binStart[b + 1] += binStart[b];
+        binEdge.resize(binStart[bins]);
+        std::vector<std::uint32_t> next(binStart.begin(), binStart.end() - 1);
+        for (std::size_t e = 0; e < n; ++e)
+            span(e, [&](std::size_t b) { binEdge[next[b]++] = static_cast<std::uint32_t>(e); });
+    }
+
+    // cap around the vertex centroid: every point of an arc is within half
+    // its length of an endpoint; only caps under a hemisphere reject points
+    void BuildCap() {
+        Vec3 s{ 0, 0, 0 };
+        for (const Vec3& v : vertex) s = { s.x + v.x, s.y + v.y, s.z + v.z };
+        T len = std::sqrt(K::Dot(s, s));
+        if (!(len > 0)) return;
+        const Vec3 c{ s.x / len, s.y / len, s.z / len };
+        auto angle = [](const Vec3& a, const Vec3& b) {
+            Vec3 x = K::Cross(a, b);
+            return std::atan2(std::sqrt(K::Dot(x, x)), K::Dot(a, b));
+        };
+        T r = 0;
+        for (std::size_t i = 0; i < vertex.size(); ++i) {
+            const Vec3& a = vertex[i];
+            const Vec3& b = vertex[(i + 1 == vertex.size()) ? 0 : i + 1];
+            r = std::max(r, std::max(angle(c, a), angle(c, b)) + angle(a, b) / 2);
+        }
+        if (north || south || r >= std::numbers::pi_v<T> / 2) return;
+        cap = c;
+        capCos = std::cos(r) - T(1e-12);
+    }
+};
@@ -0,0 +1,285 @@
+﻿/**********************************************************************************
+Module        : GeodesyRank.h | Header File | C++
+Description   : Ranking candidates by distance from an origin: top-k nearest, sort
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+
+/// <summary>
+/// Class GeodesyRank orders candidate geo-points (SoA arrays lat[], lon[]
+/// in decimal degrees) by their distance from an origin without computing
+/// every distance: candidates are compared by a monotone surrogate key
+/// and only the results pay for the inverse trigonometry.
+///   Key, spherical methods of P: the haversine h = sin²(Δφ/2) +
+///   cos φ1 cos φ2 sin²(Δλ/2), the distance being 2·asin(√h)·R (no asin,
+///   no square root; the origin's terms are computed once);
+///   Vincenty: candidates are screened by the chord lower bound
+///   (GeodesyPolicy::LowerBound) against the current k-th distance, and
+///   only those passing are evaluated with P::Distance.
+///   Sort: all candidates by key, with an LSD radix sort of the keys' bit
+///   patterns (non-negative floating-point numbers order as unsigned
+///   integers); keys convert to distances on demand (FromKey).
+/// Ties are broken by candidate index, so results do not depend on the
+/// number of threads. Distances are in P::Units.
+/// </summary>
+class GeodesyRank {
+
+public:
+    /// <summary>
+    /// The k candidates nearest to (lat, lon), nearest first: their
+    /// indices in index[] and distances (P::Distance) in distance[];
+    /// returns their number, min(k, n) less failed distances
+    /// </summary>
+    template<class P, class T, class I>
+    static std::size_t Nearest(T lat, T lon, const T* clat, const T* clon, std::size_t n,
+                               std::size_t k, I* index, T* distance) {
+        if (k == 0 || n == 0) return 0;
+        const Origin<P, T> o(lat, lon);
+        std::vector<Entry<T>> best;
+        std::mutex lock;
+        GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+            Heap<T> h(k);
+            Scan(o, clat, clon, lo, hi, h);
+            std::lock_guard<std::mutex> guard(lock);
+            best.insert(best.end(), h.items.begin(), h.items.end());
+        }, std::max<std::size_t>(GeodesyParallel::grain / P::cost, 4 * k));
+        return Finish(o, clat, clon, best, k, index, distance);
+    }
+
+    /// <summary>
+    /// Batch: the k nearest candidates to each of m origins, origin q's
+    /// results at index[q * k] .. and distance[q * k] .., nearest first;
+    /// entries beyond the candidates found have distance -1. Origins are
+    /// split over the threads.
+    /// </summary>
+    template<class P, class T, class I>
+    static void Nearest(const T* lat, const T* lon, std::size_t m,
+                        const T* clat, const T* clon, std::size_t n,
+                        std::size_t k, I* index, T* distance) {
+        if (k == 0) return;
+        GeodesyParallel::For(m, [&](std::size_t lo, std::size_t hi) {
+            Heap<T> h(k);
+            for (std::size_t q = lo; q < hi; ++q) {
+                const Origin<P, T> o(lat[q], lon[q]);
+                h.items.clear();
+                Scan(o, clat, clon, 0, n, h);
+                std::size_t found = Finish(o, clat, clon, h.items, k, index + q * k, distance + q * k);
+                for (std::size_t j = found; j < k; ++j) { index[q * k + j] = I(0); distance[q * k + j] = -1; }
+            }
+        }, std::max<std::size_t>(1, GeodesyParallel::grain / P::cost / std::max<std::size_t>(n, 1)));
+    }
+
+    /// <summary>
+    /// Candidates 0 .. n-1 by distance from (lat, lon), nearest first, in
+    /// order[]; key (may be null) receives their keys in the same order:
+    /// haversine h for the spherical methods, P::Distance for Vincenty.
+    /// Keys are computed in parallel; failed distances sort last. T is
+    /// float or double (the radix sort runs on their bit patterns).
+    /// </summary>
+    template<class P, class T, class I>
+    static void Sort(T lat, T lon, const T* clat, const T* clon, std::size_t n,
+                     I* order, T* key = nullptr) {
+        static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>,
+                      "GeodesyRank::Sort: T must be float or double");
+        using U = std::conditional_t<sizeof(T) == 8, std::uint64_t, std::uint32_t>;
+        const Origin<P, T> o(lat, lon);
+        std::vector<U> bits(n);
+        GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+            T k[block];
+            for (std::size_t b = lo; b < hi; b += block) {
+                const std::size_t m = std::min(block, hi - b);
+                if constexpr (Origin<P, T>::sphere) o.Keys(clat + b, clon + b, m, k);
+                else for (std::size_t j = 0; j < m; ++j) k[j] = P::Distance(lat, lon, clat[b + j], clon[b + j]);
+                // -1 and NaN have the sign or exponent bits set: they sort last
+                for (std::size_t j = 0; j < m; ++j) bits[b + j] = std::bit_cast<U>(k[j]);
+            }
+        }, GeodesyParallel::grain / P::cost);
+        for (std::size_t i = 0; i < n; ++i) order[i] = static_cast<I>(i);
+        RadixSort(bits, order);
+        if (key) for (std::size_t j = 0; j < n; ++j) key[j] = std::bit_cast<T>(bits[j]);
+    }
+
+    /// <summary>
+    /// Distance (P::Units) of a Sort key: 2·asin(√h)·R for the spherical
+    /// methods (the Haversine formula), the key itself for Vincenty
+    /// </summary>
+    template<class P, class T>
+    static T FromKey(T key) {
+        if (!(key >= 0)) return -1;
+        if constexpr (P::boundF != 0) return key;
+        else return 2 * P::Math::Asin(P::Math::Sqrt(std::min(key, T(1)))) * T(P::Ellipsoid::R * P::Units::perKm);
+    }
+
+    template<class P, class T>
+    static void FromKey(const T* key, std::size_t n, T* distance) {
+        GeodesyParallel::For(n, [=](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i) distance[i] = FromKey<P>(key[i]);
+        }, GeodesyParallel::grain);
+    }
+
+private:
+    // (key, candidate): ordered by key, then by index
+    template<class T>
+    using Entry = std::pair<T, std::size_t>;
+
+    static constexpr std::size_t block = 256;
+
+    /// <summary>
+    /// Origin with its precomputed terms; Keys fills the surrogate keys of
+    /// a block of candidates in a branch-free loop: haversine h for the
+    /// spherical methods, the squared chord between BoundVectors otherwise
+    /// </summary>
+    template<class P, class T>
+    struct Origin {
+        using M = typename P::Math;
+        static constexpr bool sphere = (P::boundF == 0);
+        T lat, lon, φ, cosφ;
+        GeodesyPolicy::Vec3<T> v;
+
+        Origin(T lat, T lon)
+            : lat(lat), lon(lon), φ(lat * GeodesyKernels::toRad<T>), cosφ(M::Cos(φ)),
+              v(GeodesyPolicy::BoundVector<P>(lat, lon)) {}
+
+        void Keys(const T* clat, const T* clon, std::size_t n, T* key) const {
+            for (std::size_t j = 0; j < n; ++j) {
+                if constexpr (sphere) {
+                    T φ2 = clat[j] * GeodesyKernels::toRad<T>;
+                    T a = M::Sin((φ2 - φ) / 2), b = M::Sin((clon[j] - lon) / 2 * GeodesyKernels::toRad<T>);
+                    key[j] = a * a + b * b * cosφ * M::Cos(φ2);
+                }
+                else {
+                    key[j] = GeodesyKernels::Chord2(GeodesyPolicy::BoundVector<P>(clat[j], clon[j]), v);
+                }
+            }
+        }
+    };
+
+    /// <summary>
+    /// Bounded max-heap of the k best entries: a candidate enters only if
+    /// it beats the current k-th, so most cost one comparison
+    /// </summary>
+    template<class T>
+    struct Heap {
+        std::size_t k;
+        std::vector<Entry<T>> items;
+
+        explicit Heap(std::size_t k) : k(k) { items.reserve(k); }
+
+        bool Full() const { return items.size() == k; }
+        const Entry<T>& Worst() const { return items.front(); }
+
+        void Offer(const Entry<T>& e) {
+            if (items.size() < k) { items.push_back(e); std::push_heap(items.begin(), items.end()); }
+            else if (e < items.front()) {
+                std::pop_heap(items.begin(), items.end());
+                items.back() = e;
+                std::push_heap(items.begin(), items.end());
+            }
+        }
+    };
+
+    template<class P, class T>
+    static void Scan(const Origin<P, T>& o, const T* clat, const T* clon,
+                     std::size_t lo, std::size_t hi, Heap<T>& h) {
+        T key[block];
+        T above = T(4); // Vincenty: chord screen of the current k-th distance
+        for (std::size_t b = lo; b < hi; b += block) {
+            const std::size_t m = std::min(block, hi - b);
+            o.Keys(clat + b, clon + b, m, key);
+            for (std::size_t j = 0; j < m; ++j) {
+                if (!(key[j] == key[j])) continue;
+                if constexpr (Origin<P, T>::sphere) {
+                    if (!h.Full() || key[j] <= h.Worst().first) h.Offer({ key[j], b + j });
+                }
+                else {
+                    // exact distance only where the bound may beat the k-th
+                    if (key[j] > above) continue;
+                    T d = P::Distance(o.lat, o.lon, clat[b + j], clon[b + j]);
+                    if (d < 0) continue;
+                    h.Offer({ d, b + j });
+                    if (h.Full()) above = GeodesyPolicy::Chord2Above<P>(h.Worst().first);
+                }
+            }
+        }
+    }
+
+    // k best of the entries, nearest first, with their P::Distance
+    template<class P, class T, class I>
+    static std::size_t Finish(const Origin<P, T>& o, const T* clat, const T* clon,
+                              std::vector<Entry<T>>& best, std::size_t k, I* index, T* distance) {
+        if (best.size() > k) {
+            std::nth_element(best.begin(), best.begin() + (k - 1), best.end());
+            best.resize(k);
+        }
+        std::sort(best.begin(), best.end());
+        std::size_t found = 0;
+        for (const Entry<T>& e : best) {
+            T d = Origin<P, T>::sphere ? P::Distance(o.lat, o.lon, clat[e.second], clon[e.second]) : e.first;
+            if (d < 0) continue;
+            index[found] = static_cast<I>(e.second);
+            distance[found++] = d;
+        }
+        return found;
+    }
+
+    /// <summary>
+    /// Stable LSD radix sort of the keys with their payload, 11-bit
+    /// digits; a digit shared by all keys is skipped (keys of nearby
+    /// candidates share their high exponent bits)
+    /// </summary>
+    template<class U, class I>
+    static void RadixSort(std::vector<U>& bits, I* order) {
+        constexpr int width = 11;
+        constexpr std::size_t radix = std::size_t(1) << width;
+        constexpr int passes = (8 * sizeof(U) + width - 1) / width;
+        const std::size_t n = bits.size();
+        if (n < 2) return;
+
+        std::vector<std::size_t> count(passes * radix, 0);
+        for (U b : bits)
+            for (int p = 0; p < passes; ++p) ++count[p * radix + ((b >> (p * width)) & (radix - 1))];
+
+        std::vector<U> bits2(n);
+        std::vector<I> order2(n);
+        U* src = bits.data(); U* dst = bits2.data();
+        I* osrc = order; I* odst = order2.data();
+        for (int p = 0; p < passes; ++p) {
+            std::size_t* c = count.data() + p * radix;
+            if (c[(src[0] >> (p * width)) & (radix - 1)] == n) continue;
+            std::size_t sum = 0;
+            for (std::size_t d = 0; d < radix; ++d) { std::size_t t = c[d]; c[d] = sum; sum += t; }
+            for (std::size_t i = 0; i < n; ++i) {
+                std::size_t j = c[(src[i] >> (p * width)) & (radix - 1)]++;
+                dst[j] = src[i];
+                odst[j] = osrc[i];
+            }
+            std::swap(src, dst);
+            std::swap(osrc, odst);
+        }
+        if (src != bits.data()) {
+            std::copy(src, src + n, bits.data());
+            std::copy(osrc, osrc + n, order);
+        }
+    }
+};
@@ -0,0 +1,295 @@
+﻿/**********************************************************************************
+Module        : GeodesyRoute.h | Header File | C++
+Description   : A* shortest paths over CSR graphs with a great-circle heuristic
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+
+/// <summary>
+/// Class GeodesyRouter finds shortest paths in a directed graph stored in
+/// CSR form (node u has the edges e = offsets[u] .. offsets[u+1]-1 to the
+/// nodes targets[e] with lengths weight[e], e.g. from GeodesyGraph) by A*
+/// search, using the great-circle distance to the target as heuristic.
+/// Template parameters: P, the GeodesyPolicy method whose lower bound
+/// (GeodesyPolicy::LowerBound) is the heuristic, so edge weights must be
+/// in P::Units and no shorter than P's distance between their endpoints
+/// (true for geodesic or road lengths); T, the precision; I and J, the
+/// integer types of offsets and node ids.
+/// The constructor precomputes the unit vector of every node (heuristic:
+/// one square root and one asin per node and query) and, for
+/// bidirectional search, the reverse graph. Searches run on a Query,
+/// which holds the per-query state; use one Query per thread.
+/// </summary>
+template<class P, class T = double, class I = std::size_t, class J = std::uint32_t>
+class GeodesyRouter {
+
+private:
+    using Vec3 = GeodesyPolicy::Vec3<T>;
+
+    /// <summary>
+    /// 4-ary min-heap of (key, node) with lazy deletion: decrease-key
+    /// pushes a new entry and stale entries are skipped on removal.
+    /// Four children per node halve the depth of a binary heap and keep
+    /// siblings in one cache line.
+    /// </summary>
+    class Heap {
+
+    public:
+        bool Empty() const { return h.empty(); }
+        void Clear() { h.clear(); }
+        T Top() const { return h.front().first; }
+
+        void Push(T key, J v) {
+            std::size_t i = h.size();
+            h.emplace_back(key, v);
+            while (i > 0) {
+                std::size_t p = (i - 1) / 4;
+                if (!(key < h[p].first)) break;
+                h[i] = h[p];
+                i = p;
+            }
+            h[i] = { key, v };
+        }
+
+        std::pair<T, J> Pop() {
+            std::pair<T, J> top = h.front(), last = h.back();
+            h.pop_back();
+            std::size_t i = 0, m = h.size();
+            while (m) {
+                std::size_t c = 4 * i + 1;
+                if (c >= m) break;
+                std::size_t end = std::min(c + 4, m), best = c;
+                for (std::size_t k = c + 1; k < end; ++k)
+                    if (h[k].first < h[best].first) best = k;
+                if (!(h[best].first < last.first)) break;
+                h[i] = h[best];
+                i = best;
+            }
+            if (m) h[i] = last;
+            return top;
+        }
+
+    private:
+        std::vector<std::pair<T, J>> h;
+    };
+
+public:
+    static constexpr J none = std::numeric_limits<J>::max();
+    static constexpr T inf = std::numeric_limits<T>::infinity();
+
+    struct Path {
+        T length = -1;            // P::Units; -1 if target is unreachable
+        std::vector<J> nodes;     // source .. target
+        std::size_t settled = 0;  // nodes removed from the queue(s)
+    };
+
+    GeodesyRouter(const T* lat, const T* lon, std::size_t nodes,
+                  const I* offsets, const J* targets, const T* weight,
+                  bool bidirectional = true)
+        : n(nodes), offsets(offsets), targets(targets), weight(weight), unit(nodes) {
+        Vec3* out = unit.data();
+        GeodesyParallel::For(n, [=](std::size_t lo, std::size_t hi) {
+            for (std::size_t u = lo; u < hi; ++u)
+                out[u] = GeodesyPolicy::BoundVector<P>(lat[u], lon[u]);
+        });
+        if (bidirectional) Reverse();
+    }
+
+    std::size_t Nodes() const { return n; }
+    bool Bidirectional() const { return !rOffsets.empty(); }
+
+    /// <summary>
+    /// Per-query workspace: distance labels, parents, cached potentials
+    /// and the priority queues; reset in time proportional to the nodes
+    /// touched by the previous search, not to the graph size.
+    /// </summary>
+    class Query {
+
+    public:
+        explicit Query(const GeodesyRouter& router)
+            : r(router), g{ std::vector<T>(router.n, inf), std::vector<T>(router.n, inf) },
+              parent{ std::vector<J>(router.n, none), std::vector<J>(router.n, none) },
+              pot(router.n, std::numeric_limits<T>::quiet_NaN()) {}
+
+        /// <summary>
+        /// Shortest path from source to target: bidirectional A* if the
+        /// router was built with the reverse graph, else unidirectional.
+        /// </summary>
+        Path Shortest(J source, J target) {
+            Reset();
+            return r.Bidirectional() ? Bidirectional(source, target) : Forward(source, target);
+        }
+
+    private:
+        const GeodesyRouter& r;
+        std::vector<T> g[2];       // distance from source (0) / to target (1)
+        std::vector<J> parent[2];
+        std::vector<T> pot;        // potential of touched nodes, NaN if not computed
+        std::vector<J> touched;
+        Heap heap[2];
+        Vec3 s, t;                 // unit vectors of source and target
+
+        void Reset() {
+            for (J v : touched) {
+                g[0][v] = g[1][v] = inf;
+                parent[0][v] = parent[1][v] = none;
+                pot[v] = std::numeric_limits<T>::quiet_NaN();
+            }
+            touched.clear();
+            heap[0].Clear();
+            heap[1].Clear();
+        }
+
+        void Touch(J v) {
+            if (pot[v] != pot[v] && g[0][v] == inf && g[1][v] == inf) touched.push_back(v);
+        }
+
+        // A*: h(v) = lower bound of the distance v -> target
+        T ForwardPotential(J v) {
+            if (pot[v] != pot[v]) pot[v] = GeodesyPolicy::LowerBound<P>(r.unit[v], t);
+            return pot[v];
+        }
+
+        // bidirectional A*: average potential p(v) = (h_t(v) - h_s(v)) / 2;
+        // the forward search uses p, the reverse search -p, so both see
+        // the same non-negative reduced edge lengths
+        T BalancedPotential(J v) {
+            if (pot[v] != pot[v])
+                pot[v] = (GeodesyPolicy::LowerBound<P>(r.unit[v], t) -
+                          GeodesyPolicy::LowerBound<P>(r.unit[v], s)) / 2;
+            return pot[v];
+        }
+
+        Path Forward(J source, J target) {
+            Path path;
+            t = r.unit[target];
+            Touch(source);
+            g[0][source] = 0;
+            heap[0].Push(ForwardPotential(source), source);
+
+            while (!heap[0].Empty()) {
+                auto [k, u] = heap[0].Pop();
+                if (k != g[0][u] + pot[u]) continue; // stale entry
+                ++path.settled;
+                if (u == target) break;
+                for (I e = r.offsets[u]; e < r.offsets[u + 1]; ++e) {
+                    J v = r.targets[e];
+                    T d = g[0][u] + r.weight[e];
+                    if (d < g[0][v]) {
+                        Touch(v);
+                        g[0][v] = d;
+                        parent[0][v] = u;
+                        heap[0].Push(d + ForwardPotential(v), v);
+                    }
+                }
+            }
+            if (g[0][target] == inf) return path;
+
+            path.length = g[0][target];
+            for (J v = target; v != none; v = parent[0][v]) path.nodes.push_back(v);
+            std::reverse(path.nodes.begin(), path.nodes.end());
+            return path;
+        }
+
+        Path Bidirectional(J source, J target) {
+            Path path;
+            if (source == target) return Forward(source, target);
+            s = r.unit[source];
+            t = r.unit[target];
+            Touch(source);
+            g[0][source] = 0;
+            heap[0].Push(BalancedPotential(source), source);
+            Touch(target);
+            g[1][target] = 0;
+            heap[1].Push(-BalancedPotential(target), target);
+
+            T μ = inf;                 // best path length found
+            J meetF = none, meetR = none; // its edge joining the two trees
+
+            // keys are g + p (forward) and g - p (reverse), so the sum of
+            // the two queue minima bounds every path not yet found
+            while (!heap[0].Empty() && !heap[1].Empty() &&
+                   heap[0].Top() + heap[1].Top() < μ) {
+                const int side = (heap[0].Top() <= heap[1].Top()) ? 0 : 1;
+                auto [k, u] = heap[side].Pop();
+                const T sign = side ? T(-1) : T(1);
+                if (k != g[side][u] + sign * pot[u]) continue; // stale entry
+                ++path.settled;
+
+                const I* off = side ? r.rOffsets.data() : r.offsets;
+                const J* adj = side ? r.rSources.data() : r.targets;
+                const T* w = side ? r.rWeight.data() : r.weight;
+                for (I e = off[u]; e < off[u + 1]; ++e) {
+                    J v = adj[e];
+                    T d = g[side][u] + w[e];
+                    if (d < g[side][v]) {
+                        Touch(v);
+                        g[side][v] = d;
+                        parent[side][v] = u;
+                        heap[side].Push(d + sign * BalancedPotential(v), v);
+                    }
+                    if (d + g[1 - side][v] < μ) {
+                        μ = d + g[1 - side][v];
+                        meetF = side ? v : u;
+                        meetR = side ? u : v;
+                    }
+                }
+            }
+            if (meetF == none) return path;
+
+            path.length = μ;
+            for (J v = meetF; v != none; v = parent[0][v]) path.nodes.push_back(v);
+            std::reverse(path.nodes.begin(), path.nodes.end());
+            for (J v = meetR; v != none; v = parent[1][v]) path.nodes.push_back(v);
+            return path;
+        }
+    };
+
+private:
+    std::size_t n;
+    const I* offsets;
+    const J* targets;
+    const T* weight;
+    std::vector<Vec3> unit;
+
+    // reverse graph: edges into u are rSources[rOffsets[u] .. rOffsets[u+1]-1]
+    std::vector<I> rOffsets;
+    std::vector<J> rSources;
+    std::vector<T> rWeight;
+
+    // transpose by counting sort on the edge targets
+    void Reverse() {
+        const std::size_t first = static_cast<std::size_t>(offsets[0]);
+        const std::size_t m = static_cast<std::size_t>(offsets[n]) - first;
+        rOffsets.assign(n + 1, I(0));
+        for (std::size_t e = first; e < first + m; ++e) ++rOffsets[static_cast<std::size_t>(targets[e]) + 1];
+        for (std::size_t u = 0; u < n; ++u) rOffsets[u + 1] += rOffsets[u];
+        rSources.resize(m);
+        rWeight.resize(m);
+        std::vector<I> next(rOffsets.begin(), rOffsets.end() - 1);
+        for (std::size_t u = 0; u < n; ++u)
+            for (I e = offsets[u]; e < offsets[u + 1]; ++e) {
+                I k = next[static_cast<std::size_t>(targets[e])]++;
+                rSources[k] = static_cast<J>(u);
+                rWeight[k] = weight[e];
+            }
+    }
+};
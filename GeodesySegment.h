@@ -0,0 +1,363 @@
+﻿/**********************************************************************************
+Module        : GeodesySegment.h | Header File | C++
+Description   : Cross-track, along-track and point-to-segment/polyline distances
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+
+/// <summary>
+/// Class GeodesySegment measures the distance of geo-points from a
+/// great-circle segment A -> B or a polyline, with n-vector geometry:
+/// the segment is its unit vectors A, B and the pole N = A x B / |A x B|
+/// of its great circle, so a point P costs one unit vector and a few dot
+/// products (P . N = sin of the cross-track angle).
+///   CrossTrack: signed distance from the great circle, positive to the
+///   right of A -> B;
+///   AlongTrack: signed distance from A to the foot of P on the circle;
+///   ToSegment: distance to the nearest point of the segment (clamped).
+/// Template parameter P, a GeodesyPolicy method: the spherical methods
+/// scale angles by the sphere radius E::R; Vincenty (ellipsoidal
+/// correction) locates the foot point on the sphere and measures the
+/// distance to it on the ellipsoid with P::Distance.
+/// Results are in P::Units, -1 on failure.
+/// </summary>
+class GeodesySegment {
+
+public:
+    template<class P, class T>
+    static T CrossTrack(T lat, T lon, T lat1, T lon1, T lat2, T lon2) {
+        Arc<P, T> s(lat1, lon1, lat2, lon2);
+        return s.CrossTrack(lat, lon, Unit<P>(lat, lon));
+    }
+
+    template<class P, class T>
+    static T AlongTrack(T lat, T lon, T lat1, T lon1, T lat2, T lon2) {
+        Arc<P, T> s(lat1, lon1, lat2, lon2);
+        return s.AlongTrack(Unit<P>(lat, lon));
+    }
+
+    template<class P, class T>
+    static T ToSegment(T lat, T lon, T lat1, T lon1, T lat2, T lon2) {
+        Arc<P, T> s(lat1, lon1, lat2, lon2);
+        return s.ToSegment(lat, lon, Unit<P>(lat, lon));
+    }
+
+    // Batch: many points vs. one segment **********************************************
+    /// <summary>
+    /// out[i] = CrossTrack of point i from the segment (lat1, lon1) ->
+    /// (lat2, lon2); the segment is set up once, the loop body is
+    /// branch-free for the spherical methods
+    /// </summary>
+    template<class P, class T>
+    static void CrossTrack(const T* lat, const T* lon, std::size_t n,
+                           T lat1, T lon1, T lat2, T lon2, T* out) {
+        const Arc<P, T> s(lat1, lon1, lat2, lon2);
+        GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i) out[i] = s.CrossTrack(lat[i], lon[i], Unit<P>(lat[i], lon[i]));
+        }, GeodesyParallel::grain / P::cost);
+    }
+
+    template<class P, class T>
+    static void AlongTrack(const T* lat, const T* lon, std::size_t n,
+                           T lat1, T lon1, T lat2, T lon2, T* out) {
+        const Arc<P, T> s(lat1, lon1, lat2, lon2);
+        GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i) out[i] = s.AlongTrack(Unit<P>(lat[i], lon[i]));
+        }, GeodesyParallel::grain / P::cost);
+    }
+
+    template<class P, class T>
+    static void ToSegment(const T* lat, const T* lon, std::size_t n,
+                          T lat1, T lon1, T lat2, T lon2, T* out) {
+        const Arc<P, T> s(lat1, lon1, lat2, lon2);
+        GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i) out[i] = s.ToSegment(lat[i], lon[i], Unit<P>(lat[i], lon[i]));
+        }, GeodesyParallel::grain / P::cost);
+    }
+
+private:
+    template<class T>
+    using Vec3 = GeodesyPolicy::Vec3<T>;
+    using K = GeodesyKernels;
+
+    // unit vector on the sphere (geodetic latitude as spherical latitude)
+    template<class P, class T>
+    static Vec3<T> Unit(T lat, T lon) {
+        return GeodesyKernels::UnitVector<typename P::Math>(lat, lon);
+    }
+
+public:
+    /// <summary>
+    /// Segment A -> B: pole N and the in-plane normals TA = N x A,
+    /// TB = B x N; the foot of P on the circle lies within the segment
+    /// iff P . TA >= 0 and P . TB >= 0. Set up once, tested against many
+    /// points (Polyline, GeodesySimplify).
+    /// </summary>
+    template<class P, class T>
+    class Arc {
+
+    public:
+        using M = typename P::Math;
+        static constexpr bool sphere = (P::boundF == 0);
+
+        Arc() = default;
+
+        Arc(T lat1, T lon1, T lat2, T lon2)
+            : lat1(lat1), lon1(lon1), lat2(lat2), lon2(lon2),
+              a(Unit<P>(lat1, lon1)), b(Unit<P>(lat2, lon2)) {
+            Vec3<T> c = K::Cross(a, b);
+            T s = M::Sqrt(K::Dot(c, c));
+            point = !(s > 8 * std::numeric_limits<T>::epsilon());
+            if (point) return;
+            n = { c.x / s, c.y / s, c.z / s };
+            ta = K::Cross(n, a);
+            tb = K::Cross(b, n);
+        }
+
+        const Vec3<T>& A() const { return a; }
+        const Vec3<T>& B() const { return b; }
+
+        // radius (km) times units: distance per radian on the sphere
+        static T Scale() { return T(P::Ellipsoid::R * P::Units::perKm); }
+
+        T CrossTrack(T lat, T lon, const Vec3<T>& p) const {
+            if (point) return ToPoint(lat, lon, p, a, lat1, lon1);
+            T s = std::clamp(K::Dot(p, n), T(-1), T(1));
+            if (sphere) return -M::Asin(s) * Scale();
+            T d = Foot(lat, lon, p);
+            return (d < 0) ? -1 : (s > 0 ? -d : d);
+        }
+
+        T AlongTrack(const Vec3<T>& p) const {
+            if (point) return 0;
+            T α = M::Atan2(K::Dot(p, ta), K::Dot(p, a));
+            if (sphere) return α * Scale();
+            // foot on the circle, measured from A on the ellipsoid
+            Vec3<T> f = Project(p);
+            T d = P::Distance(lat1, lon1, Lat(f), Lon(f));
+            return (d < 0) ? -1 : (α < 0 ? -d : d);
+        }
+
+        T ToSegment(T lat, T lon, const Vec3<T>& p) const {
+            if (point) return ToPoint(lat, lon, p, a, lat1, lon1);
+            if (Inside(p)) {
+                if (sphere) return M::Asin(std::min(std::fabs(K::Dot(p, n)), T(1))) * Scale();
+                return Foot(lat, lon, p);
+            }
+            return (K::Chord2(p, a) <= K::Chord2(p, b)) ? ToPoint(lat, lon, p, a, lat1, lon1)
+                                                  : ToPoint(lat, lon, p, b, lat2, lon2);
+        }
+
+        /// <summary>
+        /// Squared chord from p to the nearest point of the segment: no
+        /// trigonometry (the chord to the foot is 2 - 2 cos xt)
+        /// </summary>
+        T Chord2To(const Vec3<T>& p) const {
+            if (!point && Inside(p)) {
+                T s = K::Dot(p, n);
+                T c = std::max(T(1) - s * s, T(0));
+                return 2 * s * s / (1 + M::Sqrt(c)); // 2 - 2 sqrt(1 - s²), without cancellation
+            }
+            return std::min(K::Chord2(p, a), K::Chord2(p, b));
+        }
+
+        // distance from A to the foot of p, clamped to the segment
+        T Along(const Vec3<T>& p) const {
+            if (point) return 0;
+            if (Inside(p)) return AlongTrack(p);
+            return (K::Chord2(p, a) <= K::Chord2(p, b)) ? T(0) : Length();
+        }
+
+        T Length() const {
+            if (sphere) return M::Atan2(M::Sqrt(K::Dot(K::Cross(a, b), K::Cross(a, b))), K::Dot(a, b)) * Scale();
+            return P::Distance(lat1, lon1, lat2, lon2);
+        }
+
+    private:
+        T lat1 = 0, lon1 = 0, lat2 = 0, lon2 = 0;
+        Vec3<T> a{}, b{}, n{}, ta{}, tb{};
+        bool point = true; // A == B or antipodal (to rounding): no unique great circle
+
+        bool Inside(const Vec3<T>& p) const { return K::Dot(p, ta) >= 0 && K::Dot(p, tb) >= 0; }
+
+        Vec3<T> Project(const Vec3<T>& p) const {
+            T s = K::Dot(p, n);
+            return { p.x - s * n.x, p.y - s * n.y, p.z - s * n.z };
+        }
+
+        static T Lat(const Vec3<T>& v) {
+            return M::Atan2(v.z, M::Sqrt(v.x * v.x + v.y * v.y)) / GeodesyKernels::toRad<T>;
+        }
+
+        static T Lon(const Vec3<T>& v) { return M::Atan2(v.y, v.x) / GeodesyKernels::toRad<T>; }
+
+        // ellipsoidal distance from (lat, lon) to its foot on the circle
+        T Foot(T lat, T lon, const Vec3<T>& p) const {
+            Vec3<T> f = Project(p);
+            if (!(K::Dot(f, f) > 0)) return T(P::boundR * P::Units::perKm) * T(std::acos(T(-1)) / 2); // at the pole of the circle
+            return P::Distance(lat, lon, Lat(f), Lon(f));
+        }
+
+        static T ToPoint(T lat, T lon, const Vec3<T>& p, const Vec3<T>& q, T qlat, T qlon) {
+            if (sphere) return M::Atan2(M::Sqrt(K::Dot(K::Cross(p, q), K::Cross(p, q))), K::Dot(p, q)) * Scale();
+            return P::Distance(lat, lon, qlat, qlon);
+        }
+    };
+
+    /// <summary>
+    /// Polyline (lat[0], lon[0]) .. (lat[m-1], lon[m-1]) with a hierarchy
+    /// of bounding balls over its consecutive segments, so the nearest
+    /// segment to a point is found in about O(log m) segment tests
+    /// instead of m; the search runs in squared-chord space without
+    /// trigonometry, which is evaluated only for the nearest segment.
+    /// Immutable after construction; queries may run concurrently.
+    /// </summary>
+    template<class P, class T = double>
+    class Polyline {
+
+    public:
+        struct Nearest {
+            T distance = -1;             // to the nearest segment, P::Units; -1 on failure
+            std::size_t segment = 0;     // segment i joins vertices i and i+1
+            T along = 0;                 // polyline length from vertex 0 to the foot
+        };
+
+        Polyline(const T* lat, const T* lon, std::size_t m)
+            : arc(m > 1 ? m - 1 : (m ? 1 : 0)), start(arc.size() + 1, T(0)) {
+            for (std::size_t i = 0; i < arc.size(); ++i) {
+                std::size_t j = (m > 1) ? i + 1 : i;
+                arc[i] = Arc<P, T>(lat[i], lon[i], lat[j], lon[j]);
+            }
+            for (std::size_t i = 0; i < arc.size(); ++i) start[i + 1] = start[i] + arc[i].Length();
+            if (arc.empty()) return;
+            node.resize(1);
+            Build(0, 0, arc.size());
+        }
+
+        std::size_t Segments() const { return arc.size(); }
+        T Length() const { return start.back(); }
+
+        Nearest Distance(T lat, T lon) const {
+            Nearest r;
+            if (arc.empty()) return r;
+            const Vec3<T> p = Unit<P>(lat, lon);
+            T best = std::numeric_limits<T>::infinity();
+            std::size_t seg = 0;
+            // depth-first, nearer child first, pruned by the ball bounds
+            std::uint32_t stack[64];
+            int top = 0;
+            stack[top++] = 0;
+            while (top) {
+                const Node& nd = node[stack[--top]];
+                T g = M::Sqrt(K::Chord2(p, nd.c)) - nd.r;
+                if (g > 0 && g * g >= best) continue;
+                if (nd.left == leaf) {
+                    for (std::uint32_t i = nd.lo; i < nd.hi; ++i) {
+                        T c2 = arc[i].Chord2To(p);
+                        if (c2 < best) { best = c2; seg = i; }
+                    }
+                    continue;
+                }
+                T gl = K::Chord2(p, node[nd.left].c), gr = K::Chord2(p, node[nd.left + 1].c);
+                std::uint32_t near = (gl <= gr) ? nd.left : nd.left + 1;
+                stack[top++] = (near == nd.left) ? nd.left + 1 : nd.left;
+                stack[top++] = near;
+            }
+            r.segment = seg;
+            r.distance = arc[seg].ToSegment(lat, lon, p);
+            T a = arc[seg].Along(p);
+            r.along = (r.distance < 0 || a < 0) ? T(-1) : start[seg] + a;
+            return r;
+        }
+
+        /// <summary>
+        /// Batch: nearest segment of n points, in parallel; segment and
+        /// along may be null
+        /// </summary>
+        template<class I>
+        void Distance(const T* lat, const T* lon, std::size_t n,
+                      T* distance, I* segment = nullptr, T* along = nullptr) const {
+            GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+                for (std::size_t i = lo; i < hi; ++i) {
+                    Nearest r = Distance(lat[i], lon[i]);
+                    distance[i] = r.distance;
+                    if (segment) segment[i] = static_cast<I>(r.segment);
+                    if (along) along[i] = r.along;
+                }
+            }, std::max<std::size_t>(1, GeodesyParallel::grain / 16 / P::cost));
+        }
+
+        void Distance(const T* lat, const T* lon, std::size_t n, T* distance) const {
+            Distance<std::size_t>(lat, lon, n, distance);
+        }
+
+    private:
+        using M = typename P::Math;
+        static constexpr std::uint32_t leaf = std::numeric_limits<std::uint32_t>::max();
+        static constexpr std::size_t leafSize = 8;
+
+        // ball (center c, radius r) around segments lo .. hi-1; the
+        // children of an inner node are node[left] and node[left + 1]
+        struct Node {
+            Vec3<T> c;
+            T r;
+            std::uint32_t lo, hi, left;
+        };
+
+        std::vector<Arc<P, T>> arc;
+        std::vector<T> start;          // polyline length at each vertex
+        std::vector<Node> node;
+
+        // the minor arc A -> B lies in the ball on its chord (radius |AB| / 2)
+        void Build(std::uint32_t k, std::size_t lo, std::size_t hi) {
+            Node nd{ {}, 0, static_cast<std::uint32_t>(lo), static_cast<std::uint32_t>(hi), leaf };
+            if (hi - lo <= leafSize) {
+                Vec3<T> c{};
+                for (std::size_t i = lo; i < hi; ++i) {
+                    const Vec3<T>& a = arc[i].A();
+                    const Vec3<T>& b = arc[i].B();
+                    c = { c.x + a.x + b.x, c.y + a.y + b.y, c.z + a.z + b.z };
+                }
+                T w = T(2 * (hi - lo));
+                nd.c = { c.x / w, c.y / w, c.z / w };
+                for (std::size_t i = lo; i < hi; ++i) {
+                    const Vec3<T>& a = arc[i].A();
+                    const Vec3<T>& b = arc[i].B();
+                    Vec3<T> mid{ (a.x + b.x) / 2, (a.y + b.y) / 2, (a.z + b.z) / 2 };
+                    nd.r = std::max(nd.r, std::sqrt(K::Chord2(nd.c, mid)) + std::sqrt(K::Chord2(a, b)) / 2);
+                }
+            }
+            else {
+                std::size_t mid = lo + (hi - lo) / 2;
+                nd.left = static_cast<std::uint32_t>(node.size());
+                node.resize(node.size() + 2);
+                Build(nd.left, lo, mid);
+                Build(nd.left + 1, mid, hi);
+                const Node& l = node[nd.left];
+                const Node& r = node[nd.left + 1];
+                nd.c = { (l.c.x + r.c.x) / 2, (l.c.y + r.c.y) / 2, (l.c.z + r.c.z) / 2 };
+                nd.r = std::max(std::sqrt(K::Chord2(nd.c, l.c)) + l.r, std::sqrt(K::Chord2(nd.c, r.c)) + r.r);
+            }
+            nd.r *= T(1 + 1e-12);
+            node[k] = nd;
+        }
+    };
+};
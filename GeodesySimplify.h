@@ -0,0 +1,303 @@
+﻿/**********************************************************************************
+Module        : GeodesySimplify.h | Header File | C++
+Description   : Track simplification (Douglas-Peucker, Visvalingam) on the sphere
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+#include "GeodesySegment.h"
+
+/// <summary>
+/// Class GeodesySimplify thins tracks of geo-points (SoA arrays lat[],
+/// lon[] in decimal degrees) with geodesic error measures, so the result
+/// is equally faithful at any latitude:
+///   DouglasPeucker: keeps the points needed for every dropped point to
+///   lie within tolerance (P::Units) of the great-circle segment that
+///   replaces it; iterative, with an explicit stack;
+///   Visvalingam: drops points in order of the spherical area of the
+///   triangle they form with their neighbors, while it is below
+///   tolerance (P::Units squared);
+///   Stream: Douglas-Peucker-like opening-window simplification of an
+///   unbounded track, one point at a time, in bounded memory.
+/// Distances are compared as squared chords between unit vectors (no
+/// trigonometry per point); the geometry is that of the sphere of radius
+/// E::R of policy P for all methods. The first and last points are always
+/// kept. keep[i] is set to 1 for the kept points, 0 for the others; the
+/// number of kept points is returned.
+/// </summary>
+class GeodesySimplify {
+
+public:
+    template<class P, class T>
+    static std::size_t DouglasPeucker(const T* lat, const T* lon, std::size_t n, T tolerance,
+                                      std::uint8_t* keep) {
+        std::vector<Vec3<T>> v;
+        std::vector<std::pair<std::size_t, std::size_t>> stack;
+        return DouglasPeucker<P>(lat, lon, n, tolerance, keep, v, stack);
+    }
+
+    template<class P, class T>
+    static std::size_t Visvalingam(const T* lat, const T* lon, std::size_t n, T tolerance,
+                                   std::uint8_t* keep) {
+        Work<T> w;
+        return Visvalingam<P>(lat, lon, n, tolerance, keep, w);
+    }
+
+    // Batch: many tracks in CSR form ***************************************************
+    /// <summary>
+    /// Track k is the points offsets[k] .. offsets[k+1]-1; keep[] is
+    /// indexed as lat[], lon[]. Tracks are split over the threads; the
+    /// total number of kept points is returned.
+    /// </summary>
+    template<class P, class T, class I>
+    static std::size_t DouglasPeucker(const T* lat, const T* lon, const I* offsets, std::size_t count,
+                                      T tolerance, std::uint8_t* keep) {
+        return Batch(offsets, count, [&](std::size_t lo, std::size_t hi) {
+            std::vector<Vec3<T>> v;
+            std::vector<std::pair<std::size_t, std::size_t>> stack;
+            std::size_t kept = 0;
+            for (std::size_t k = lo; k < hi; ++k) {
+                const std::size_t first = static_cast<std::size_t>(offsets[k]);
+                kept += DouglasPeucker<P>(lat + first, lon + first, static_cast<std::size_t>(offsets[k + 1]) - first,
+                                          tolerance, keep + first, v, stack);
+            }
+            return kept;
+        });
+    }
+
+    template<class P, class T, class I>
+    static std::size_t Visvalingam(const T* lat, const T* lon, const I* offsets, std::size_t count,
+                                   T tolerance, std::uint8_t* keep) {
+        return Batch(offsets, count, [&](std::size_t lo, std::size_t hi) {
+            Work<T> w;
+            std::size_t kept = 0;
+            for (std::size_t k = lo; k < hi; ++k) {
+                const std::size_t first = static_cast<std::size_t>(offsets[k]);
+                kept += Visvalingam<P>(lat + first, lon + first, static_cast<std::size_t>(offsets[k + 1]) - first,
+                                       tolerance, keep + first, w);
+            }
+            return kept;
+        });
+    }
+
+private:
+    template<class T>
+    using Vec3 = GeodesyPolicy::Vec3<T>;
+    using K = GeodesyKernels;
+
+    // squared chord from a point to a segment (GeodesySegment::Arc::Chord2To)
+    template<class P, class T>
+    using Arc = GeodesySegment::Arc<P, T>;
+
+    template<class P, class T>
+    static Vec3<T> Unit(T lat, T lon) {
+        return GeodesyKernels::UnitVector<typename P::Math>(lat, lon);
+    }
+
+    // radius (km) times units: distance per radian on the sphere
+    template<class P, class T>
+    static T Scale() { return T(P::Ellipsoid::R * P::Units::perKm); }
+
+    template<class P, class T>
+    static std::size_t DouglasPeucker(const T* lat, const T* lon, std::size_t n, T tolerance,
+                                      std::uint8_t* keep,
+                                      std::vector<Vec3<T>>& v,
+                                      std::vector<std::pair<std::size_t, std::size_t>>& stack) {
+        if (n <= 2 || !(tolerance >= 0)) {
+            std::fill(keep, keep + n, std::uint8_t(1));
+            return n;
+        }
+        v.resize(n);
+        for (std::size_t i = 0; i < n; ++i) v[i] = Unit<P>(lat[i], lon[i]);
+        std::fill(keep, keep + n, std::uint8_t(0));
+        keep[0] = keep[n - 1] = 1;
+        std::size_t kept = 2;
+
+        const T c2 = K::Chord2Of(tolerance / Scale<P, T>());
+        stack.clear();
+        stack.emplace_back(0, n - 1);
+        while (!stack.empty()) {
+            auto [first, last] = stack.back();
+            stack.pop_back();
+            if (last - first < 2) continue;
+            const Arc<P, T> s(lat[first], lon[first], lat[last], lon[last]);
+            T worst = c2;
+            std::size_t arg = 0;
+            for (std::size_t i = first + 1; i < last; ++i) {
+                T d = s.Chord2To(v[i]);
+                if (d > worst) { worst = d; arg = i; }
+            }
+            if (arg == 0) continue;
+            keep[arg] = 1;
+            ++kept;
+            stack.emplace_back(arg, last);
+            stack.emplace_back(first, arg);
+        }
+        return kept;
+    }
+
+    // Visvalingam working storage, reused across the tracks of a batch
+    template<class T>
+    struct Work {
+        struct Entry { T area; std::size_t i, version; };
+        std::vector<Vec3<T>> v;
+        std::vector<std::size_t> prev, next, version;
+        std::vector<Entry> heap;
+    };
+
+    // spherical excess of the triangle a, b, c (rad²):
+    // tan(E/2) = |a . (b x c)| / (1 + a.b + b.c + c.a)
+    template<class T>
+    static T Excess(const Vec3<T>& a, const Vec3<T>& b, const Vec3<T>& c) {
+        return 2 * std::atan2(std::fabs(K::Dot(a, K::Cross(b, c))), 1 + K::Dot(a, b) + K::Dot(b, c) + K::Dot(c, a));
+    }
+
+    /// <summary>
+    /// Min-heap of effective areas with lazy deletion (an entry is stale
+    /// if its point was removed or its area recomputed); a neighbor's new
+    /// area is raised to the area just removed, so points go in order of
+    /// non-decreasing effective area.
+    /// </summary>
+    template<class P, class T>
+    static std::size_t Visvalingam(const T* lat, const T* lon, std::size_t n, T tolerance,
+                                   std::uint8_t* keep, Work<T>& w) {
+        std::fill(keep, keep + n, std::uint8_t(1));
+        if (n <= 2 || !(tolerance >= 0)) return n;
+        const T limit = tolerance / (Scale<P, T>() * Scale<P, T>());
+
+        w.v.resize(n); w.prev.resize(n); w.next.resize(n);
+        w.version.assign(n, 0);
+        for (std::size_t i = 0; i < n; ++i) {
+            w.v[i] = Unit<P>(lat[i], lon[i]);
+            w.prev[i] = i - 1;
+            w.next[i] = i + 1;
+        }
+        using Entry = typename Work<T>::Entry;
+        auto later = [](const Entry& x, const Entry& y) { return x.area > y.area; };
+        std::vector<Entry>& heap = w.heap;
+        heap.clear();
+        for (std::size_t i = 1; i + 1 < n; ++i) {
+            T e = Excess(w.v[i - 1], w.v[i], w.v[i + 1]);
+            if (e < limit) heap.push_back({ e, i, 0 });
+        }
+        std::make_heap(heap.begin(), heap.end(), later);
+
+        std::size_t kept = n;
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            Entry top = heap.back();
+            heap.pop_back();
+            if (!keep[top.i] || top.version != w.version[top.i]) continue;
+            keep[top.i] = 0;
+            --kept;
+            const std::size_t p = w.prev[top.i], q = w.next[top.i];
+            w.next[p] = q;
+            w.prev[q] = p;
+            for (std::size_t j : { p, q }) {
+                if (j == 0 || j == n - 1) continue;
+                T e = std::max(Excess(w.v[w.prev[j]], w.v[j], w.v[w.next[j]]), top.area);
+                ++w.version[j];
+                if (e < limit) {
+                    heap.push_back({ e, j, w.version[j] });
+                    std::push_heap(heap.begin(), heap.end(), later);
+                }
+            }
+        }
+        return kept;
+    }
+
+    template<class I, class Fn>
+    static std::size_t Batch(const I* offsets, std::size_t count, Fn&& fn) {
+        if (count == 0) return 0;
+        const std::size_t points = static_cast<std::size_t>(offsets[count] - offsets[0]);
+        const std::size_t grain = std::max<std::size_t>(1, GeodesyParallel::grain / 4 * count / std::max<std::size_t>(points, 1));
+        std::atomic<std::size_t> kept{ 0 };
+        GeodesyParallel::For(count, [&](std::size_t lo, std::size_t hi) {
+            kept.fetch_add(fn(lo, hi), std::memory_order_relaxed);
+        }, grain);
+        return kept.load();
+    }
+
+public:
+    /// <summary>
+    /// Streaming simplification of an unbounded track: the opening window
+    /// from the last kept point (anchor) grows while every point in it is
+    /// within tolerance of the segment from the anchor to the newest point;
+    /// when one is not, the point before the newest is kept and becomes
+    /// the anchor. Every dropped point is within tolerance of the kept
+    /// segment that spans it. The window is capped at maxWindow points
+    /// (bounded memory and O(maxWindow) work per point).
+    /// Add passes each kept point to emit(lat, lon, index), index counting
+    /// all points added; Flush emits the last point.
+    /// </summary>
+    template<class P, class T = double>
+    class Stream {
+
+    public:
+        explicit Stream(T tolerance, std::size_t maxWindow = 1024)
+            : c2(K::Chord2Of(tolerance / Scale<P, T>())), maxWindow(std::max<std::size_t>(maxWindow, 2)) {}
+
+        template<class Fn>
+        void Add(T lat, T lon, Fn&& emit) {
+            const Item item{ Unit<P>(lat, lon), lat, lon, count++ };
+            if (!started) {
+                started = true;
+                anchor = item;
+                emit(lat, lon, item.index);
+                return;
+            }
+            if (!window.empty()) {
+                const Arc<P, T> s(anchor.lat, anchor.lon, lat, lon);
+                bool fits = window.size() + 1 < maxWindow;
+                for (std::size_t k = 0; k < window.size() && fits; ++k) fits = s.Chord2To(window[k].v) <= c2;
+                if (!fits) {
+                    anchor = window.back();
+                    emit(anchor.lat, anchor.lon, anchor.index);
+                    window.clear();
+                }
+            }
+            window.push_back(item);
+        }
+
+        template<class Fn>
+        void Flush(Fn&& emit) {
+            if (!window.empty()) emit(window.back().lat, window.back().lon, window.back().index);
+            window.clear();
+            started = false;
+        }
+
+        std::size_t Count() const { return count; }
+
+    private:
+        struct Item {
+            Vec3<T> v;
+            T lat, lon;
+            std::size_t index;
+        };
+
+        T c2;
+        std::size_t maxWindow;
+        std::size_t count = 0;
+        bool started = false;
+        Item anchor{};
+        std::vector<Item> window;     // points after the anchor, newest last
+    };
+};
@@ -0,0 +1,277 @@
+﻿/**********************************************************************************
+Module        : GeodesyTelemetry.cpp | Class Lib | C++
+Description   : Optional run-time telemetry of the Geodesy methods
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include "GeodesyTelemetry.h"
+
+namespace {
+
+    // registry of live per-thread blocks; taken on thread start/exit and
+    // by queries, never on the instrumented path
+    struct Registry {
+        std::mutex lock;
+        std::vector<void*> live;
+        std::vector<GeodesyTelemetry::Pair> pairs; // non-convergent sample
+    };
+
+    Registry& Reg() {
+        static Registry r;
+        return r;
+    }
+}
+
+const char* GeodesyTelemetry::Name(Entry e) {
+    switch (e) {
+    case Entry::Haversine:              return "Haversine";
+    case Entry::SLC:                    return "SLC";
+    case Entry::Vincenty:               return "Vincenty";
+    case Entry::HaversineAtan2:         return "HaversineAtan2";
+    case Entry::SphericalVincenty:      return "SphericalVincenty";
+    case Entry::HaversineBatch:         return "HaversineBatch";
+    case Entry::SLCBatch:               return "SLCBatch";
+    case Entry::VincentyBatch:          return "VincentyBatch";
+    case Entry::HaversineAtan2Batch:    return "HaversineAtan2Batch";
+    case Entry::SphericalVincentyBatch: return "SphericalVincentyBatch";
+    case Entry::Count:                  break;
+    }
+    return "?";
+}
+
+// Per-thread blocks ***************************************************************
+/// <summary>
+/// First instrumented call on a thread: allocate and register its block.
+/// On thread exit the block is folded into the "retired" totals so that
+/// counts of finished worker threads are not lost.
+/// </summary>
+GeodesyTelemetry::ThreadStats* GeodesyTelemetry::Register() {
+    struct Owner {
+        std::unique_ptr<ThreadStats> stats = std::make_unique<ThreadStats>();
+        Owner() {
+            std::lock_guard<std::mutex> guard(Reg().lock);
+            Reg().live.push_back(stats.get());
+        }
+        ~Owner() {
+            std::lock_guard<std::mutex> guard(Reg().lock);
+            auto& live = Reg().live;
+            live.erase(std::remove(live.begin(), live.end(), stats.get()), live.end());
+            Merge(Retired(), *stats);
+            local = nullptr;
+        }
+    };
+    thread_local Owner owner;
+    local = owner.stats.get();
+    return local;
+}
+
+GeodesyTelemetry::ThreadStats& GeodesyTelemetry::Retired() {
+    static ThreadStats retired;
+    return retired;
+}
+
+void GeodesyTelemetry::Merge(ThreadStats& into, const ThreadStats& from) {
+    for (std::size_t e = 0; e < entries; ++e) {
+        into.calls[e].Add(from.calls[e].Get());
+        into.elements[e].Add(from.elements[e].Get());
+        into.samples[e].Add(from.samples[e].Get());
+        for (std::size_t k = 0; k < latencyBuckets; ++k)
+            into.latency[e][k].Add(from.latency[e][k].Get());
+        for (std::size_t k = 0; k < sizeBuckets; ++k)
+            into.batchSize[e][k].Add(from.batchSize[e][k].Get());
+        if (from.latencyMax[e].Get() > into.latencyMax[e].Get())
+            into.latencyMax[e].v.store(from.latencyMax[e].Get(), std::memory_order_relaxed);
+    }
+    into.vincentyCalls.Add(from.vincentyCalls.Get());
+    into.vincentyNs.Add(from.vincentyNs.Get());
+    into.vincentyNonConverged.Add(from.vincentyNonConverged.Get());
+    if (from.vincentyMaxIter.Get() > into.vincentyMaxIter.Get())
+        into.vincentyMaxIter.v.store(from.vincentyMaxIter.Get(), std::memory_order_relaxed);
+    for (std::size_t k = 0; k < into.vincentyIterations.size(); ++k)
+        into.vincentyIterations[k].Add(from.vincentyIterations[k].Get());
+}
+
+/// <summary>
+/// Sum of the retired totals and all live per-thread blocks
+/// (caller holds the registry lock; the result is a private copy).
+/// </summary>
+std::unique_ptr<GeodesyTelemetry::ThreadStats> GeodesyTelemetry::Aggregate() {
+    auto sum = std::make_unique<ThreadStats>();
+    Merge(*sum, Retired());
+    for (void* p : Reg().live) Merge(*sum, *static_cast<ThreadStats*>(p));
+    return sum;
+}
+
+// Queries *************************************************************************
+/// <summary>
+/// Snapshot of the inverse Vincenty telemetry: call count, per-call
+/// iteration histogram, non-convergent count with a sample of the
+/// offending input pairs, and total time spent in the method.
+/// </summary>
+/// <returns>VincentyStats: enabled = false if compiled without telemetry</returns>
+GeodesyTelemetry::VincentyStats GeodesyTelemetry::Vincenty() {
+    VincentyStats s;
+#ifdef GEODESY_TELEMETRY
+    std::lock_guard<std::mutex> guard(Reg().lock);
+    auto sum = Aggregate();
+    s.enabled = true;
+    s.calls = sum->vincentyCalls.Get();
+    s.nonConverged = sum->vincentyNonConverged.Get();
+    s.totalNs = sum->vincentyNs.Get();
+    s.maxIterations = static_cast<int>(sum->vincentyMaxIter.Get());
+    for (std::size_t k = 0; k < s.iterations.size(); ++k)
+        s.iterations[k] = sum->vincentyIterations[k].Get();
+    s.nonConvergedPairs = Reg().pairs;
+#endif
+    return s;
+}
+
+/// <summary>
+/// Snapshot of one entry point: exact call and element counts, sampled
+/// latency histogram with percentiles, and the batch size distribution.
+/// </summary>
+/// <returns>MethodStats: enabled = false if compiled without telemetry</returns>
+GeodesyTelemetry::MethodStats GeodesyTelemetry::Method(Entry e) {
+    MethodStats s;
+    s.entry = e;
+#ifdef GEODESY_TELEMETRY
+    const std::size_t i = static_cast<std::size_t>(e);
+    if (i >= entries) return s;
+    {
+        std::lock_guard<std::mutex> guard(Reg().lock);
+        auto sum = Aggregate();
+        s.calls = sum->calls[i].Get();
+        s.elements = sum->elements[i].Get();
+        s.samples = sum->samples[i].Get();
+        s.max = static_cast<double>(sum->latencyMax[i].Get());
+        for (std::size_t k = 0; k < latencyBuckets; ++k) s.latency[k] = sum->latency[i][k].Get();
+        for (std::size_t k = 0; k < sizeBuckets; ++k) s.batchSize[k] = sum->batchSize[i][k].Get();
+    }
+    s.enabled = true;
+
+    // percentiles: midpoint of the bucket holding the q-th sample
+    std::uint64_t total = 0;
+    double weighted = 0;
+    for (std::size_t k = 0; k < latencyBuckets; ++k) {
+        double mid = (BucketValue(k) + (k + 1 < latencyBuckets ? BucketValue(k + 1) : BucketValue(k))) / 2.0;
+        total += s.latency[k];
+        weighted += mid * s.latency[k];
+    }
+    if (total == 0) return s;
+    s.mean = weighted / total;
+    auto pct = [&](double q) {
+        std::uint64_t rank = static_cast<std::uint64_t>(q * (total - 1)) + 1, seen = 0;
+        for (std::size_t k = 0; k < latencyBuckets; ++k) {
+            seen += s.latency[k];
+            if (seen >= rank)
+                return std::min(s.max, (BucketValue(k) +
+                    (k + 1 < latencyBuckets ? BucketValue(k + 1) : BucketValue(k))) / 2.0);
+        }
+        return s.max;
+    };
+    s.p50 = pct(0.50); s.p90 = pct(0.90); s.p99 = pct(0.99); s.p999 = pct(0.999);
+#endif
+    return s;
+}
+
+void GeodesyTelemetry::SetSamplePeriod(unsigned period) {
+    samplePeriod.store(period ? period : 1, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Dump all entry points and the Vincenty iteration telemetry, with the
+/// sample of non-convergent input pairs, as JSON
+/// </summary>
+void GeodesyTelemetry::Dump(std::FILE* f) {
+#ifdef GEODESY_TELEMETRY
+    std::fprintf(f, "{\n  \"sample_period\": %u,\n  \"methods\": [\n",
+        samplePeriod.load(std::memory_order_relaxed));
+    for (std::size_t i = 0; i < entries; ++i) {
+        MethodStats s = Method(static_cast<Entry>(i));
+        std::fprintf(f, "    {\"method\": \"%s\", \"calls\": %llu, \"elements\": %llu, "
+            "\"samples\": %llu, \"mean_ns\": %.1f, \"p50_ns\": %.1f, \"p90_ns\": %.1f, "
+            "\"p99_ns\": %.1f, \"p999_ns\": %.1f, \"max_ns\": %.0f, \"batch_size_log2\": [",
+            Name(s.entry), (unsigned long long)s.calls, (unsigned long long)s.elements,
+            (unsigned long long)s.samples, s.mean, s.p50, s.p90, s.p99, s.p999, s.max);
+        std::size_t last = 0;
+        for (std::size_t k = 0; k < sizeBuckets; ++k) if (s.batchSize[k]) last = k + 1;
+        for (std::size_t k = 0; k < last; ++k)
+            std::fprintf(f, "%s%llu", k ? ", " : "", (unsigned long long)s.batchSize[k]);
+        std::fprintf(f, "]}%s\n", i + 1 < entries ? "," : "");
+    }
+    VincentyStats v = Vincenty();
+    std::fprintf(f, "  ],\n  \"vincenty\": {\"calls\": %llu, \"non_converged\": %llu, "
+        "\"total_ns\": %llu, \"max_iterations\": %d, \"iterations\": [",
+        (unsigned long long)v.calls, (unsigned long long)v.nonConverged,
+        (unsigned long long)v.totalNs, v.maxIterations);
+    for (int k = 0; k <= v.maxIterations; ++k)
+        std::fprintf(f, "%s%llu", k ? ", " : "", (unsigned long long)v.iterations[k]);
+    // bounded sample of the non-convergent input pairs, full precision
+    std::fprintf(f, "],\n    \"non_converged_pairs\": [");
+    for (std::size_t k = 0; k < v.nonConvergedPairs.size(); ++k) {
+        const Pair& q = v.nonConvergedPairs[k];
+        std::fprintf(f, "%s\n      [%.17g, %.17g, %.17g, %.17g]", k ? "," : "",
+            q.lat1, q.lon1, q.lat2, q.lon2);
+    }
+    std::fprintf(f, "%s]}\n}\n", v.nonConvergedPairs.empty() ? "" : "\n    ");
+#else
+    std::fprintf(f, "{\"enabled\": false}\n");
+#endif
+}
+
+/// <summary>
+/// Reset all telemetry counters to zero
+/// </summary>
+void GeodesyTelemetry::Reset() {
+    auto zero = [](ThreadStats& t) {
+        auto clear = [](Counter& c) { c.v.store(0, std::memory_order_relaxed); };
+        for (std::size_t e = 0; e < entries; ++e) {
+            clear(t.calls[e]); clear(t.elements[e]); clear(t.samples[e]); clear(t.latencyMax[e]);
+            for (auto& c : t.latency[e]) clear(c);
+            for (auto& c : t.batchSize[e]) clear(c);
+        }
+        clear(t.vincentyCalls); clear(t.vincentyNs);
+        clear(t.vincentyNonConverged); clear(t.vincentyMaxIter);
+        for (auto& c : t.vincentyIterations) clear(c);
+    };
+    std::lock_guard<std::mutex> guard(Reg().lock);
+    zero(Retired());
+    for (void* p : Reg().live) zero(*static_cast<ThreadStats*>(p));
+    Reg().pairs.clear();
+}
+
+// Instrumentation points **********************************************************
+void GeodesyTelemetry::RecordVincenty(int iterations, bool converged,
+                                      double lat1, double lon1,
+                                      double lat2, double lon2) {
+    ThreadStats& t = Local();
+    iterations = std::clamp(iterations, 0, vincentyMaxIter);
+    t.vincentyIterations[iterations].Add(1);
+    if (static_cast<std::uint64_t>(iterations) > t.vincentyMaxIter.Get())
+        t.vincentyMaxIter.v.store(iterations, std::memory_order_relaxed);
+
+    if (!converged) {
+        // non-convergence is rare: the pair sample is guarded by the lock
+        t.vincentyNonConverged.Add(1);
+        std::lock_guard<std::mutex> guard(Reg().lock);
+        if (Reg().pairs.size() < maxPairs) Reg().pairs.push_back({ lat1, lon1, lat2, lon2 });
+    }
+}
+
+void GeodesyTelemetry::RecordVincentyTime(std::uint64_t ns, std::uint64_t calls) {
+    ThreadStats& t = Local();
+    t.vincentyCalls.Add(calls);
+    t.vincentyNs.Add(ns);
+}
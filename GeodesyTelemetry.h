@@ -0,0 +1,201 @@
+﻿/**********************************************************************************
+Module        : GeodesyTelemetry.h | Header File | C++
+Description   : Optional run-time telemetry of the Geodesy methods
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+/// <summary>
+/// Class GeodesyTelemetry exposes counters collected by the Geodesy methods.
+/// Collection is compiled in only when GEODESY_TELEMETRY is defined
+/// (e.g. -DGEODESY_TELEMETRY); otherwise the instrumentation points expand
+/// to nothing and every query returns empty statistics with enabled = false.
+/// Counters live in per-thread blocks written only by their owner thread
+/// (relaxed load/store, no locked instructions); queries aggregate all
+/// live threads plus the totals of threads that have exited.
+/// </summary>
+class GeodesyTelemetry {
+
+public:
+    // instrumented entry points
+    enum class Entry { Haversine, SLC, Vincenty, HaversineAtan2, SphericalVincenty,
+                       HaversineBatch, SLCBatch, VincentyBatch,
+                       HaversineAtan2Batch, SphericalVincentyBatch, Count };
+
+    static constexpr std::size_t entries = static_cast<std::size_t>(Entry::Count);
+
+    static const char* Name(Entry e);
+
+    // iteration limit of the inverse Vincenty loop
+    static constexpr int vincentyMaxIter = 100;
+
+    // bound of the non-convergent pair sample
+    static constexpr std::size_t maxPairs = 64;
+
+    // HDR-style log-linear latency buckets: 16 linear sub-buckets per
+    // power of two (~6% relative resolution) from 1 ns up to 2^40 ns
+    static constexpr int subBits = 4;
+    static constexpr std::size_t latencyBuckets = (40 - subBits + 2) << subBits;
+
+    // batch size buckets: [k] counts calls with n in [2^k, 2^(k+1))
+    static constexpr std::size_t sizeBuckets = 64;
+
+    // input pair that failed to converge, decimal degrees
+    struct Pair { double lat1, lon1, lat2, lon2; };
+
+    struct VincentyStats {
+        bool enabled = false;
+        std::uint64_t calls = 0;
+        std::uint64_t nonConverged = 0;
+        std::uint64_t totalNs = 0;          // time spent in Vincenty, ns
+        int maxIterations = 0;
+        // iterations[k]: number of calls that took k iterations (1..limit)
+        std::array<std::uint64_t, vincentyMaxIter + 1> iterations{};
+        // first non-convergent input pairs (bounded sample)
+        std::vector<Pair> nonConvergedPairs;
+    };
+
+    struct MethodStats {
+        bool enabled = false;
+        Entry entry = Entry::Haversine;
+        std::uint64_t calls = 0;
+        std::uint64_t elements = 0;         // pairs processed
+        std::uint64_t samples = 0;          // calls with measured latency
+        // sampled per-call latency percentiles, ns
+        double p50 = 0, p90 = 0, p99 = 0, p999 = 0, max = 0, mean = 0;
+        std::array<std::uint64_t, latencyBuckets> latency{};
+        std::array<std::uint64_t, sizeBuckets> batchSize{};
+    };
+
+    static VincentyStats Vincenty();
+
+    static MethodStats Method(Entry e);
+
+    /// <summary>
+    /// Measure the latency of every period-th call per thread (default 64);
+    /// call counts and elements are always exact.
+    /// </summary>
+    static void SetSamplePeriod(unsigned period);
+
+    // write all statistics as JSON
+    static void Dump(std::FILE* f);
+
+    // counts racing with a concurrent Reset may survive it
+    static void Reset();
+
+    // lower bound (ns) of a latency bucket
+    static constexpr std::uint64_t BucketValue(std::size_t idx) {
+        if (idx < (2u << subBits)) return idx;
+        std::size_t e = (idx >> subBits) - 1 + subBits;
+        return (std::uint64_t{ 1 } << e) |
+            (std::uint64_t{ idx & ((1u << subBits) - 1) } << (e - subBits));
+    }
+
+    static constexpr std::size_t LatencyBucket(std::uint64_t ns) {
+        if (ns < (2u << subBits)) return static_cast<std::size_t>(ns);
+        int e = std::bit_width(ns) - 1;
+        if (e > 40) return latencyBuckets - 1;
+        return (static_cast<std::size_t>(e - subBits + 1) << subBits) |
+            static_cast<std::size_t>((ns >> (e - subBits)) & ((1u << subBits) - 1));
+    }
+
+private:
+    // single-writer counter: owner thread updates without locked RMW
+    struct Counter {
+        std::atomic<std::uint64_t> v{ 0 };
+        void Add(std::uint64_t d) {
+            v.store(v.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+        }
+        std::uint64_t Get() const { return v.load(std::memory_order_relaxed); }
+    };
+
+    struct ThreadStats {
+        std::array<Counter, entries> calls, elements, samples;
+        std::array<std::array<Counter, latencyBuckets>, entries> latency;
+        std::array<std::array<Counter, sizeBuckets>, entries> batchSize;
+        std::array<Counter, entries> latencyMax;
+
+        Counter vincentyCalls, vincentyNs, vincentyNonConverged, vincentyMaxIter;
+        std::array<Counter, GeodesyTelemetry::vincentyMaxIter + 1> vincentyIterations;
+
+        unsigned countdown = 1; // calls to the next latency sample (owner only)
+    };
+
+    static inline thread_local ThreadStats* local = nullptr;
+    static inline std::atomic<unsigned> samplePeriod{ 64 };
+
+    static ThreadStats* Register();
+    static ThreadStats& Local() { return local ? *local : *Register(); }
+
+    // totals of exited threads
+    static ThreadStats& Retired();
+
+    static void Merge(ThreadStats& into, const ThreadStats& from);
+    static std::unique_ptr<ThreadStats> Aggregate();
+
+public:
+    // instrumentation points (called by Geodesy only if GEODESY_TELEMETRY)
+    static void RecordVincenty(int iterations, bool converged,
+                               double lat1, double lon1,
+                               double lat2, double lon2);
+    static void RecordVincentyTime(std::uint64_t ns, std::uint64_t calls);
+
+    /// <summary>
+    /// RAII probe of one entry-point call: counts the call and its
+    /// elements, and times every sampled call.
+    /// </summary>
+    class Probe {
+    public:
+        Probe(Entry e, std::uint64_t n) : t(Local()), i(static_cast<std::size_t>(e)) {
+            t.calls[i].Add(1);
+            t.elements[i].Add(n);
+            t.batchSize[i][n ? std::bit_width(n) - 1 : 0].Add(1);
+            if (--t.countdown == 0) {
+                t.countdown = samplePeriod.load(std::memory_order_relaxed);
+                sampled = true;
+                t0 = std::chrono::steady_clock::now();
+            }
+        }
+        ~Probe() {
+            if (!sampled) return;
+            auto ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - t0).count());
+            t.samples[i].Add(1);
+            t.latency[i][LatencyBucket(ns)].Add(1);
+            if (ns > t.latencyMax[i].Get()) t.latencyMax[i].v.store(ns, std::memory_order_relaxed);
+        }
+        Probe(const Probe&) = delete;
+        Probe& operator=(const Probe&) = delete;
+    private:
+        ThreadStats& t;
+        std::size_t i;
+        bool sampled = false;
+        std::chrono::steady_clock::time_point t0;
+    };
+};
+
+#ifdef GEODESY_TELEMETRY
+#define GEODESY_PROBE(entry, n) \
+    GeodesyTelemetry::Probe geodesyProbe_(GeodesyTelemetry::Entry::entry, (n))
+#else
+#define GEODESY_PROBE(entry, n) ((void)0)
+#endif
@@ -0,0 +1,1394 @@
+﻿/**********************************************************************************
+Module        : GeodesyTest.cpp | Test Driver | C++
+Description   : Behavior checks of the header-only Geodesy algorithm modules
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************
+Build         : g++ -std=c++20 -O2 Geodesy.cpp GeodesyMath.cpp GeodesyTelemetry.cpp GeodesyTest.cpp -o geodesy_test -pthread
+Usage         : geodesy_test [module]
+Output        : CSV, one row per module (checks, failures) and a result row;
+              : failed checks are listed on stderr; exit code 2 on any failure
+***********************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <numbers>
+#include <queue>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "GeodesyArea.h"
+#include "GeodesyCluster.h"
+#include "GeodesyFence.h"
+#include "GeodesyGraph.h"
+#include "GeodesyIntersect.h"
+#include "GeodesyKinematics.h"
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+#include "GeodesyPolygon.h"
+#include "GeodesyRank.h"
+#include "GeodesyRoute.h"
+#include "GeodesySegment.h"
+#include "GeodesySimplify.h"
+#include "GeodesyTour.h"
+#include "GeodesyTracker.h"
+#include "GeodesyTrajectory.h"
+
+namespace {
+
+    // Checks **********************************************************************
+    std::size_t checks = 0, failures = 0;
+
+    void Check(bool ok, const char* what, int line) {
+        ++checks;
+        if (ok) return;
+        ++failures;
+        std::fprintf(stderr, "GeodesyTest.cpp:%d: check failed: %s\n", line, what);
+    }
+
+#define CHECK(x) Check((x), #x, __LINE__)
+
+    using Km = GeodesyPolicy::Haversine<>;
+    using H = GeodesyPolicy::Haversine<GeodesyPolicy::Meters>;
+    using V = GeodesyPolicy::Vincenty<GeodesyPolicy::Meters>;
+
+    // uniform points on the sphere, decimal degrees
+    struct Cloud {
+        std::vector<double> lat, lon;
+        Cloud(std::size_t n, std::uint64_t seed) : lat(n), lon(n) {
+            std::mt19937_64 rng(seed);
+            std::uniform_real_distribution<double> u(0.0, 1.0);
+            for (std::size_t i = 0; i < n; ++i) {
+                lat[i] = std::asin(2 * u(rng) - 1) * 180 / std::numbers::pi;
+                lon[i] = 360 * u(rng) - 180;
+            }
+        }
+    };
+
+    bool Near(double a, double b, double tol) { return std::fabs(a - b) <= tol; }
+
+    // Policies ********************************************************************
+    template<class P>
+    void PolicyChecks(const Cloud& c) {
+        std::size_t prepared = 0, bounded = 0;
+        for (std::size_t i = 0; i + 1 < c.lat.size(); ++i) {
+            double d = P::Distance(c.lat[i], c.lon[i], c.lat[i + 1], c.lon[i + 1]);
+            auto p = P::Prepare(c.lat[i], c.lon[i]), q = P::Prepare(c.lat[i + 1], c.lon[i + 1]);
+            prepared += (P::Distance(p, q) == d);
+            double lb = GeodesyPolicy::LowerBound<P>(GeodesyPolicy::BoundVector<P>(c.lat[i], c.lon[i]),
+                                                     GeodesyPolicy::BoundVector<P>(c.lat[i + 1], c.lon[i + 1]));
+            bounded += (d < 0 || lb <= d);
+        }
+        CHECK(prepared == c.lat.size() - 1);   // prepared points: the same value
+        CHECK(bounded == c.lat.size() - 1);    // LowerBound never above the distance
+
+        std::vector<double> d(c.lat.size() - 1);
+        GeodesyPolicy::Batch<P>(c.lat.data(), c.lon.data(), c.lat.data() + 1, c.lon.data() + 1, d.data(), d.size());
+        double sum = 0;
+        bool same = true;
+        for (std::size_t i = 0; i < d.size(); ++i) {
+            same = same && d[i] == P::Distance(c.lat[i], c.lon[i], c.lat[i + 1], c.lon[i + 1]);
+            sum += d[i];
+        }
+        CHECK(same);
+        CHECK(Near(GeodesyPolicy::PathLength<P>(c.lat.data(), c.lon.data(), c.lat.size()), sum, 1e-9 * sum));
+    }
+
+    void TestPolicy() {
+        const Cloud c(20000, 58);
+        PolicyChecks<H>(c);
+        PolicyChecks<GeodesyPolicy::SLC<GeodesyPolicy::Meters>>(c);
+        PolicyChecks<GeodesyPolicy::HaversineAtan2<GeodesyPolicy::Meters>>(c);
+        PolicyChecks<GeodesyPolicy::SphericalVincenty<GeodesyPolicy::Meters>>(c);
+        PolicyChecks<V>(c);
+
+        // units, and the known JFK - LHR distances of the README
+        CHECK(Near(Km::Distance(40.641766, -73.780968, 51.470020, -0.454295), 5540.1754190795, 1e-6));
+        CHECK(Near(GeodesyPolicy::Vincenty<>::Distance(40.641766, -73.780968, 51.470020, -0.454295), 5555.0656860095, 1e-6));
+        CHECK(Near(H::Distance(10.0, 20.0, 11.0, 21.0), 1000 * Km::Distance(10.0, 20.0, 11.0, 21.0), 1e-6));
+        // Vincenty fails (-1) on exact antipodes; the path length reports it
+        const double lat[] = { 0, 10, -10 }, lon[] = { 0, 20, -160 };
+        CHECK(V::Distance(lat[1], lon[1], lat[2], lon[2]) == -1);
+        CHECK(GeodesyPolicy::PathLength<V>(lat, lon, 3) == -1);
+        // float precision end to end: ~3 m on Earth-scale distances
+        const float fl[] = { 40.641766f, 51.470020f }, fn[] = { -73.780968f, -0.454295f };
+        CHECK(Near(GeodesyPolicy::PathLength<H>(fl, fn, 2), 5540175.4190795, 10.0));
+    }
+
+    // Graph ***********************************************************************
+    void TestGraph() {
+        const std::size_t nodes = 3000;
+        const Cloud c(nodes, 61);
+        std::mt19937_64 rng(61);
+        // CSR with skewed degrees (node 0 has a thousand edges), offsets not from 0
+        std::vector<std::uint64_t> offsets{ 5 };
+        std::vector<std::uint32_t> targets(5, 0);
+        for (std::size_t u = 0; u < nodes; ++u) {
+            std::size_t degree = (u == 0) ? 1000 : rng() % 8;
+            for (std::size_t k = 0; k < degree; ++k) targets.push_back(static_cast<std::uint32_t>(rng() % nodes));
+            offsets.push_back(targets.size());
+        }
+        for (unsigned threads : { 1u, 3u }) {
+            GeodesyParallel::SetThreads(threads);
+            std::vector<double> h(targets.size(), 7), v(targets.size(), 7);
+            GeodesyGraph::EdgeLengths<H>(c.lat.data(), c.lon.data(), nodes, offsets.data(), targets.data(), h.data());
+            auto pts = GeodesyGraph::Points<V>(c.lat.data(), c.lon.data(), nodes);
+            GeodesyGraph::EdgeLengths<V>(pts.data(), nodes, offsets.data(), targets.data(), v.data());
+            std::size_t same = 0;
+            for (std::size_t u = 0; u < nodes; ++u)
+                for (std::size_t e = offsets[u]; e < offsets[u + 1]; ++e) {
+                    double dh = H::Distance(c.lat[u], c.lon[u], c.lat[targets[e]], c.lon[targets[e]]);
+                    double dv = V::Distance(c.lat[u], c.lon[u], c.lat[targets[e]], c.lon[targets[e]]);
+                    same += (h[e] == dh && v[e] == dv);
+                }
+            CHECK(same == targets.size() - 5);
+            CHECK(h[4] == 7 && v[4] == 7);   // edges before offsets[0] untouched
+        }
+        GeodesyParallel::SetThreads(0);
+        double none = 0;
+        GeodesyGraph::EdgeLengths<H>(c.lat.data(), c.lon.data(), 0, offsets.data(), targets.data(), &none);
+        CHECK(none == 0);
+    }
+
+    // Routing *********************************************************************
+    // plain Dijkstra: distances from source to every node, inf if unreachable
+    std::vector<double> Dijkstra(const std::vector<std::size_t>& offsets, const std::vector<std::uint32_t>& targets,
+                                 const std::vector<double>& weight, std::uint32_t source) {
+        std::vector<double> d(offsets.size() - 1, std::numeric_limits<double>::infinity());
+        using Item = std::pair<double, std::uint32_t>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> q;
+        d[source] = 0;
+        q.push({ 0, source });
+        while (!q.empty()) {
+            auto [k, u] = q.top();
+            q.pop();
+            if (k > d[u]) continue;
+            for (std::size_t e = offsets[u]; e < offsets[u + 1]; ++e)
+                if (k + weight[e] < d[targets[e]]) q.push({ d[targets[e]] = k + weight[e], targets[e] });
+        }
+        return d;
+    }
+
+    void TestRoute() {
+        // one-way edges to a few nearby nodes, lengths 1 .. 1.5 times the
+        // geodesic; the last 50 nodes have no incoming edges (unreachable)
+        const std::size_t nodes = 4000, island = 50;
+        Cloud c(nodes, 62);
+        std::mt19937_64 rng(62);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        for (std::size_t i = 0; i < nodes; ++i) { c.lat[i] = 45 + 4 * u(rng); c.lon[i] = 7 + 6 * u(rng); }
+        std::vector<std::size_t> offsets{ 0 };
+        std::vector<std::uint32_t> targets;
+        std::vector<double> weight;
+        for (std::size_t a = 0; a < nodes; ++a) {
+            for (std::size_t b = 0; b < nodes - island; ++b) {
+                double d = H::Distance(c.lat[a], c.lon[a], c.lat[b], c.lon[b]);
+                if (a != b && d < 12000 && u(rng) < 0.7) {
+                    targets.push_back(static_cast<std::uint32_t>(b));
+                    weight.push_back(d * (1 + 0.5 * u(rng)));
+                }
+            }
+            offsets.push_back(targets.size());
+        }
+
+        GeodesyRouter<H> forward(c.lat.data(), c.lon.data(), nodes, offsets.data(), targets.data(), weight.data(), false);
+        GeodesyRouter<H> both(c.lat.data(), c.lon.data(), nodes, offsets.data(), targets.data(), weight.data());
+        GeodesyRouter<H>::Query qf(forward), qb(both);
+        std::size_t agree = 0, valid = 0, unreachable = 0, queries = 200;
+        for (std::size_t k = 0; k < queries; ++k) {
+            std::uint32_t s = static_cast<std::uint32_t>(rng() % nodes);
+            std::uint32_t t = static_cast<std::uint32_t>(k % 10 == 0 ? nodes - 1 - rng() % island : rng() % nodes);
+            if (k % 25 == 0) t = s;
+            const double ref = Dijkstra(offsets, targets, weight, s)[t];
+            for (auto* q : { &qf, &qb }) {
+                auto path = q->Shortest(s, t);
+                if (std::isinf(ref)) { unreachable += (path.length == -1 && path.nodes.empty()); continue; }
+                agree += Near(path.length, ref, 1e-9 * ref);
+                // the path is a chain of edges from s to t of that length
+                double sum = 0;
+                bool chain = !path.nodes.empty() && path.nodes.front() == s && path.nodes.back() == t;
+                for (std::size_t i = 0; chain && i + 1 < path.nodes.size(); ++i) {
+                    auto e = std::find(targets.begin() + offsets[path.nodes[i]], targets.begin() + offsets[path.nodes[i] + 1],
+                                       path.nodes[i + 1]);
+                    chain = e != targets.begin() + offsets[path.nodes[i] + 1];
+                    if (chain) sum += weight[e - targets.begin()];
+                }
+                valid += chain && Near(sum, path.length, 1e-9 * ref);
+            }
+        }
+        const std::size_t reachable = 2 * queries - unreachable;
+        CHECK(unreachable >= 2 * 15);          // the unreachable targets were queried ...
+        CHECK(agree == reachable);             // ... and every other query matches Dijkstra
+        CHECK(valid == reachable);
+        auto self = qb.Shortest(7, 7);
+        CHECK(self.length == 0 && self.nodes.size() == 1 && self.nodes[0] == 7);
+    }
+
+    // Tours ***********************************************************************
+    bool IsPermutation(std::vector<GeodesyTour::Id> tour) {
+        std::sort(tour.begin(), tour.end());
+        for (std::size_t i = 0; i < tour.size(); ++i) if (tour[i] != i) return false;
+        return true;
+    }
+
+    void TestTour() {
+        Cloud c(3000, 63);
+        for (std::size_t i = 0; i < c.lat.size(); ++i) { c.lat[i] = 40 + c.lat[i] / 20; c.lon[i] = c.lon[i] / 20; }
+        const std::size_t n = c.lat.size();
+
+        // a shuffled tour only gets shorter, round after round
+        std::vector<GeodesyTour::Id> tour(n);
+        for (std::size_t i = 0; i < n; ++i) tour[i] = static_cast<GeodesyTour::Id>(i);
+        std::shuffle(tour.begin(), tour.end(), std::mt19937_64(63));
+        double last = GeodesyTour::Length<H>(c.lat.data(), c.lon.data(), tour);
+        bool shorter = true;
+        for (std::size_t rounds : { 1, 2, 5, 1000 }) {
+            GeodesyTour::Options opt;
+            opt.maxRounds = rounds;
+            std::vector<GeodesyTour::Id> t = tour;
+            double len = GeodesyTour::Improve<H>(c.lat.data(), c.lon.data(), t, opt);
+            shorter = shorter && len <= last && IsPermutation(t) &&
+                len == GeodesyTour::Length<H>(c.lat.data(), c.lon.data(), t);
+            last = len;
+        }
+        CHECK(shorter);
+
+        // space-filling start, thread count does not change the result
+        std::vector<GeodesyTour::Id> start = GeodesyTour::SpaceFilling<H>(c.lat.data(), c.lon.data(), n), t1 = start, t3 = start;
+        CHECK(IsPermutation(start));
+        GeodesyParallel::SetThreads(1);
+        double l1 = GeodesyTour::Improve<H>(c.lat.data(), c.lon.data(), t1);
+        GeodesyParallel::SetThreads(3);
+        double l3 = GeodesyTour::Improve<H>(c.lat.data(), c.lon.data(), t3);
+        GeodesyParallel::SetThreads(0);
+        CHECK(t1 == t3 && l1 == l3);
+        CHECK(l1 <= GeodesyTour::Length<H>(c.lat.data(), c.lon.data(), start));
+        CHECK(l1 < last * 1.1);   // as good as the shuffled start's optimum, roughly
+
+        // points on a small circle, shuffled: 2-opt removes every crossing,
+        // leaving the circle order
+        const std::size_t m = 200;
+        std::vector<double> clat(m), clon(m);
+        std::vector<GeodesyTour::Id> ring(m);
+        for (std::size_t i = 0; i < m; ++i) {
+            double θ = 2 * std::numbers::pi * i / m;
+            clat[i] = 10 + std::sin(θ);
+            clon[i] = 20 + std::cos(θ) / std::cos(10 * std::numbers::pi / 180);
+            ring[i] = static_cast<GeodesyTour::Id>(i);
+        }
+        const double circle = GeodesyTour::Length<H>(clat.data(), clon.data(), ring);
+        std::shuffle(ring.begin(), ring.end(), std::mt19937_64(631));
+        double len = GeodesyTour::Improve<H>(clat.data(), clon.data(), ring);
+        CHECK(Near(len, circle, 1e-9 * circle));
+        std::vector<GeodesyTour::Id> few{ 2, 0, 1 };
+        CHECK(GeodesyTour::Improve<H>(clat.data(), clon.data(), few) == GeodesyTour::Length<H>(clat.data(), clon.data(), few));
+    }
+
+    // Clustering ******************************************************************
+    /// <summary>
+    /// Brute-force DBSCAN with the documented rules: core points have
+    /// minPts points within eps (self included), core components are the
+    /// clusters, a border point joins the cluster of its nearest core point
+    /// within eps; clusters numbered by their first input point.
+    /// </summary>
+    template<class P>
+    GeodesyCluster::Result BruteDBSCAN(const Cloud& c, double eps, std::size_t minPts) {
+        const std::size_t n = c.lat.size();
+        std::vector<double> d(n * n);
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t j = 0; j < n; ++j) d[i * n + j] = P::Distance(c.lat[i], c.lon[i], c.lat[j], c.lon[j]);
+        auto near = [&](std::size_t i, std::size_t j) { return d[i * n + j] >= 0 && d[i * n + j] <= eps; };
+
+        GeodesyCluster::Result r;
+        std::vector<char> core(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            std::size_t k = 0;
+            for (std::size_t j = 0; j < n; ++j) k += near(i, j);
+            core[i] = k >= minPts;
+            r.core += core[i];
+        }
+        std::vector<std::size_t> comp(n, n);   // component: smallest index, by flood fill
+        for (std::size_t i = 0; i < n; ++i) {
+            if (!core[i] || comp[i] != n) continue;
+            std::vector<std::size_t> stack{ i };
+            comp[i] = i;
+            while (!stack.empty()) {
+                std::size_t a = stack.back();
+                stack.pop_back();
+                for (std::size_t b = 0; b < n; ++b)
+                    if (core[b] && comp[b] == n && near(a, b)) { comp[b] = i; stack.push_back(b); }
+            }
+        }
+        r.label.assign(n, GeodesyCluster::noise);
+        std::vector<std::int32_t> number(n, GeodesyCluster::noise);
+        for (std::size_t i = 0; i < n; ++i) {
+            std::size_t root = comp[i];
+            if (!core[i]) {
+                double best = std::numeric_limits<double>::infinity();
+                for (std::size_t j = 0; j < n; ++j)
+                    if (core[j] && near(i, j) && d[i * n + j] < best) { best = d[i * n + j]; root = comp[j]; }
+            }
+            if (root == n) continue;
+            if (number[root] == GeodesyCluster::noise) number[root] = static_cast<std::int32_t>(r.clusters++);
+            r.label[i] = number[root];
+        }
+        return r;
+    }
+
+    // hotspots of different density on a noise background, near a pole
+    // for one of the sets (index cells shrink in longitude there)
+    Cloud Hotspots(std::size_t n, std::uint64_t seed, double lat0) {
+        Cloud c(n, seed);
+        std::mt19937_64 rng(seed);
+        std::normal_distribution<double> g(0.0, 1.0);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        const double spot[][3] = { { 0.0, 0.0, 0.002 }, { 0.05, 0.08, 0.004 }, { -0.04, 0.1, 0.0005 }, { 0.02, -0.1, 0.006 } };
+        for (std::size_t i = 0; i < n; ++i) {
+            if (i % 5 == 4) { c.lat[i] = lat0 - 0.1 + 0.2 * u(rng); c.lon[i] = -0.3 + 0.6 * u(rng); continue; }
+            const auto& h = spot[i % 4];
+            c.lat[i] = lat0 + h[0] + h[2] * g(rng);
+            c.lon[i] = h[1] + h[2] * g(rng) / std::cos(lat0 * std::numbers::pi / 180);
+        }
+        return c;
+    }
+
+    void TestCluster() {
+        for (double lat0 : { 48.0, 89.5 }) {
+            const Cloud c = Hotspots(2500, 64, lat0);
+            for (auto [eps, minPts] : { std::pair<double, std::size_t>{ 150.0, 5 }, { 400.0, 20 }, { 60.0, 3 } }) {
+                const auto ref = BruteDBSCAN<H>(c, eps, minPts);
+                std::size_t noise = 0;
+                for (std::int32_t l : ref.label) noise += (l == GeodesyCluster::noise);
+                const std::size_t border = c.lat.size() - noise - ref.core;
+                CHECK(noise > 0 && border > 0 && ref.core > 0 && ref.clusters > 1);
+                for (unsigned threads : { 1u, 2u, 7u }) {
+                    GeodesyParallel::SetThreads(threads);
+                    const auto r = GeodesyCluster::DBSCAN<H>(c.lat.data(), c.lon.data(), c.lat.size(), eps, minPts);
+                    CHECK(r.label == ref.label && r.clusters == ref.clusters && r.core == ref.core);
+                }
+            }
+        }
+        // Vincenty: candidates by chord, confirmed with P::Distance; a border
+        // point may join another core within eps by chord, so core and noise
+        // labels must match, border labels be those of a core within eps
+        const Cloud c = Hotspots(1500, 641, 30.0);
+        const double eps = 200.0;
+        const auto ref = BruteDBSCAN<V>(c, eps, 6);
+        const auto r = GeodesyCluster::DBSCAN<V>(c.lat.data(), c.lon.data(), c.lat.size(), eps, 6);
+        GeodesyParallel::SetThreads(0);
+        CHECK(r.core == ref.core && r.clusters == ref.clusters);
+        const std::size_t n = c.lat.size();
+        std::vector<std::vector<std::size_t>> within(n);
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t j = 0; j < n; ++j) {
+                double d = V::Distance(c.lat[i], c.lon[i], c.lat[j], c.lon[j]);
+                if (d >= 0 && d <= eps) within[i].push_back(j);
+            }
+        std::size_t agree = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            bool ok = ref.label[i] == GeodesyCluster::noise ? r.label[i] == GeodesyCluster::noise : within[i].size() >= 6;
+            if (ref.label[i] != GeodesyCluster::noise && !ok)   // border: a core within eps of the same cluster
+                for (std::size_t j : within[i]) ok |= within[j].size() >= 6 && r.label[j] == r.label[i];
+            agree += ok && (r.label[i] == GeodesyCluster::noise) == (ref.label[i] == GeodesyCluster::noise);
+        }
+        CHECK(agree == c.lat.size());
+        CHECK(GeodesyCluster::DBSCAN<H>(c.lat.data(), c.lon.data(), 0, eps, 6).clusters == 0);
+    }
+
+    // Trajectories ****************************************************************
+    // random walk of n points from (lat, lon), steps of about step degrees
+    Cloud Walk(std::size_t n, std::uint64_t seed, double lat, double lon, double step) {
+        Cloud c(n, seed);
+        std::mt19937_64 rng(seed);
+        std::normal_distribution<double> g(0.0, step);
+        for (std::size_t i = 0; i < n; ++i) {
+            c.lat[i] = lat; c.lon[i] = lon;
+            lat = std::clamp(lat + g(rng), -89.0, 89.0);
+            lon += g(rng) + step / 2;
+            if (lon >= 180) lon -= 360;
+        }
+        return c;
+    }
+
+    // full n x m matrix of P::Distance, then the textbook recurrences
+    template<class P>
+    double BruteMeasure(GeodesyTrajectory::Measure measure, const Cloud& a, const Cloud& b) {
+        const std::size_t n = a.lat.size(), m = b.lat.size();
+        std::vector<double> d(n * m);
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t j = 0; j < m; ++j) d[i * m + j] = P::Distance(a.lat[i], a.lon[i], b.lat[j], b.lon[j]);
+        if (measure == GeodesyTrajectory::Measure::Hausdorff) {
+            double h = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                double best = std::numeric_limits<double>::infinity();
+                for (std::size_t j = 0; j < m; ++j) best = std::min(best, d[i * m + j]);
+                h = std::max(h, best);
+            }
+            for (std::size_t j = 0; j < m; ++j) {
+                double best = std::numeric_limits<double>::infinity();
+                for (std::size_t i = 0; i < n; ++i) best = std::min(best, d[i * m + j]);
+                h = std::max(h, best);
+            }
+            return h;
+        }
+        const bool sum = measure == GeodesyTrajectory::Measure::DTW;
+        std::vector<double> c(n * m);
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t j = 0; j < m; ++j) {
+                double reach = std::numeric_limits<double>::infinity();
+                if (i == 0 && j == 0) reach = 0;
+                if (i > 0) reach = std::min(reach, c[(i - 1) * m + j]);
+                if (j > 0) reach = std::min(reach, c[i * m + j - 1]);
+                if (i > 0 && j > 0) reach = std::min(reach, c[(i - 1) * m + j - 1]);
+                c[i * m + j] = sum ? reach + d[i * m + j] : std::max(reach, d[i * m + j]);
+            }
+        return c[n * m - 1];
+    }
+
+    template<class P>
+    void TrajectoryChecks() {
+        using Measure = GeodesyTrajectory::Measure;
+        const Measure measures[] = { Measure::Frechet, Measure::Hausdorff, Measure::DTW };
+        std::size_t exact = 0, cut = 0, kept = 0, many = 0, pairs = 0;
+        for (std::uint64_t seed = 0; seed < 12; ++seed) {
+            // similar tracks, a distant one, one over the antimeridian, a single point
+            const Cloud a = Walk(40 + seed * 7, 650 + seed, 40.0, -3.0, 0.01);
+            const Cloud b = (seed % 4 == 3) ? Walk(1, 6500 + seed, 40.1, -2.9, 0.01)
+                                            : Walk(25 + seed * 11, 6500 + seed, 40.0 + 0.02 * seed, -3.0, 0.012);
+            const Cloud e = Walk(30, 65000 + seed, -20.0, 179.8, 0.02), f = Walk(35, 650000 + seed, -20.05, 179.7, 0.02);
+            for (auto [x, y] : { std::pair<const Cloud*, const Cloud*>{ &a, &b }, { &e, &f }, { &a, &e } }) {
+                std::vector<double> lat(y->lat), lon(y->lon);
+                lat.insert(lat.end(), a.lat.begin(), a.lat.end());
+                lon.insert(lon.end(), a.lon.begin(), a.lon.end());
+                const std::size_t offsets[] = { 0, y->lat.size(), lat.size() };
+                for (Measure measure : measures) {
+                    ++pairs;
+                    const double ref = BruteMeasure<P>(measure, *x, *y);
+                    auto run = [&](double limit) {
+                        return GeodesyTrajectory::Compare<P>(measure, x->lat.data(), x->lon.data(), x->lat.size(),
+                                                             y->lat.data(), y->lon.data(), y->lat.size(), limit);
+                    };
+                    exact += Near(run(GeodesyTrajectory::inf<double>), ref, 1e-9 * ref);
+                    bool below = true;
+                    for (double k : { 0.999, 0.9, 0.5, 1e-3, 0.0 }) below = below && run(ref * k - 1e-6) == GeodesyTrajectory::inf<double>;
+                    cut += below;
+                    kept += Near(run(ref * 1.0001 + 1e-6), ref, 1e-9 * ref);
+                    double out[2];
+                    GeodesyTrajectory::ManyToOne<P>(measure, x->lat.data(), x->lon.data(), x->lat.size(),
+                                                    lat.data(), lon.data(), offsets, 2, out, ref * 1.0001 + 1e-6);
+                    many += Near(out[0], ref, 1e-9 * ref) &&
+                            (out[1] == GeodesyTrajectory::inf<double> || out[1] <= ref * 1.0001 + 1e-6);
+                }
+            }
+        }
+        CHECK(exact == pairs);   // the measure equals the full-matrix DP
+        CHECK(cut == pairs);     // any limit below it gives +infinity
+        CHECK(kept == pairs);    // a limit above it does not change it
+        CHECK(many == pairs);
+    }
+
+    // H counting its distance evaluations between prepared points
+    struct Counted : H {
+        static inline std::size_t calls = 0;
+        using H::Distance;
+        template<class T>
+        static T Distance(const GeodesyPolicy::Point<T>& p, const GeodesyPolicy::Point<T>& q) { ++calls; return H::Distance(p, q); }
+    };
+
+    void TestTrajectory() {
+        TrajectoryChecks<H>();
+        TrajectoryChecks<V>();
+        // pairs whose chord lower bound exceeds the limit are never evaluated
+        const Cloud a = Walk(60, 651, 40.0, -3.0, 0.01), e = Walk(50, 652, 40.0, -2.0, 0.01);
+        std::size_t none = 0;
+        for (auto measure : { GeodesyTrajectory::Measure::Frechet, GeodesyTrajectory::Measure::Hausdorff, GeodesyTrajectory::Measure::DTW }) {
+            Counted::calls = 0;
+            const double d = GeodesyTrajectory::Compare<Counted>(measure, a.lat.data(), a.lon.data(), a.lat.size(),
+                                                                 e.lat.data(), e.lon.data(), e.lat.size(), 1000.0);
+            none += d == GeodesyTrajectory::inf<double> && Counted::calls == 0;
+        }
+        CHECK(none == 3);
+        const double lat[] = { 1.0 };
+        CHECK(GeodesyTrajectory::Frechet<H>(lat, lat, 1, lat, lat, 0) == -1);
+        CHECK(GeodesyTrajectory::Hausdorff<H>(lat, lat, 0, lat, lat, 1) == -1);
+    }
+
+    // Segments ********************************************************************
+    template<class P>
+    void SegmentChecks(double tol) {
+        using S = GeodesySegment;
+        const double deg = P::Distance(0.0, 0.0, 0.0, 1.0);   // on the equator
+        // A -> B east along the equator: north is left (negative)
+        CHECK(Near(S::CrossTrack<P>(1.0, 5.0, 0.0, 0.0, 0.0, 10.0), -P::Distance(1.0, 5.0, 0.0, 5.0), tol));
+        CHECK(Near(S::CrossTrack<P>(-1.0, 5.0, 0.0, 0.0, 0.0, 10.0), P::Distance(-1.0, 5.0, 0.0, 5.0), tol));
+        CHECK(Near(S::CrossTrack<P>(-1.0, 5.0, 0.0, 10.0, 0.0, 0.0), -P::Distance(-1.0, 5.0, 0.0, 5.0), tol));
+        CHECK(Near(S::AlongTrack<P>(1.0, 5.0, 0.0, 0.0, 0.0, 10.0), 5 * deg, tol));
+        CHECK(Near(S::AlongTrack<P>(0.0, -3.0, 0.0, 0.0, 0.0, 10.0), -3 * deg, tol));
+        CHECK(Near(S::AlongTrack<P>(0.5, 13.0, 0.0, 0.0, 0.0, 10.0), 13 * deg, tol));
+        // ToSegment: the foot inside, else the nearer end point
+        CHECK(Near(S::ToSegment<P>(1.0, 5.0, 0.0, 0.0, 0.0, 10.0), P::Distance(1.0, 5.0, 0.0, 5.0), tol));
+        CHECK(Near(S::ToSegment<P>(1.0, -3.0, 0.0, 0.0, 0.0, 10.0), P::Distance(1.0, -3.0, 0.0, 0.0), tol));
+        CHECK(Near(S::ToSegment<P>(-2.0, 14.0, 0.0, 0.0, 0.0, 10.0), P::Distance(-2.0, 14.0, 0.0, 10.0), tol));
+        // meridian segment north: east is right (positive)
+        CHECK(S::CrossTrack<P>(45.0, 1.0, 40.0, 0.0, 50.0, 0.0) > 0 && S::CrossTrack<P>(45.0, -1.0, 40.0, 0.0, 50.0, 0.0) < 0);
+
+        // degenerate: A == B and A == -B have no great circle; distances to A
+        for (auto [lat2, lon2] : { std::pair<double, double>{ 30.0, 20.0 }, { -30.0, -160.0 } }) {
+            const double d = P::Distance(10.0, 40.0, 30.0, 20.0);
+            CHECK(Near(S::CrossTrack<P>(10.0, 40.0, 30.0, 20.0, lat2, lon2), d, tol));
+            CHECK(Near(S::ToSegment<P>(10.0, 40.0, 30.0, 20.0, lat2, lon2), d, tol));
+            CHECK(S::AlongTrack<P>(10.0, 40.0, 30.0, 20.0, lat2, lon2) == 0);
+        }
+
+        // random points and segments: |cross| <= to-segment <= end points,
+        // equal to |cross| where the foot falls within the segment; Vincenty
+        // locates the foot on the sphere, within the flattening
+        const double slack = P::boundF == 0 ? 1 : 1.005;
+        const Cloud c(6000, 66);
+        std::size_t bounded = 0, inside = 0, feet = 0;
+        for (std::size_t i = 0; i + 2 < c.lat.size(); i += 3) {
+            const double la = c.lat[i], lo = c.lon[i];
+            const double la1 = c.lat[i + 1], lo1 = c.lon[i + 1];
+            const double la2 = la1 + (c.lat[i + 2] - la1) * 0.1, lo2 = lo1 + (c.lon[i + 2] - lo1) * 0.1;
+            const double x = S::CrossTrack<P>(la, lo, la1, lo1, la2, lo2), t = S::ToSegment<P>(la, lo, la1, lo1, la2, lo2);
+            const double at = S::AlongTrack<P>(la, lo, la1, lo1, la2, lo2), len = P::Distance(la1, lo1, la2, lo2);
+            const double ends = std::min(P::Distance(la, lo, la1, lo1), P::Distance(la, lo, la2, lo2));
+            bounded += std::fabs(x) <= t * slack + tol && t <= ends * slack + tol;
+            if (at > 0 && at < len && std::fabs(x) < deg * 90) { ++feet; inside += Near(t, std::fabs(x), tol); }
+        }
+        CHECK(bounded == 2000);
+        CHECK(feet > 50 && inside == feet);
+
+        // Polyline::Distance against a scan of all segments
+        const Cloud w = Walk(600, 6600, 50.0, 170.0, 0.05);
+        const GeodesySegment::Polyline<P> line(w.lat.data(), w.lon.data(), w.lat.size());
+        const Cloud q = Walk(2000, 6601, 50.5, 170.5, 0.2);
+        std::vector<double> batch(q.lat.size());
+        line.Distance(q.lat.data(), q.lon.data(), q.lat.size(), batch.data());
+        std::size_t nearest = 0, same = 0;
+        for (std::size_t i = 0; i < q.lat.size(); ++i) {
+            double best = std::numeric_limits<double>::infinity();
+            for (std::size_t k = 0; k + 1 < w.lat.size(); ++k)
+                best = std::min(best, S::ToSegment<P>(q.lat[i], q.lon[i], w.lat[k], w.lon[k], w.lat[k + 1], w.lon[k + 1]));
+            const auto r = line.Distance(q.lat[i], q.lon[i]);
+            // Vincenty ranks the segments by the spherical chord
+            nearest += P::boundF == 0 ? Near(r.distance, best, tol) : (r.distance >= best - tol && r.distance <= best * 1.005 + tol);
+            same += batch[i] == r.distance;
+        }
+        CHECK(nearest == q.lat.size());
+        CHECK(same == q.lat.size());
+        CHECK(GeodesySegment::Polyline<P>(w.lat.data(), w.lon.data(), 0).Distance(1.0, 1.0).distance == -1);
+        CHECK(Near(GeodesySegment::Polyline<P>(w.lat.data(), w.lon.data(), 1).Distance(1.0, 1.0).distance,
+                   P::Distance(1.0, 1.0, w.lat[0], w.lon[0]), tol));
+    }
+
+    void TestSegment() {
+        SegmentChecks<H>(1e-6);
+        SegmentChecks<V>(1e-6);
+    }
+
+    // Areas ***********************************************************************
+    void TestArea() {
+        using VKm = GeodesyPolicy::Vincenty<>;
+        // 1 x 1 degree at the equator, counter-clockwise: R² Δλ sin 1° on
+        // the sphere, 12308.8 km² on WGS84 (great-circle edges: the
+        // northern one bulges north by well under 1 km²)
+        const double lat[] = { 0, 0, 1, 1 }, lon[] = { 0, 1, 1, 0 };
+        const double R = Km::Ellipsoid::R, rad = std::numbers::pi / 180;
+        CHECK(Near(GeodesyArea::Area<Km>(lat, lon, 4), R * R * rad * std::sin(rad), 1.0));
+        CHECK(Near(GeodesyArea::Area<Km>(lat, lon, 4), 12364.0, 1.0));
+        CHECK(Near(GeodesyArea::Area<VKm>(lat, lon, 4), 12308.8, 1.0));
+        // clockwise: the same area, negative
+        const double latCW[] = { 1, 1, 0, 0 };
+        CHECK(GeodesyArea::Area<Km>(latCW, lon, 4) == -GeodesyArea::Area<Km>(lat, lon, 4));
+        // over the antimeridian: the square moved there, by symmetry
+        const double lonX[] = { 179.5, -179.5, -179.5, 179.5 };
+        CHECK(Near(GeodesyArea::Area<Km>(lat, lonX, 4), GeodesyArea::Area<Km>(lat, lon, 4), 1e-6));
+        CHECK(Near(GeodesyArea::Area<VKm>(lat, lonX, 4), GeodesyArea::Area<VKm>(lat, lon, 4), 1e-6));
+        CHECK(Near(GeodesyArea::Perimeter<Km>(lat, lonX, 4), GeodesyArea::Perimeter<Km>(lat, lon, 4), 1e-9));
+
+        // cap north of 80N with 360 great-circle edges, both orientations:
+        // the sum of the pole triangles (L'Huilier on unit vectors)
+        std::vector<double> capLat(360, 80.0), capLon(360);
+        for (int i = 0; i < 360; ++i) capLon[i] = i - 180;
+        auto unit = [&](double la, double lo) {
+            return GeodesyPolicy::Vec3<double>{ std::cos(la * rad) * std::cos(lo * rad),
+                                                std::cos(la * rad) * std::sin(lo * rad), std::sin(la * rad) };
+        };
+        double cap = 0;
+        for (int i = 0; i < 360; ++i) {
+            auto a = unit(80.0, capLon[i]), b = unit(80.0, capLon[(i + 1) % 360]);
+            double triple = a.x * b.y - a.y * b.x;   // N . (A x B)
+            cap += 2 * std::atan2(triple, 1 + a.z + b.z + a.x * b.x + a.y * b.y + a.z * b.z);
+        }
+        cap *= R * R;
+        CHECK(Near(cap, 2 * std::numbers::pi * R * R * (1 - std::sin(80 * rad)), 1e-3 * cap));
+        CHECK(Near(GeodesyArea::Area<Km>(capLat.data(), capLon.data(), 360), cap, 1e-6 * cap));
+        std::reverse(capLon.begin(), capLon.end());
+        CHECK(Near(GeodesyArea::Area<Km>(capLat.data(), capLon.data(), 360), -cap, 1e-6 * cap));
+        // the same cap from lon 0: no crossing of the antimeridian inside
+        std::rotate(capLon.begin(), capLon.begin() + 77, capLon.end());
+        CHECK(Near(GeodesyArea::Area<Km>(capLat.data(), capLon.data(), 360), -cap, 1e-6 * cap));
+        // south: the 80S cap, counter-clockwise seen from the south is westward
+        std::vector<double> southLat(360, -80.0);
+        CHECK(Near(GeodesyArea::Area<Km>(southLat.data(), capLon.data(), 360), cap, 1e-6 * cap));
+        // ellipsoid: between the authalic cap of 80N and its great-circle form
+        std::reverse(capLon.begin(), capLon.end());
+        const double e2 = VKm::Ellipsoid::f * (2 - VKm::Ellipsoid::f), e = std::sqrt(e2), a = VKm::Ellipsoid::a / 1000;
+        auto q = [&](double s) { return (1 - e2) * (s / (1 - e2 * s * s) + std::atanh(e * s) / e); };
+        const double zone = std::numbers::pi * a * a * (q(1) - q(std::sin(80 * rad)));   // above the parallel
+        const double v = GeodesyArea::Area<VKm>(capLat.data(), capLon.data(), 360);
+        CHECK(v < zone && v > zone * (1 - 1e-3));
+
+        // streaming Ring, CSR batch: the same values
+        GeodesyArea::Ring<Km> ring;
+        for (int i = 0; i < 4; ++i) ring.Add(lat[i], lonX[i]);
+        CHECK(ring.Area() == GeodesyArea::Area<Km>(lat, lonX, 4));
+        const double bLat[] = { 0, 0, 1, 1, 0, 0, 1, 1 }, bLon[] = { 0, 1, 1, 0, 179.5, -179.5, -179.5, 179.5 };
+        const std::size_t offsets[] = { 0, 4, 8 };
+        double area[2], perimeter[2];
+        GeodesyArea::Batch<Km>(bLat, bLon, offsets, 2, area, perimeter);
+        CHECK(area[0] == GeodesyArea::Area<Km>(lat, lon, 4) && area[1] == GeodesyArea::Area<Km>(lat, lonX, 4));
+        CHECK(perimeter[1] == GeodesyArea::Perimeter<Km>(lat, lonX, 4));
+        CHECK(GeodesyArea::Area<Km>(lat, lon, 2) == 0);
+    }
+
+    // Polygons ********************************************************************
+    // star-shaped ring around (lat0, lon0): vertex k at bearing 360 k / n
+    // (clockwise), angular radius up to r degrees; reversed if ccw
+    void Star(std::vector<double>& lat, std::vector<double>& lon, std::mt19937_64& rng,
+              double lat0, double lon0, double r, std::size_t n, bool ccw) {
+        std::uniform_real_distribution<double> u(0.3, 1.0);
+        const double rad = std::numbers::pi / 180, φ0 = lat0 * rad;
+        std::vector<double> la(n), lo(n);
+        for (std::size_t k = 0; k < n; ++k) {
+            const double θ = 2 * std::numbers::pi * double(k) / double(n), δ = r * u(rng) * rad;
+            const double φ = std::asin(std::sin(φ0) * std::cos(δ) + std::cos(φ0) * std::sin(δ) * std::cos(θ));
+            la[k] = φ / rad;
+            if (std::fabs(lat0) == 90) { lo[k] = θ / rad - 180; continue; }   // bearings from a pole: longitudes
+            lo[k] = std::remainder(lon0 + std::atan2(std::sin(θ) * std::sin(δ) * std::cos(φ0),
+                                                     std::cos(δ) - std::sin(φ0) * std::sin(φ)) / rad, 360.0);
+        }
+        if (ccw) { std::reverse(la.begin(), la.end()); std::reverse(lo.begin(), lo.end()); }
+        lat.insert(lat.end(), la.begin(), la.end());
+        lon.insert(lon.end(), lo.begin(), lo.end());
+    }
+
+    /// <summary>
+    /// Spherical winding number reference: w = sum of the angles the edges
+    /// subtend at p / 2 pi is [p left of the ring] - [-p left of the ring];
+    /// for an inside within a hemisphere (no antipodal pair), p is inside
+    /// iff w has the sign of the ring's area (left: inside on the left)
+    /// </summary>
+    bool Winding(const double* lat, const double* lon, std::size_t n, bool left, double la, double lo) {
+        using Vec3 = GeodesyPolicy::Vec3<double>;
+        const double rad = std::numbers::pi / 180;
+        auto unit = [&](double a, double b) {
+            return Vec3{ std::cos(a * rad) * std::cos(b * rad), std::cos(a * rad) * std::sin(b * rad), std::sin(a * rad) };
+        };
+        auto dot = [](const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; };
+        const Vec3 p = unit(la, lo);
+        double sum = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            const Vec3 a = unit(lat[i], lon[i]), b = unit(lat[(i + 1) % n], lon[(i + 1) % n]);
+            const Vec3 x{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+            sum += std::atan2(dot(p, x), dot(a, b) - dot(p, a) * dot(p, b));
+        }
+        const long w = std::lround(sum / (2 * std::numbers::pi));
+        return w != 0 && (w > 0) == left;
+    }
+
+    void TestPolygon() {
+        using Polygon = GeodesyPolygon<H>;
+        std::mt19937_64 rng(68);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        std::vector<double> lat, lon;
+        std::vector<std::size_t> offsets{ 0 };
+        auto add = [&](double lat0, double lon0, double r, std::size_t n, bool ccw) {
+            Star(lat, lon, rng, lat0, lon0, r, n, ccw);
+            offsets.push_back(lat.size());
+        };
+        // polar (around either pole), antimeridian, both orientations
+        add(90.0, 0.0, 12.0, 360, true);
+        add(90.0, 0.0, 12.0, 97, false);
+        add(-90.0, 0.0, 30.0, 40, true);
+        add(-88.0, 170.0, 5.0, 23, false);
+        add(10.0, 180.0, 8.0, 50, true);
+        add(-35.0, -179.0, 3.0, 7, false);
+        add(0.0, 0.0, 60.0, 200, true);
+        for (int k = 0; k < 150; ++k) {
+            const Cloud c(1, 6800 + k);
+            add(c.lat[0], c.lon[0], 0.5 + 15 * u(rng), 3 + std::size_t(60 * u(rng)), k % 2 == 0);
+        }
+        const std::size_t count = offsets.size() - 1;
+
+        // queries: uniform, and around each polygon's first vertex
+        Cloud q(5000, 6801);
+        for (std::size_t k = 0; k < count; ++k)
+            for (int j = 0; j < 20; ++j) {
+                const std::size_t v = offsets[k] + std::size_t(u(rng) * double(offsets[k + 1] - offsets[k]));
+                q.lat.push_back(std::clamp(lat[v] + 4 * (u(rng) - 0.5), -90.0, 90.0));
+                q.lon.push_back(lon[v] + 4 * (u(rng) - 0.5));
+            }
+
+        std::size_t agree = 0, inside = 0, tests = 0;
+        for (std::size_t k = 0; k < count; ++k) {
+            const std::size_t n = offsets[k + 1] - offsets[k];
+            const Polygon poly(lat.data() + offsets[k], lon.data() + offsets[k], n);
+            const bool left = GeodesyArea::Area<Km>(lat.data() + offsets[k], lon.data() + offsets[k], n) > 0;
+            std::vector<std::uint8_t> batch(q.lat.size());
+            poly.Contains(q.lat.data(), q.lon.data(), q.lat.size(), batch.data());
+            for (std::size_t i = 0; i < q.lat.size(); ++i) {
+                const bool ref = Winding(lat.data() + offsets[k], lon.data() + offsets[k], n, left, q.lat[i], q.lon[i]);
+                ++tests;
+                inside += ref;
+                agree += poly.Contains(q.lat[i], q.lon[i]) == ref && bool(batch[i]) == ref;
+            }
+        }
+        CHECK(inside > 1000);
+        CHECK(agree == tests);
+        // the poles, and a closing vertex repeated
+        const Polygon north(lat.data(), lon.data(), offsets[1]);
+        CHECK(north.Contains(90.0, 0.0) && !north.Contains(-90.0, 0.0));
+        const Polygon south(lat.data() + offsets[2], lon.data() + offsets[2], offsets[3] - offsets[2]);
+        CHECK(south.Contains(-90.0, 0.0) && !south.Contains(90.0, 0.0));
+        const double sqLat[] = { 0, 0, 1, 1, 0 }, sqLon[] = { 0, 1, 1, 0, 0 };
+        CHECK(Polygon(sqLat, sqLon, 5).Vertices() == 4 && Polygon(sqLat, sqLon, 5).Contains(0.5, 0.5));
+        CHECK(!Polygon(sqLat, sqLon, 2).Contains(0.0, 0.5));
+        // both poles inside, the ring crossing no meridian an odd number of
+        // times: the caps above 60 degrees joined by a 20-degree strip
+        // through 0 degrees, in either orientation
+        std::vector<double> capLat, capLon;
+        for (int l = 10; l <= 350; l += 10) { capLat.push_back(60); capLon.push_back(l); }
+        for (int l = 350; l >= 10; l -= 10) { capLat.push_back(-60); capLon.push_back(l); }
+        for (int ccw = 0; ccw < 2; ++ccw) {
+            const Polygon poles(capLat.data(), capLon.data(), capLat.size());
+            CHECK(poles.Contains(90.0, 0.0) && poles.Contains(-90.0, 0.0) && poles.Contains(0.0, 0.0) && poles.Contains(75.0, 180.0));
+            CHECK(!poles.Contains(0.0, 180.0) && !poles.Contains(30.0, 90.0) && !poles.Contains(-50.0, -20.0));
+            std::reverse(capLat.begin(), capLat.end());
+            std::reverse(capLon.begin(), capLon.end());
+        }
+
+        // Set::Containing against a linear scan over the polygons
+        const Polygon::Set set(lat.data(), lon.data(), offsets.data(), count);
+        std::size_t same = 0, hits = 0;
+        for (std::size_t i = 0; i < q.lat.size(); ++i) {
+            std::vector<std::uint32_t> scan;
+            for (std::size_t k = 0; k < count; ++k)
+                if (set[k].Contains(q.lat[i], q.lon[i])) scan.push_back(static_cast<std::uint32_t>(k));
+            hits += scan.size();
+            same += set.Containing(q.lat[i], q.lon[i]) == scan;
+        }
+        CHECK(hits > 1000 && same == q.lat.size());
+        std::vector<std::size_t> csr;
+        std::vector<std::uint32_t> ids;
+        set.Containing(q.lat.data(), q.lon.data(), q.lat.size(), csr, ids);
+        std::size_t rows = 0;
+        for (std::size_t i = 0; i < q.lat.size(); ++i)
+            rows += std::vector<std::uint32_t>(ids.begin() + csr[i], ids.begin() + csr[i + 1]) == set.Containing(q.lat[i], q.lon[i]);
+        CHECK(rows == q.lat.size());
+    }
+
+    // Intersections ***************************************************************
+    // separation at time t of two objects on the sphere
+    double Separation(const GeodesyIntersect::Motion<double>& m1, const GeodesyIntersect::Motion<double>& m2, double t) {
+        const double rad = std::numbers::pi / 180;
+        auto at = [&](const GeodesyIntersect::Motion<double>& m) {
+            const double σ = m.speed * t / Km::Ellipsoid::R, φ = m.lat * rad, θ = m.bearing * rad;
+            const double φ2 = std::asin(std::sin(φ) * std::cos(σ) + std::cos(φ) * std::sin(σ) * std::cos(θ));
+            const double λ2 = m.lon * rad + std::atan2(std::sin(θ) * std::sin(σ) * std::cos(φ), std::cos(σ) - std::sin(φ) * std::sin(φ2));
+            return std::pair<double, double>{ φ2 / rad, λ2 / rad };
+        };
+        auto [la1, lo1] = at(m1);
+        auto [la2, lo2] = at(m2);
+        return Km::Distance(la1, lo1, la2, lo2);
+    }
+
+    // closest approach by sampling the separation (a fine grid, then a
+    // golden-section search around the smallest sample)
+    double SampledApproach(const GeodesyIntersect::Motion<double>& m1, const GeodesyIntersect::Motion<double>& m2,
+                           double horizon, std::size_t samples) {
+        auto sep = [&](double t) { return Separation(m1, m2, t); };
+        double best = std::numeric_limits<double>::infinity(), tBest = 0;
+        for (std::size_t k = 0; k <= samples; ++k) {
+            double t = horizon * double(k) / double(samples), d = sep(t);
+            if (d < best) { best = d; tBest = t; }
+        }
+        double a = std::max(0.0, tBest - horizon / double(samples)), b = std::min(horizon, tBest + horizon / double(samples));
+        for (int it = 0; it < 100; ++it) {
+            double c = b - (b - a) * 0.618033988749895, d = a + (b - a) * 0.618033988749895;
+            if (sep(c) < sep(d)) b = d; else a = c;
+        }
+        return std::min(best, sep((a + b) / 2));
+    }
+
+    void TestIntersect() {
+        using I = GeodesyIntersect;
+        const double deg = Km::Distance(0.0, 0.0, 0.0, 1.0);
+        // equator and the meridian of 5E cross at (0, 5) and (0, -175)
+        auto g = I::GreatCircles<Km>(0.0, 0.0, 0.0, 10.0, -10.0, 5.0, 10.0, 5.0);
+        CHECK(g.count == 2 && Near(g.lat[0], 0, 1e-12) && Near(g.lon[0], 5, 1e-12) && Near(g.along[0], 5 * deg, 1e-9));
+        CHECK(Near(g.lat[1], 0, 1e-12) && Near(g.lon[1], -175, 1e-12) && Near(g.along[1], 185 * deg, 1e-9));
+        // heading west, the first crossing met is the antipode
+        g = I::GreatCircles<Km>(0.0, 0.0, 0.0, -10.0, -10.0, 5.0, 10.0, 5.0);
+        CHECK(g.count == 2 && Near(g.lon[0], -175, 1e-12) && Near(g.along[0], 175 * deg, 1e-9));
+        CHECK(I::GreatCircles<Km>(0.0, 0.0, 0.0, 10.0, 0.0, 20.0, 0.0, 30.0).count == 0);   // the same circle
+        CHECK(I::GreatCircles<Km>(0.0, 0.0, 0.0, 0.0, 0.0, 20.0, 0.0, 30.0).count == 0);    // undefined
+
+        auto x = I::Segments<Km>(0.0, 0.0, 0.0, 10.0, -10.0, 5.0, 10.0, 5.0);
+        CHECK(x.count == 1 && Near(x.lat[0], 0, 1e-12) && Near(x.lon[0], 5, 1e-12) && Near(x.along[0], 5 * deg, 1e-9));
+        CHECK(I::Segments<Km>(0.0, 0.0, 0.0, 10.0, -10.0, 20.0, 10.0, 20.0).count == 0);   // circles cross beyond
+        CHECK(I::Segments<Km>(0.0, 0.0, 0.0, 10.0, 1.0, 5.0, 10.0, 5.0).count == 0);       // short of the equator
+        x = I::Segments<Km>(0.0, 0.0, 0.0, 10.0, 0.0, 10.0, 10.0, 10.0);                   // end points touch
+        CHECK(x.count == 1 && Near(x.lon[0], 10, 1e-9) && Near(x.along[0], 10 * deg, 1e-6));
+        // over the antimeridian
+        x = I::Segments<Km>(10.0, 175.0, -10.0, -175.0, -10.0, 175.0, 10.0, -175.0);
+        CHECK(x.count == 1 && Near(x.lat[0], 0, 1e-12) && Near(std::fabs(x.lon[0]), 180, 1e-12));
+
+        // circle of 1 degree around (0, 5) on the equator: enters at 4E, leaves at 6E;
+        // around (0.5, 5): at 5 -+ acos(cos 1 / cos 0.5)
+        auto c = I::SmallCircle<Km>(0.0, 0.0, 0.0, 10.0, 0.0, 5.0, deg);
+        CHECK(c.count == 2 && Near(c.lon[0], 4, 1e-9) && Near(c.lon[1], 6, 1e-9) && Near(c.along[0], 4 * deg, 1e-6));
+        const double δ = std::acos(std::cos(std::numbers::pi / 180) / std::cos(std::numbers::pi / 360)) * 180 / std::numbers::pi;
+        c = I::SmallCircle<Km>(0.0, 0.0, 0.0, 10.0, 0.5, 5.0, deg);
+        CHECK(c.count == 2 && Near(c.lon[0], 5 - δ, 1e-9) && Near(c.lon[1], 5 + δ, 1e-9));
+        c = I::SmallCircle<Km>(0.0, 0.0, 0.0, 5.0, 0.0, 5.0, deg);                          // ends inside
+        CHECK(c.count == 1 && Near(c.lon[0], 4, 1e-9));
+        CHECK(I::SmallCircle<Km>(0.0, 0.0, 0.0, 10.0, 2.0, 5.0, deg).count == 0);
+        const double la1[] = { 0.0, 0.0 }, lo1[] = { 0.0, 5.5 }, la2[] = { 0.0, 0.0 }, lo2[] = { 10.0, 10.0 };
+        double enter[2], exit[2];
+        I::SmallCircle<Km>(la1, lo1, la2, lo2, 2, 0.0, 5.0, deg, enter, exit);
+        CHECK(Near(enter[0], 4 * deg, 1e-6) && Near(exit[0], 6 * deg, 1e-6) && enter[1] == -1 && Near(exit[1], 0.5 * deg, 1e-6));
+
+        // head-on on the equator: they meet at t = 5; north on two
+        // meridians: they meet at the pole, t = 90
+        auto r = I::ClosestApproach<Km>(I::Motion<double>{ 0, 0, 90, deg }, I::Motion<double>{ 0, 10, 270, deg }, 20.0);
+        CHECK(Near(r.time, 5, 1e-9) && Near(r.distance, 0, 1e-6) && Near(r.lon1, 5, 1e-9));
+        r = I::ClosestApproach<Km>(I::Motion<double>{ 0, 0, 0, deg }, I::Motion<double>{ 0, 1, 0, deg }, 200.0);
+        CHECK(Near(r.time, 90, 1e-6) && Near(r.distance, 0, 1e-6) && Near(r.lat1, 90, 1e-6));
+        r = I::ClosestApproach<Km>(I::Motion<double>{ 0, 0, 0, deg }, I::Motion<double>{ 0, 1, 0, deg }, 30.0);
+        CHECK(r.time == 30.0);                                                               // not reached: the horizon
+        CHECK(I::ClosestApproach<Km>(I::Motion<double>{ 0, 0, 0, -1 }, I::Motion<double>{ 0, 1, 0, deg }, 30.0).time == -1);
+
+        // random movers, some turning hundreds of times over the horizon
+        // (past 4096 pieces of pi/8): against a sampled separation
+        std::mt19937_64 rng(69);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        std::size_t found = 0;
+        for (int k = 0; k < 24; ++k) {
+            const double laps = (k % 3 == 2) ? 300 : 0.2 + 2 * u(rng);
+            I::Motion<double> m1{ 80 * u(rng) - 40, 360 * u(rng) - 180, 360 * u(rng), 800 };
+            I::Motion<double> m2{ m1.lat + 10 * u(rng) - 5, m1.lon + 10 * u(rng) - 5, 360 * u(rng), 500 + 500 * u(rng) };
+            const double horizon = laps * 2 * std::numbers::pi * Km::Ellipsoid::R / 800;
+            const auto a = I::ClosestApproach<Km>(m1, m2, horizon);
+            const double ref = SampledApproach(m1, m2, horizon, std::size_t(2000 * laps) + 2000);
+            // never worse than the samples, and the separation at its time
+            found += a.distance <= ref + 1e-6 && Near(a.distance, Separation(m1, m2, a.time), 1e-6) &&
+                     a.time >= 0 && a.time <= horizon;
+        }
+        CHECK(found == 24);
+    }
+
+    // Simplification **************************************************************
+    // every dropped point within tolerance of the kept segment spanning it
+    template<class P>
+    bool Spanned(const Cloud& w, const std::vector<std::uint8_t>& keep, double tolerance) {
+        std::size_t a = 0;
+        for (std::size_t b = 1; b < keep.size(); ++b) {
+            if (!keep[b]) continue;
+            for (std::size_t i = a + 1; i < b; ++i)
+                if (GeodesySegment::ToSegment<P>(w.lat[i], w.lon[i], w.lat[a], w.lon[a], w.lat[b], w.lon[b]) > tolerance * (1 + 1e-9)) return false;
+            a = b;
+        }
+        return keep.front() && keep.back();
+    }
+
+    // Visvalingam by repeated minimum search: effective areas raised to
+    // the area of the point removed before them
+    std::vector<std::uint8_t> BruteVisvalingam(const Cloud& w, double tolerance) {
+        using K = GeodesyKernels;
+        const std::size_t n = w.lat.size();
+        std::vector<GeodesyPolicy::Vec3<double>> v(n);
+        for (std::size_t i = 0; i < n; ++i) v[i] = K::UnitVector<H::Math>(w.lat[i], w.lon[i]);
+        auto excess = [&](std::size_t a, std::size_t b, std::size_t c) {
+            return 2 * std::atan2(std::fabs(K::Dot(v[a], K::Cross(v[b], v[c]))), 1 + K::Dot(v[a], v[b]) + K::Dot(v[b], v[c]) + K::Dot(v[c], v[a]));
+        };
+        const double R = H::Ellipsoid::R * H::Units::perKm, limit = tolerance / (R * R);
+        std::vector<std::size_t> alive(n);
+        for (std::size_t i = 0; i < n; ++i) alive[i] = i;
+        std::vector<double> eff(n, 0);
+        for (std::size_t i = 1; i + 1 < n; ++i) eff[i] = excess(i - 1, i, i + 1);
+        std::vector<std::uint8_t> keep(n, 1);
+        while (alive.size() > 2) {
+            std::size_t k = 1;
+            for (std::size_t j = 2; j + 1 < alive.size(); ++j) if (eff[alive[j]] < eff[alive[k]]) k = j;
+            const double area = eff[alive[k]];
+            if (!(area < limit)) break;
+            keep[alive[k]] = 0;
+            alive.erase(alive.begin() + std::ptrdiff_t(k));
+            for (std::size_t j : { k - 1, k })
+                if (j > 0 && j + 1 < alive.size()) eff[alive[j]] = std::max(excess(alive[j - 1], alive[j], alive[j + 1]), area);
+        }
+        return keep;
+    }
+
+    void TestSimplify() {
+        const double tolerances[] = { 0.0, 20.0, 100.0, 500.0, 5000.0, 1e9 };
+        std::size_t spanned = 0, nested = 0, brute = 0, streamed = 0, runs = 0;
+        std::vector<double> lat, lon;
+        std::vector<std::size_t> offsets{ 0 };
+        for (std::uint64_t seed = 0; seed < 8; ++seed) {
+            // tracks at mid latitude, near the pole, over the antimeridian
+            const Cloud w = Walk(300 + 50 * seed, 700 + seed, seed % 3 == 1 ? 88.5 : 45.0, seed % 3 == 2 ? 179.0 : 10.0, 0.002);
+            lat.insert(lat.end(), w.lat.begin(), w.lat.end());
+            lon.insert(lon.end(), w.lon.begin(), w.lon.end());
+            offsets.push_back(lat.size());
+            const std::size_t n = w.lat.size();
+            std::vector<std::uint8_t> dp(n), vw(n), dpLast(n, 1), vwLast(n, 1);
+            for (double t : tolerances) {
+                ++runs;
+                std::size_t kept = GeodesySimplify::DouglasPeucker<H>(w.lat.data(), w.lon.data(), n, t, dp.data());
+                spanned += Spanned<H>(w, dp, t) && kept == std::size_t(std::count(dp.begin(), dp.end(), 1));
+                // a larger tolerance keeps a subset (both stop their fixed order earlier)
+                kept = GeodesySimplify::Visvalingam<H>(w.lat.data(), w.lon.data(), n, t * t, vw.data());
+                bool subset = kept == std::size_t(std::count(vw.begin(), vw.end(), 1));
+                for (std::size_t i = 0; i < n; ++i) subset = subset && dp[i] <= dpLast[i] && vw[i] <= vwLast[i];
+                nested += subset;
+                brute += vw == BruteVisvalingam(w, t * t);
+                dpLast = dp; vwLast = vw;
+
+                GeodesySimplify::Stream<H> stream(t, 64);
+                std::vector<std::uint8_t> st(n, 0);
+                auto emit = [&](double, double, std::size_t i) { st[i] = 1; };
+                for (std::size_t i = 0; i < n; ++i) stream.Add(w.lat[i], w.lon[i], emit);
+                stream.Flush(emit);
+                streamed += Spanned<H>(w, st, t);
+            }
+            CHECK(std::count(dp.begin(), dp.end(), 1) == 2 && std::count(vw.begin(), vw.end(), 1) == 2);
+        }
+        CHECK(spanned == runs);
+        CHECK(nested == runs);
+        CHECK(brute == runs);
+        CHECK(streamed == runs);
+
+        // CSR batch: the same points as one track at a time
+        std::vector<std::uint8_t> batch(lat.size()), one(lat.size());
+        const std::size_t count = offsets.size() - 1;
+        std::size_t total = GeodesySimplify::DouglasPeucker<H>(lat.data(), lon.data(), offsets.data(), count, 100.0, batch.data()), sum = 0;
+        for (std::size_t k = 0; k < count; ++k)
+            sum += GeodesySimplify::DouglasPeucker<H>(lat.data() + offsets[k], lon.data() + offsets[k], offsets[k + 1] - offsets[k], 100.0, one.data() + offsets[k]);
+        CHECK(total == sum && batch == one);
+        total = GeodesySimplify::Visvalingam<H>(lat.data(), lon.data(), offsets.data(), count, 1e4, batch.data()), sum = 0;
+        for (std::size_t k = 0; k < count; ++k)
+            sum += GeodesySimplify::Visvalingam<H>(lat.data() + offsets[k], lon.data() + offsets[k], offsets[k + 1] - offsets[k], 1e4, one.data() + offsets[k]);
+        CHECK(total == sum && batch == one);
+    }
+
+    // Ranking *********************************************************************
+    template<class P>
+    void NearestChecks(const Cloud& c, const Cloud& origins) {
+        const std::size_t n = c.lat.size(), k = 25;
+        std::size_t same = 0;
+        std::vector<std::uint32_t> index(k), batchIndex(origins.lat.size() * k);
+        std::vector<double> distance(k), batchDistance(origins.lat.size() * k);
+        GeodesyRank::Nearest<P>(origins.lat.data(), origins.lon.data(), origins.lat.size(),
+                                c.lat.data(), c.lon.data(), n, k, batchIndex.data(), batchDistance.data());
+        for (std::size_t q = 0; q < origins.lat.size(); ++q) {
+            // all distances, sorted by (distance, index)
+            std::vector<std::pair<double, std::uint32_t>> all;
+            for (std::size_t i = 0; i < n; ++i) {
+                double d = P::Distance(origins.lat[q], origins.lon[q], c.lat[i], c.lon[i]);
+                if (d >= 0) all.emplace_back(d, static_cast<std::uint32_t>(i));
+            }
+            std::sort(all.begin(), all.end());
+            bool ok = true;
+            for (unsigned threads : { 1u, 2u, 7u }) {
+                GeodesyParallel::SetThreads(threads);
+                const std::size_t found = GeodesyRank::Nearest<P>(origins.lat[q], origins.lon[q], c.lat.data(), c.lon.data(), n,
+                                                                  k, index.data(), distance.data());
+                ok = ok && found == std::min(k, all.size());
+                for (std::size_t j = 0; j < found && ok; ++j)
+                    ok = index[j] == all[j].second && distance[j] == all[j].first &&
+                         batchIndex[q * k + j] == all[j].second && batchDistance[q * k + j] == all[j].first;
+            }
+            GeodesyParallel::SetThreads(0);
+            same += ok;
+        }
+        CHECK(same == origins.lat.size());
+    }
+
+    void TestRank() {
+        // candidates with duplicates (ties broken by index) and an invalid one
+        Cloud c(40000, 71);   // over the grain: split between threads
+        for (std::size_t i = 0; i < 300; ++i) { c.lat.push_back(c.lat[i * 7]); c.lon.push_back(c.lon[i * 7]); }
+        c.lat[5] = 100;
+        Cloud origins(40, 710);
+        for (std::size_t i = 0; i < 10; ++i) { origins.lat.push_back(c.lat[i * 7]); origins.lon.push_back(c.lon[i * 7]); }
+        NearestChecks<H>(c, origins);
+        NearestChecks<V>(c, origins);
+
+        std::uint32_t index[4];
+        double distance[4];
+        CHECK(GeodesyRank::Nearest<H>(0.0, 0.0, c.lat.data(), c.lon.data(), 3, 4, index, distance) == 3);
+        CHECK(GeodesyRank::Nearest<H>(0.0, 0.0, c.lat.data(), c.lon.data(), c.lat.size(), 0, index, distance) == 0);
+    }
+
+    // radix Sort against std::stable_sort of its own keys; keys against
+    // the distances
+    template<class P, class T>
+    void SortChecks(const Cloud& c, double tol) {
+        const std::size_t n = c.lat.size();
+        std::vector<T> lat(c.lat.begin(), c.lat.end()), lon(c.lon.begin(), c.lon.end()), key(n);
+        std::vector<std::uint32_t> order(n);
+        GeodesyRank::Sort<P>(T(48.1), T(11.6), lat.data(), lon.data(), n, order.data(), key.data());
+        std::vector<T> keyOf(n);
+        std::vector<std::uint8_t> seen(n, 0);
+        for (std::size_t j = 0; j < n; ++j) { keyOf[order[j]] = key[j]; seen[order[j]] = 1; }
+        CHECK(std::count(seen.begin(), seen.end(), 1) == std::ptrdiff_t(n));   // a permutation
+        // failed keys (negative or NaN) last
+        auto rank = [](T k) { return k >= 0 ? 0 : 1; };
+        std::vector<std::uint32_t> ref(n);
+        for (std::size_t i = 0; i < n; ++i) ref[i] = static_cast<std::uint32_t>(i);
+        std::stable_sort(ref.begin(), ref.end(), [&](std::uint32_t a, std::uint32_t b) {
+            if (rank(keyOf[a]) != rank(keyOf[b])) return rank(keyOf[a]) < rank(keyOf[b]);
+            return rank(keyOf[a]) == 0 && keyOf[a] < keyOf[b];
+        });
+        std::size_t failed = 0, close = 0;
+        for (std::size_t j = 0; j < n; ++j) {
+            failed += !(key[j] >= 0);
+            const T d = P::Distance(T(48.1), T(11.6), lat[order[j]], lon[order[j]]);
+            close += !(key[j] >= 0) ? !(d >= 0) : Near(double(GeodesyRank::FromKey<P>(key[j])), double(d), tol * (1 + double(d)));
+        }
+        bool stable = true;
+        for (std::size_t j = 0; j < n && stable; ++j) stable = order[j] == ref[j] || (!(key[j] >= 0) && !(keyOf[ref[j]] >= 0));
+        CHECK(stable);
+        CHECK(close == n);
+        CHECK(failed == 20 && std::is_sorted(key.begin(), key.end() - std::ptrdiff_t(failed)));
+        std::vector<T> distance(n);
+        GeodesyRank::FromKey<P>(key.data(), n, distance.data());
+        CHECK(distance[n / 2] == GeodesyRank::FromKey<P>(key[n / 2]));
+    }
+
+    void TestSort() {
+        // duplicates: equal keys keep the index order; invalid points last
+        Cloud c(50000, 72);
+        for (std::size_t i = 0; i < 5000; ++i) { c.lat.push_back(c.lat[i * 3]); c.lon.push_back(c.lon[i * 3]); }
+        for (std::size_t i = 0; i < 20; ++i) c.lat[i * 101] = std::numeric_limits<double>::quiet_NaN();
+        // nearby points share high key bits (skipped radix digits)
+        const Cloud near = Walk(20000, 720, 48.1, 11.6, 1e-4);
+        c.lat.insert(c.lat.end(), near.lat.begin(), near.lat.end());
+        c.lon.insert(c.lon.end(), near.lon.begin(), near.lon.end());
+        SortChecks<H, double>(c, 1e-9);
+        SortChecks<V, double>(c, 1e-9);
+        SortChecks<H, float>(c, 1e-3);
+    }
+
+    // Tracking ********************************************************************
+    template<class P>
+    void TrackerChecks() {
+        using Tracker = GeodesyTracker<P>;
+        const double unit = P::Units::perKm;   // 1 km in P::Units
+        // targets around the objects, far away, near their antipodes, at a pole
+        Cloud t(60, 73);
+        for (std::size_t i = 0; i < 20; ++i) { t.lat[i] = 47 + 2 * std::sin(double(i)); t.lon[i] = 8 + 2 * std::cos(1.7 * double(i)); }
+        for (std::size_t i = 20; i < 30; ++i) { t.lat[i] = -47 + 0.01 * double(i); t.lon[i] = -172 - 0.01 * double(i); }
+        t.lat[30] = 90; t.lon[30] = 0;
+        std::vector<double> radius(t.lat.size());
+        for (std::size_t i = 0; i < radius.size(); ++i) radius[i] = (5 + 10 * double(i % 7)) * unit;
+        Tracker a(t.lat.data(), t.lon.data(), t.lat.size(), radius.data(), 50 * unit);
+        Tracker b(t.lat.data(), t.lon.data(), t.lat.size(), radius.data(), 50 * unit);
+
+        std::mt19937_64 rng(730);
+        std::normal_distribution<double> g(0.0, 1.0);
+        const std::size_t objects = 40;
+        std::vector<double> lat(objects), lon(objects);
+        for (std::size_t k = 0; k < objects; ++k) {
+            lat[k] = 47 + 2 * g(rng); lon[k] = 8 + 2 * g(rng);
+            if (k == 0) lat[k] = 89.9;            // next to a target at the pole
+            a.Add(lat[k], lon[k]);
+            b.Add(lat[k], lon[k]);
+        }
+        std::size_t bounded = 0, estimates = 0, pairs = 0, states = 0, events = 0;
+        std::vector<std::uint32_t> id(objects);
+        for (std::size_t k = 0; k < objects; ++k) id[k] = static_cast<std::uint32_t>(k);
+        for (int step = 0; step < 60; ++step) {
+            // small steps, and now and then a jump past maxShift
+            const double size = (step % 20 == 19) ? 0.8 : 0.02 * (1 + step % 5);
+            for (std::size_t k = 0; k < objects; ++k) {
+                lat[k] = std::clamp(lat[k] + size * g(rng), -89.99, 89.99);
+                lon[k] += size * g(rng);
+            }
+            std::vector<typename Tracker::Event> one, batch;
+            for (std::size_t k = 0; k < objects; ++k) a.Move(k, lat[k], lon[k], [&](const typename Tracker::Event& e) { one.push_back(e); });
+            b.Move(id.data(), lat.data(), lon.data(), objects, [&](const typename Tracker::Event& e) { batch.push_back(e); });
+            events += one.size();
+            bool same = one.size() == batch.size();
+            for (std::size_t i = 0; i < one.size() && same; ++i)
+                same = one[i].object == batch[i].object && one[i].target == batch[i].target && one[i].inside == batch[i].inside;
+            CHECK(same);
+            for (std::size_t k = 0; k < objects; ++k)
+                for (std::size_t j = 0; j < t.lat.size(); ++j) {
+                    double bound = -1;
+                    const double d = a.Distance(k, j, &bound), x = a.Exact(k, j);
+                    if (x < 0) continue;    // Vincenty without convergence next to the antipode
+                    ++pairs;
+                    estimates += d >= 0;
+                    bounded += d >= 0 && bound >= 0 && std::fabs(d - x) <= bound;
+                    states += a.Inside(k, j) == (x <= radius[j]) && b.Inside(k, j) == a.Inside(k, j);
+                }
+        }
+        CHECK(bounded == estimates); // |estimate - exact| <= bound
+        CHECK(estimates > pairs / 2);
+        CHECK(states == pairs);    // inside states follow the exact distance
+        CHECK(events > 50);
+    }
+
+    void TestTracker() {
+        TrackerChecks<H>();
+        TrackerChecks<V>();
+        TrackerChecks<Km>();
+    }
+
+    // Geofences *******************************************************************
+    // without a margin an object is in exactly the fences containing its
+    // position: circles by P::Distance, polygons by GeodesyPolygon
+    template<class P>
+    void FenceChecks() {
+        struct Ref { double lat, lon, radius; std::size_t shape; };    // shape: polygon, or none for a circle
+        constexpr std::size_t none = ~std::size_t{ 0 };
+        const double unit = P::Units::perKm / 1000;                    // meters to P::Units
+        std::mt19937_64 rng(740);
+        std::uniform_real_distribution<double> u(-1.0, 1.0);
+        GeodesyFence<P> a, b;                                          // single and batch updates
+        std::vector<Ref> ref;
+        std::vector<GeodesyPolygon<P>> shape;
+        for (int k = 0; k < 200; ++k) {
+            const double la = 45 + 3 * u(rng), lo = 10 + 4 * u(rng), r = (21000 + 19000 * u(rng)) * unit;
+            a.AddCircle(la, lo, r); b.AddCircle(la, lo, r);
+            ref.push_back({ la, lo, r, none });
+        }
+        a.AddCircle(40.0, 0.0, 3e6 * unit); b.AddCircle(40.0, 0.0, 3e6 * unit);     // too large for the grid
+        ref.push_back({ 40.0, 0.0, 3e6 * unit, none });
+        for (int k = 0; k < 21; ++k) {
+            std::vector<double> la, lo;
+            const bool big = k == 20;
+            Star(la, lo, rng, 45 + 3 * u(rng), 10 + 4 * u(rng), big ? 30.0 : 0.3 + 0.2 * u(rng), 8 + std::size_t(k) * 2, k % 2 == 0);
+            a.AddPolygon(la.data(), lo.data(), la.size()); b.AddPolygon(la.data(), lo.data(), la.size());
+            ref.push_back({ 0, 0, 0, shape.size() });
+            shape.emplace_back(la.data(), lo.data(), la.size());
+        }
+        CHECK(a.Fences() == ref.size());
+
+        const std::size_t objects = 300;
+        std::vector<double> lat(objects), lon(objects), t(objects);
+        std::vector<std::uint64_t> id(objects);
+        for (std::size_t k = 0; k < objects; ++k) {
+            lat[k] = 45 + 3 * u(rng); lon[k] = 10 + 4 * u(rng);
+            id[k] = std::uint64_t(k) * 1000003;
+        }
+        std::size_t same = 0, states = 0, kept = 0, events = 0;
+        for (int step = 0; step < 15; ++step) {
+            for (std::size_t k = 0; k < objects; ++k) {
+                lat[k] += 0.05 * u(rng); lon[k] += 0.05 * u(rng);
+                t[k] = step;
+            }
+            std::vector<typename GeodesyFence<P>::Event> one, batch;
+            for (std::size_t k = 0; k < objects; ++k)
+                a.Update(id[k], t[k], lat[k], lon[k], [&](const auto& e) { one.push_back(e); });
+            b.Update(id.data(), t.data(), lat.data(), lon.data(), objects, [&](const auto& e) { batch.push_back(e); });
+            bool equal = one.size() == batch.size();
+            for (std::size_t i = 0; i < one.size() && equal; ++i)
+                equal = one[i].object == batch[i].object && one[i].fence == batch[i].fence && one[i].type == batch[i].type;
+            same += equal;
+            events += one.size();
+            std::size_t occupied = 0;
+            for (std::size_t k = 0; k < objects; ++k) {
+                std::vector<std::size_t> in;
+                for (std::size_t j = 0; j < ref.size(); ++j) {
+                    const Ref& r = ref[j];
+                    const bool x = (r.shape == none) ? P::Distance(lat[k], lon[k], r.lat, r.lon) <= r.radius
+                                                     : shape[r.shape].Contains(lat[k], lon[k]);
+                    if (x) in.push_back(j);
+                }
+                occupied += !in.empty();
+                states += a.Inside(id[k]) == in && b.Inside(id[k]) == in;
+            }
+            kept += a.Objects() == occupied && b.Objects() == occupied;   // states of objects in no fence erased
+        }
+        CHECK(same == 15);
+        CHECK(states == 15 * objects);
+        CHECK(kept == 15);
+        CHECK(events > 100);
+    }
+
+    void TestFence() {
+        FenceChecks<H>();
+        FenceChecks<V>();
+
+        // hysteresis and dwell: 25 m margin, 300 s dwell, 1 km circle
+        GeodesyFence<H> f(25.0, 300.0);
+        f.AddCircle(45.0, 10.0, 1000.0);
+        const double perMeter = 1 / H::Distance(45.0, 10.0, 46.0, 10.0);
+        std::vector<std::pair<GeodesyFence<H>::Type, double>> seen;
+        auto at = [&](double t, double d) {
+            f.Update(7, t, 45.0 + d * perMeter, 10.0, [&](const auto& e) { seen.emplace_back(e.type, e.time); });
+        };
+        using Type = GeodesyFence<H>::Type;
+        at(0, 1050); at(10, 990);                    // outside, then inside by less than the margin
+        CHECK(seen.empty() && f.Objects() == 0);
+        at(20, 960);                                 // inside by the margin
+        at(30, 1010); at(40, 1020);                  // outside by less than the margin
+        CHECK(seen.size() == 1 && seen[0].first == Type::Enter && f.Inside(7) == std::vector<std::size_t>{ 0 });
+        at(400, 900); at(500, 900);                  // one Dwell per stay
+        CHECK(seen.size() == 2 && seen[1].first == Type::Dwell && seen[1].second == 400);
+        at(510, 1030);
+        CHECK(seen.size() == 3 && seen[2].first == Type::Exit && f.Inside(7).empty() && f.Objects() == 0);
+    }
+
+    // Kinematics ******************************************************************
+    using Kin = GeodesyKinematics;
+
+    // flags of a stream of fixes (Meters, seconds)
+    std::vector<std::uint8_t> Flags(const std::vector<double>& t, const std::vector<double>& lat, const std::vector<double>& lon,
+                                    const Kin::Limits<double>& limits, std::vector<double>* distance = nullptr) {
+        std::vector<std::uint8_t> f(t.size(), 0xff);
+        if (distance) distance->assign(t.size(), 0);
+        Kin::Output<double> out;
+        out.flags = f.data();
+        if (distance) out.distance = distance->data();
+        Kin::Process<H>(t.data(), lat.data(), lon.data(), t.size(), limits, out);
+        return f;
+    }
+
+    void TestKinematics() {
+        Kin::Limits<double> limits;
+        limits.maxSpeed = 100;                        // m/s
+        const double perMeter = 1 / H::Distance(45.0, 10.0, 46.0, 10.0);
+
+        // 1 km north every 20 s: no flags, speed 50 m/s
+        std::vector<double> t, lat, lon;
+        for (int i = 0; i < 600; ++i) { t.push_back(20.0 * i); lat.push_back(45 + 1000 * perMeter * i); lon.push_back(10.0); }
+        std::vector<double> speed(t.size());
+        Kin::Output<double> out;
+        out.speed = speed.data();
+        CHECK(Kin::Process<H>(t.data(), lat.data(), lon.data(), t.size(), limits, out) == 0);
+        CHECK(Near(speed[1], 50, 1e-6) && Near(speed[599], 50, 1e-6) && speed[0] == 0);
+
+        // a teleport (fix 300 moved 20 km east): Spike on it, Speed on both legs only
+        std::vector<double> jump = lon;
+        jump[300] += 20000 * perMeter / std::cos(lat[300] * std::numbers::pi / 180);
+        auto f = Flags(t, lat, jump, limits);
+        std::size_t others = 0;
+        for (std::size_t i = 0; i < f.size(); ++i) others += (i != 300 && i != 301 && f[i] != 0);
+        CHECK(f[300] == (Kin::Speed | Kin::Spike) && f[301] == Kin::Speed && others == 0);
+
+        // fix 2 shares the time of fix 1: its leg is not evaluated, so fix 2
+        // is no Spike, though the legs around it are too fast and fixes 1 and
+        // 3 are close
+        const std::vector<double> t4{ 0, 1, 1, 2 }, lat4{ 45.0, 45.1, 45.2, 45.1 + 10 * perMeter }, lon4(4, 10.0);
+        f = Flags(t4, lat4, lon4, limits);
+        CHECK(f[1] == Kin::Speed && f[2] == Kin::Time && f[3] == Kin::Speed);
+
+        // invalid coordinates: the fix is flagged, neither of its legs evaluated
+        std::vector<double> bad = lat, distance;
+        bad[100] = 95;
+        bad[0] = std::numeric_limits<double>::quiet_NaN();
+        f = Flags(t, bad, lon, limits, &distance);
+        CHECK(f[0] == Kin::Invalid && f[1] == 0 && distance[1] == -1 && distance[2] > 0);
+        CHECK(f[100] == Kin::Invalid && f[101] == 0 && distance[100] == -1 && distance[101] == -1 && distance[102] > 0);
+
+        // batch: CSR streams over the threads, as one stream each
+        std::vector<double> bt, blat, blon;
+        std::vector<std::size_t> offsets{ 0 };
+        std::mt19937_64 rng(750);
+        std::uniform_real_distribution<double> u(-1.0, 1.0);
+        for (int k = 0; k < 300; ++k) {
+            double la = 45 + 3 * u(rng), lo = 10 + 3 * u(rng), time = 0;
+            for (int i = 0; i < 50 + k; ++i) {
+                time += (i % 37 == 5) ? 0 : 10 + 5 * u(rng);       // now and then a repeated time
+                la += 0.005 * u(rng) + ((i % 53 == 7) ? 0.5 : 0);    // and a jump
+                lo += 0.005 * u(rng);
+                bt.push_back(time); blat.push_back(la); blon.push_back(lo);
+            }
+            offsets.push_back(bt.size());
+        }
+        limits.maxAcceleration = 5;
+        limits.maxTurnRate = 30;
+        limits.minDistance = 50;
+        std::size_t agree = 0, flagged = 0;
+        for (unsigned threads : { 1u, 2u, 7u }) {
+            GeodesyParallel::SetThreads(threads);
+            std::vector<std::uint8_t> all(bt.size(), 0xff);
+            Kin::Output<double> o;
+            o.flags = all.data();
+            flagged = Kin::Process<H>(bt.data(), blat.data(), blon.data(), offsets.data(), offsets.size() - 1, limits, o);
+            bool same = true;
+            std::size_t count = 0;
+            for (std::size_t k = 0; k + 1 < offsets.size(); ++k) {
+                const std::size_t a = offsets[k], b = offsets[k + 1];
+                const std::vector<double> st(bt.begin() + a, bt.begin() + b), sla(blat.begin() + a, blat.begin() + b), slo(blon.begin() + a, blon.begin() + b);
+                const auto one = Flags(st, sla, slo, limits);
+                same = same && std::equal(one.begin(), one.end(), all.begin() + a);
+                for (auto x : one) count += x != 0;
+            }
+            agree += same && count == flagged;
+        }
+        GeodesyParallel::SetThreads(0);
+        CHECK(agree == 3);
+        CHECK(flagged > 100);
+    }
+
+    // Driver **********************************************************************
+    struct Module { const char* name; void (*run)(); };
+
+    const Module modules[] = {
+        { "policy", TestPolicy },
+        { "graph",  TestGraph },
+        { "route",  TestRoute },
+        { "tour",   TestTour },
+        { "cluster", TestCluster },
+        { "trajectory", TestTrajectory },
+        { "segment", TestSegment },
+        { "area", TestArea },
+        { "polygon", TestPolygon },
+        { "intersect", TestIntersect },
+        { "simplify", TestSimplify },
+        { "rank", TestRank },
+        { "sort", TestSort },
+        { "tracker", TestTracker },
+        { "fence", TestFence },
+        { "kinematics", TestKinematics },
+    };
+}
+
+int main(int argc, char** argv) {
+    const std::string only = (argc > 1) ? argv[1] : "";
+    std::printf("module,checks,failures\n");
+    bool any = false;
+    for (const Module& m : modules) {
+        if (!only.empty() && only != m.name) continue;
+        any = true;
+        std::size_t c0 = checks, f0 = failures;
+        m.run();
+        std::printf("%s,%zu,%zu\n", m.name, checks - c0, failures - f0);
+    }
+    if (!any) {
+        std::fprintf(stderr, "geodesy_test: no module %s\n", only.c_str());
+        return 1;
+    }
+    std::printf("result,%s,\n", failures ? "FAIL" : "PASS");
+    return failures ? 2 : 0;
+}
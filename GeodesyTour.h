@@ -0,0 +1,347 @@
+﻿/**********************************************************************************
+Module        : GeodesyTour.h | Header File | C++
+Description   : Tour construction and 2-opt/Or-opt improvement on geodesic distances
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+#include "GeodesyIndex.h"
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+
+/// <summary>
+/// Class GeodesyTour builds and improves closed tours (TSP) over geo-points
+/// without a distance matrix: distances are computed on demand from
+/// prepared points (GeodesyPolicy::Prepare), and candidate moves are
+/// restricted to the k nearest neighbors of each stop, found with a
+/// GeodesyIndex. A tour is a permutation of the stop indices 0 .. n-1.
+/// Template parameters: P, a GeodesyPolicy method; T, the precision.
+/// </summary>
+class GeodesyTour {
+
+public:
+    using Id = std::uint32_t;
+
+    struct Options {
+        std::size_t neighbors = 10;   // candidate list length per stop
+        std::size_t maxSegment = 3;   // Or-opt: longest segment moved
+        std::size_t maxRounds = 1000; // evaluate/apply rounds
+    };
+
+    /// <summary>
+    /// Initial tour: stops in Z-order (Morton) of their unit vectors,
+    /// a space-filling curve that keeps nearby stops close in the tour
+    /// </summary>
+    template<class P, class T>
+    static std::vector<Id> SpaceFilling(const T* lat, const T* lon, std::size_t n) {
+        std::vector<std::pair<std::uint64_t, Id>> key(n);
+        GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i) {
+                auto v = GeodesyPolicy::BoundVector<P>(lat[i], lon[i]);
+                key[i] = { Morton(Quantize(v.x), Quantize(v.y), Quantize(v.z)), static_cast<Id>(i) };
+            }
+        });
+        std::sort(key.begin(), key.end());
+        std::vector<Id> tour(n);
+        for (std::size_t i = 0; i < n; ++i) tour[i] = key[i].second;
+        return tour;
+    }
+
+    /// <summary>
+    /// Length of the closed tour in P::Units; -1 if any leg fails
+    /// </summary>
+    template<class P, class T>
+    static T Length(const T* lat, const T* lon, const std::vector<Id>& tour) {
+        const std::size_t n = tour.size();
+        if (n < 2) return 0;
+        T s = GeodesyParallel::Sum(n, [&](std::size_t lo, std::size_t hi) {
+            T sum = 0;
+            for (std::size_t i = lo; i < hi; ++i) {
+                Id a = tour[i], b = tour[(i + 1) % n];
+                T d = P::Distance(lat[a], lon[a], lat[b], lon[b]);
+                if (d < 0) return std::numeric_limits<T>::quiet_NaN();
+                sum += d;
+            }
+            return sum;
+        });
+        return (s >= 0) ? s : -1;
+    }
+
+    /// <summary>
+    /// Local search: 2-opt (replace two edges by the two reconnecting
+    /// their endpoints crosswise) and Or-opt (move a segment of up to
+    /// maxSegment stops, either orientation, between two other stops),
+    /// with neighbor-list candidates. Each round evaluates the best
+    /// improving move of every active stop in parallel, then applies the
+    /// moves in order of decreasing gain, each re-evaluated on the current
+    /// tour (results do not depend on the thread count); only the stops
+    /// at the ends of changed edges stay active (don't-look bits). Stops
+    /// at a local optimum or after maxRounds.
+    /// </summary>
+    /// <param name="tour">vector: closed tour to improve in place</param>
+    /// <returns>T: length of the improved tour, P::Units</returns>
+    template<class P, class T>
+    static T Improve(const T* lat, const T* lon, std::vector<Id>& tour,
+                     const Options& opt = {}) {
+        const std::size_t n = tour.size();
+        if (n < 5) return Length<P>(lat, lon, tour);
+        Search<P, T> s(lat, lon, tour, opt);
+        s.Run();
+        return Length<P>(lat, lon, tour);
+    }
+
+private:
+    static std::uint64_t Quantize(double x) {
+        return static_cast<std::uint64_t>(std::clamp((x + 1) / 2, 0.0, 1.0) * ((1 << 21) - 1));
+    }
+
+    // interleave the bits of three 21-bit coordinates
+    static std::uint64_t Morton(std::uint64_t x, std::uint64_t y, std::uint64_t z) {
+        auto spread = [](std::uint64_t v) {
+            v &= 0x1fffff;
+            v = (v | v << 32) & 0x1f00000000ffffull;
+            v = (v | v << 16) & 0x1f0000ff0000ffull;
+            v = (v | v << 8) & 0x100f00f00f00f00full;
+            v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+            v = (v | v << 2) & 0x1249249249249249ull;
+            return v;
+        };
+        return spread(x) << 2 | spread(y) << 1 | spread(z);
+    }
+
+    template<class P, class T>
+    class Search {
+
+    public:
+        Search(const T* lat, const T* lon, std::vector<Id>& tour, const Options& opt)
+            : n(tour.size()), tour(tour), opt(opt), pts(n), pos(n), best(n) {
+            auto* out = pts.data();
+            GeodesyParallel::For(n, [=](std::size_t lo, std::size_t hi) {
+                for (std::size_t i = lo; i < hi; ++i) out[i] = P::Prepare(lat[i], lon[i]);
+            }, GeodesyParallel::grain / P::cost);
+
+            // candidate lists: k nearest stops, nearest first
+            GeodesyIndex<P, T> index(lat, lon, n);
+            std::vector<Id> stored(n);
+            for (std::size_t k = 0; k < n; ++k) stored[index.Original(k)] = static_cast<Id>(k);
+            k = std::min(opt.neighbors, n - 1);
+            near.resize(n * k);
+            GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+                for (std::size_t i = lo; i < hi; ++i) {
+                    auto nn = index.Nearest(index.Vector(stored[i]), k, stored[i]);
+                    for (std::size_t j = 0; j < k; ++j)
+                        near[i * k + j] = (j < nn.size()) ? index.Original(nn[j].second) : static_cast<Id>(i);
+                }
+            }, 1024);
+
+            // reverse candidate lists: stops that have v as a candidate
+            rOff.assign(n + 1, 0);
+            for (Id v : near) ++rOff[v + 1];
+            for (std::size_t v = 0; v < n; ++v) rOff[v + 1] += rOff[v];
+            rNear.resize(near.size());
+            std::vector<Id> fill(rOff.begin(), rOff.end() - 1);
+            for (std::size_t i = 0; i < n; ++i)
+                for (std::size_t j = 0; j < k; ++j) rNear[fill[near[i * k + j]]++] = static_cast<Id>(i);
+        }
+
+        void Run() {
+            for (std::size_t i = 0; i < n; ++i) pos[tour[i]] = static_cast<Id>(i);
+            active.assign(n, 1);
+            for (std::size_t round = 0; round < opt.maxRounds; ++round) {
+                // don't-look bits: only stops next to a changed edge are
+                // evaluated again
+                work.clear();
+                for (std::size_t a = 0; a < n; ++a)
+                    if (active[a]) { work.push_back(static_cast<Id>(a)); active[a] = 0; }
+                if (work.empty()) {
+                    // confirm the local optimum with one pass over all stops
+                    if (verified) break;
+                    verified = true;
+                    std::fill(active.begin(), active.end(), 1);
+                    continue;
+                }
+
+                GeodesyParallel::For(work.size(), [this](std::size_t lo, std::size_t hi) {
+                    for (std::size_t j = lo; j < hi; ++j) best[j] = Best(work[j]);
+                }, 256);
+
+                std::vector<Move> moves;
+                for (std::size_t j = 0; j < work.size(); ++j) if (best[j].gain > 0) moves.push_back(best[j]);
+                std::sort(moves.begin(), moves.end(), [](const Move& x, const Move& y) {
+                    return x.gain != y.gain ? x.gain > y.gain : x.a < y.a;
+                });
+                for (const Move& m : moves) Apply(m);
+            }
+        }
+
+    private:
+        enum Kind : std::uint8_t { TwoOptSucc, TwoOptPred, OrOpt };
+
+        // TwoOpt*: a, c = stops whose tour edges are exchanged;
+        // OrOpt: segment of len stops from a, inserted after c, reversed or not
+        struct Move {
+            T gain = 0;
+            Id a = 0, c = 0;
+            Kind kind = TwoOptSucc;
+            std::uint8_t len = 0;
+            bool reversed = false;
+        };
+
+        // improvements below this are rounding noise
+        static constexpr T ε = T(1e-9);
+
+        std::size_t n, k = 0;
+        std::vector<Id>& tour;
+        const Options& opt;
+        std::vector<GeodesyPolicy::Point<T>> pts;
+        std::vector<Id> pos, near, work, rOff, rNear;
+        std::vector<Move> best;
+        std::vector<char> active;
+        bool verified = false; // a full pass found no move since the last change
+
+        T D(Id a, Id b) const { return P::Distance(pts[a], pts[b]); }
+        Id Succ(Id a) const { return tour[(pos[a] + 1) % n]; }
+        Id Pred(Id a) const { return tour[(pos[a] + n - 1) % n]; }
+        Id At(std::size_t i) const { return tour[i % n]; }
+
+        // segment [s0 .. s0 + len - 1] contains v
+        bool InSegment(Id v, Id s0, std::size_t len) const {
+            return (pos[v] + n - pos[s0]) % n < len;
+        }
+
+        T Gain(const Move& m) const {
+            if (m.kind != OrOpt) {
+                const bool succ = (m.kind == TwoOptSucc);
+                Id a = m.a, c = m.c;
+                Id b = succ ? Succ(a) : Pred(a), d = succ ? Succ(c) : Pred(c);
+                if (a == c || c == b || d == a) return 0;
+                return D(a, b) + D(c, d) - D(a, c) - D(b, d);
+            }
+            if (std::size_t(m.len) + 2 >= n) return 0;
+            Id s0 = m.a, sL = At(pos[s0] + m.len - 1);
+            Id p = Pred(s0), nx = At(pos[s0] + m.len);
+            Id x = m.c, y = Succ(x);
+            if (InSegment(x, s0, m.len) || InSegment(y, s0, m.len) || x == p) return 0;
+            Id X = m.reversed ? sL : s0, Y = m.reversed ? s0 : sL;
+            return D(p, s0) + D(sL, nx) - D(p, nx) + D(x, y) - D(x, X) - D(Y, y);
+        }
+
+        // best improving move involving stop a and its candidates
+        Move Best(Id a) const {
+            Move top;
+            auto offer = [&](Move m) {
+                m.gain = Gain(m);
+                if (m.gain > ε && m.gain > top.gain) top = m;
+            };
+            const Id* cand = near.data() + std::size_t(a) * k;
+
+            for (Kind kind : { TwoOptSucc, TwoOptPred }) {
+                Id b = (kind == TwoOptSucc) ? Succ(a) : Pred(a);
+                T dab = D(a, b);
+                for (std::size_t j = 0; j < k; ++j) {
+                    Id c = cand[j];
+                    if (dab - D(a, c) <= 0) break; // candidates are nearest first
+                    offer({ 0, a, c, kind, 0, false });
+                }
+            }
+
+            // Or-opt: segments starting or ending at a, reconnected to a candidate
+            for (std::size_t len = 1; len <= opt.maxSegment && len + 2 < n; ++len) {
+                Id s0 = a;
+                for (std::size_t j = 0; j < k; ++j) {
+                    Id c = cand[j];
+                    // s0 next to c: ..c, s0..sL, y.. or ..x, sL..s0, c..
+                    offer({ 0, s0, c, OrOpt, std::uint8_t(len), false });
+                    offer({ 0, s0, Pred(c), OrOpt, std::uint8_t(len), true });
+                }
+                Id e0 = At(pos[a] + n - (len - 1)); // segment ending at a
+                for (std::size_t j = 0; j < k; ++j) {
+                    Id c = cand[j];
+                    offer({ 0, e0, Pred(c), OrOpt, std::uint8_t(len), false });
+                    offer({ 0, e0, c, OrOpt, std::uint8_t(len), true });
+                }
+            }
+            return top;
+        }
+
+        void Apply(const Move& m) {
+            // superseded by an earlier move of the round: look again
+            if (Gain(m) <= ε) { active[m.a] = 1; return; }
+            // wake the endpoints of the removed edges and the stops that
+            // have them as candidates
+            auto wake = [&](Id v) {
+                active[v] = 1;
+                for (Id j = rOff[v]; j < rOff[v + 1]; ++j) active[rNear[j]] = 1;
+            };
+            if (m.kind != OrOpt) {
+                const bool succ = (m.kind == TwoOptSucc);
+                for (Id v : { m.a, m.c, succ ? Succ(m.a) : Pred(m.a), succ ? Succ(m.c) : Pred(m.c) })
+                    wake(v);
+            }
+            else {
+                for (Id v : { m.a, Pred(m.a), At(pos[m.a] + m.len - 1), At(pos[m.a] + m.len), m.c, Succ(m.c) })
+                    wake(v);
+            }
+            if (m.kind == TwoOptSucc) Reverse(pos[Succ(m.a)], pos[m.c]);
+            else if (m.kind == TwoOptPred) Reverse(pos[m.a], pos[Pred(m.c)]);
+            else Relocate(m);
+            verified = false;
+        }
+
+        // reverse tour positions i .. j (forward, wrapping), or the
+        // complementary part of the cycle if that is shorter
+        void Reverse(std::size_t i, std::size_t j) {
+            std::size_t len = (j + n - i) % n + 1;
+            if (2 * len > n) { std::size_t ni = (j + 1) % n; j = (i + n - 1) % n; i = ni; len = n - len; }
+            for (std::size_t t = 0; t < len / 2; ++t) {
+                std::size_t u = (i + t) % n, v = (i + len - 1 - t) % n;
+                std::swap(tour[u], tour[v]);
+                pos[tour[u]] = static_cast<Id>(u);
+                pos[tour[v]] = static_cast<Id>(v);
+            }
+        }
+
+        // Or-opt: the segment S moves past the shorter of the two gaps
+        // between it and the insertion point, p S G y -> p G S y or
+        // x H S n -> x S H n, rewriting only those positions
+        void Relocate(const Move& m) {
+            const std::size_t s0 = pos[m.a], len = m.len;
+            const std::size_t g = (pos[m.c] + n - (s0 + len - 1) % n) % n;
+            const std::size_t h = n - len - g;
+            std::vector<Id> seg(len), part;
+            for (std::size_t t = 0; t < len; ++t) seg[t] = At(s0 + t);
+            if (m.reversed) std::reverse(seg.begin(), seg.end());
+            std::size_t start;
+            if (g <= h) {
+                start = s0;
+                for (std::size_t t = 0; t < g; ++t) part.push_back(At(s0 + len + t));
+                part.insert(part.end(), seg.begin(), seg.end());
+            }
+            else {
+                start = (s0 + n - h) % n;
+                part = seg;
+                for (std::size_t t = 0; t < h; ++t) part.push_back(At(start + t));
+            }
+            for (std::size_t t = 0; t < part.size(); ++t) {
+                std::size_t u = (start + t) % n;
+                tour[u] = part[t];
+                pos[part[t]] = static_cast<Id>(u);
+            }
+        }
+    };
+};
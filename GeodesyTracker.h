@@ -0,0 +1,244 @@
+﻿/**********************************************************************************
+Module        : GeodesyTracker.h | Header File | C++
+Description   : Incremental distances from moving objects to fixed targets
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <numbers>
+#include <utility>
+#include <vector>
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+
+/// <summary>
+/// Class GeodesyTracker maintains the distances from moving objects to
+/// fixed targets (points of interest) without recomputing them on every
+/// move. Each object has an anchor, where its distances d0 to the targets
+/// and the unit directions u to them are exact (P::Distance); a move by s
+/// from the anchor updates every distance to first order,
+///   d ≈ d0 - s·(u . move direction)   (two multiply-adds per target),
+/// with the rigorous error bound s²/(m - s), m = min(d0, half the
+/// circumference - d0), grown for Vincenty by s·(2% + f·h / (h - d0)),
+/// h half the meridian (direction and scale of the sphere, which deviate
+/// increasingly towards the antipode), and 1 mm; never above s (triangle
+/// inequality); bounds include a relative 1e-9 for rounding.
+/// Targets may have a radius: an object is inside when its distance is
+/// at most the radius, and crossings are reported as events; a crossing
+/// is decided by the estimate when it is farther than the bound from the
+/// radius, otherwise by P::Distance. Objects moving more than maxShift
+/// from their anchor are re-anchored (exact recomputation).
+/// Distances are in P::Units.
+/// </summary>
+template<class P, class T = double>
+class GeodesyTracker {
+
+public:
+    struct Event {
+        std::size_t object, target;
+        bool inside;                  // entered (true) or left (false)
+    };
+
+    /// <summary>
+    /// Targets (decimal degrees) with radius (P::Units; null: no events)
+    /// </summary>
+    /// <param name="maxShift">T: move from the anchor that triggers re-anchoring, P::Units</param>
+    GeodesyTracker(const T* lat, const T* lon, std::size_t targets, const T* radius, T maxShift)
+        : tlat(lat, lat + targets), tlon(lon, lon + targets), tv(targets),
+          radius(radius ? std::vector<T>(radius, radius + targets) : std::vector<T>()),
+          maxShift(maxShift) {
+        for (std::size_t t = 0; t < targets; ++t) tv[t] = Unit(lat[t], lon[t]);
+    }
+
+    std::size_t Targets() const { return tv.size(); }
+    std::size_t Objects() const { return object.size(); }
+
+    /// <summary>
+    /// New object at (lat, lon), anchored there; returns its id. Its
+    /// inside states are set without events. Not concurrent with Move.
+    /// </summary>
+    std::size_t Add(T lat, T lon) {
+        const std::size_t k = object.size();
+        object.emplace_back();
+        d0.resize(d0.size() + Targets());
+        ux.resize(d0.size());
+        uy.resize(d0.size());
+        inside.resize(d0.size());
+        Anchor(k, lat, lon);
+        for (std::size_t t = 0; t < Targets() && !radius.empty(); ++t)
+            inside[k * Targets() + t] = d0[k * Targets() + t] >= 0 && d0[k * Targets() + t] <= radius[t];
+        return k;
+    }
+
+    /// <summary>
+    /// Move object k to (lat, lon); event(Event) for each target it
+    /// entered or left, in target order
+    /// </summary>
+    template<class F>
+    void Move(std::size_t k, T lat, T lon, F&& event) {
+        Update(k, lat, lon, event);
+    }
+
+    /// <summary>
+    /// Batch: object id[i] to (lat[i], lon[i]); each object at most once
+    /// per batch. Objects are updated in parallel; events are then passed
+    /// to event(Event) in input order.
+    /// </summary>
+    template<class I, class F>
+    void Move(const I* id, const T* lat, const T* lon, std::size_t n, F&& event) {
+        std::vector<std::pair<std::size_t, std::vector<Event>>> parts;
+        std::mutex lock;
+        GeodesyParallel::For(n, [&](std::size_t lo, std::size_t hi) {
+            std::vector<Event> part;
+            for (std::size_t i = lo; i < hi; ++i)
+                Update(static_cast<std::size_t>(id[i]), lat[i], lon[i], [&](const Event& e) { part.push_back(e); });
+            std::lock_guard<std::mutex> guard(lock);
+            parts.emplace_back(lo, std::move(part));
+        }, std::max<std::size_t>(1, GeodesyParallel::grain / 4 / std::max<std::size_t>(Targets(), 1)));
+        std::sort(parts.begin(), parts.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (const auto& part : parts)
+            for (const Event& e : part.second) event(e);
+    }
+
+    /// <summary>
+    /// First-order distance from object k at its last position to target
+    /// t; bound (may be null) receives its error bound. Both are -1 where
+    /// the anchor distance failed (Vincenty next to the antipode).
+    /// </summary>
+    T Distance(std::size_t k, std::size_t t, T* bound = nullptr) const {
+        const State& o = object[k];
+        const std::size_t j = k * Targets() + t;
+        T b;
+        T d = Estimate(o, j, b);
+        if (bound) *bound = b;
+        return d;
+    }
+
+    // exact distance (P::Distance) from object k to target t
+    T Exact(std::size_t k, std::size_t t) const {
+        return P::Distance(object[k].lat, object[k].lon, tlat[t], tlon[t]);
+    }
+
+    bool Inside(std::size_t k, std::size_t t) const { return inside[k * Targets() + t] != 0; }
+
+private:
+    using Vec3 = GeodesyPolicy::Vec3<T>;
+    using M = typename P::Math;
+    using K = GeodesyKernels;
+
+    // object: anchor (position, unit vector, local east and north) and
+    // its displacement from there, east/north components and length
+    struct State {
+        T alat = 0, alon = 0;
+        Vec3 p0{}, east{}, north{};
+        T lat = 0, lon = 0;
+        T Δe = 0, Δn = 0, s = 0;
+    };
+
+    std::vector<T> tlat, tlon;
+    std::vector<Vec3> tv;
+    std::vector<T> radius;
+    T maxShift;
+    std::vector<State> object;
+    // per object and target (object-major): anchor distance and the unit
+    // direction to the target there (east, north); inside state
+    std::vector<T> d0, ux, uy;
+    std::vector<std::uint8_t> inside;
+
+    static constexpr T ε = (P::boundF == 0) ? T(0) : T(0.02);
+    // Vincenty: relative error of the spherical first order at distance d0,
+    // checked against P::Distance over 1e6 random moves and targets
+    static T Skew(T d0) { return (P::boundF == 0) ? T(0) : ε + T(P::boundF) * Half() / (Half() - d0); }
+    // rounding, and the convergence of the Vincenty iteration (1 mm)
+    static constexpr T slack = (P::boundF == 0) ? T(0) : T(1e-6 * P::Units::perKm);
+
+    static T Scale() { return T(P::Ellipsoid::R * P::Units::perKm); }
+    static T Half() { return std::numbers::pi_v<T> * T(P::boundR * P::Units::perKm); }
+
+    static Vec3 Unit(T lat, T lon) { return GeodesyKernels::UnitVector<M>(lat, lon); }
+
+    T Estimate(const State& o, std::size_t j, T& bound) const {
+        if (!(d0[j] >= 0)) { bound = -1; return T(-1); }
+        const T m = std::min(d0[j], Half() - d0[j]);
+        if (o.s == 0) { bound = 0; return d0[j]; }
+        const T tol = T(1e-9) * (std::fabs(d0[j]) + o.s) + slack;
+        if (2 * o.s < m) {
+            bound = o.s * o.s / (m - o.s) + Skew(d0[j]) * o.s;
+            if (bound < o.s) { bound += tol; return d0[j] - (o.Δe * ux[j] + o.Δn * uy[j]); }
+        }
+        // far moves: the anchor distance, within s (triangle inequality)
+        bound = o.s + tol;
+        return d0[j];
+    }
+
+    // exact distances and directions to every target from (lat, lon)
+    void Anchor(std::size_t k, T lat, T lon) {
+        State& o = object[k];
+        const T φ = lat * GeodesyKernels::toRad<T>, λ = lon * GeodesyKernels::toRad<T>;
+        const T sφ = M::Sin(φ), cφ = M::Cos(φ), sλ = M::Sin(λ), cλ = M::Cos(λ);
+        o = State{};
+        o.alat = o.lat = lat;
+        o.alon = o.lon = lon;
+        o.p0 = { cφ * cλ, cφ * sλ, sφ };
+        o.east = { -sλ, cλ, 0 };
+        o.north = { -sφ * cλ, -sφ * sλ, cφ };
+        const std::size_t base = k * Targets();
+        for (std::size_t t = 0; t < Targets(); ++t) {
+            d0[base + t] = P::Distance(lat, lon, tlat[t], tlon[t]);
+            // direction to the target: its tangent component at p0
+            T e = K::Dot(tv[t], o.east), n = K::Dot(tv[t], o.north), l = M::Sqrt(e * e + n * n);
+            ux[base + t] = (l > 0) ? e / l : T(0);
+            uy[base + t] = (l > 0) ? n / l : T(0);
+        }
+    }
+
+    template<class F>
+    void Update(std::size_t k, T lat, T lon, F&& event) {
+        State& o = object[k];
+        const std::size_t base = k * Targets();
+        T s = P::Distance(o.alat, o.alon, lat, lon);
+        if (!(s >= 0) || s > maxShift) {
+            Anchor(k, lat, lon);
+            s = 0;
+        }
+        else {
+            const Vec3 p = Unit(lat, lon);
+            const Vec3 Δ{ p.x - o.p0.x, p.y - o.p0.y, p.z - o.p0.z };
+            o.lat = lat; o.lon = lon;
+            o.Δe = K::Dot(Δ, o.east) * Scale();
+            o.Δn = K::Dot(Δ, o.north) * Scale();
+            o.s = s;
+        }
+        if (radius.empty()) return;
+        for (std::size_t t = 0; t < Targets(); ++t) {
+            const std::size_t j = base + t;
+            T bound;
+            T d = Estimate(o, j, bound);
+            bool in;
+            if (d0[j] >= 0 && d + bound <= radius[t]) in = true;
+            else if (d0[j] >= 0 && d - bound > radius[t]) in = false;
+            else {
+                T x = P::Distance(lat, lon, tlat[t], tlon[t]);
+                in = x >= 0 && x <= radius[t];
+            }
+            if (in != (inside[j] != 0)) {
+                inside[j] = in;
+                event(Event{ k, t, in });
+            }
+        }
+    }
+};
@@ -0,0 +1,272 @@
+﻿/**********************************************************************************
+Module        : GeodesyTrajectory.h | Header File | C++
+Description   : Trajectory similarity: discrete Frechet, Hausdorff and DTW distances
+Version       : 20.1.001
+***********************************************************************************
+Author        : Alexander Bell
+Copyright     : 2011-2025 Alexander Bell
+***********************************************************************************
+DISCLAIMER   : This Module is provided on AS IS basis without any warranty.
+             : The user assumes the entire risk as to the accuracy and the use of
+             : this module. In no event shall the author be liable for any damages
+             : arising out of the use of or inability to use this module.
+TERMS OF USE : This module is copyrighted. Please keep the Copyright notice intact.
+***********************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "GeodesyParallel.h"
+#include "GeodesyPolicy.h"
+
+/// <summary>
+/// Class GeodesyTrajectory compares trajectories (tracks of geo-points,
+/// SoA arrays lat[], lon[] in decimal degrees) with the point distance of
+/// a GeodesyPolicy method P:
+///   Frechet: discrete Frechet distance (max leg of the best coupling);
+///   Hausdorff: symmetric Hausdorff distance;
+///   DTW: dynamic time warping (sum over the best warping path).
+/// Results are in P::Units. Each measure takes a limit: once the result
+/// is known to exceed it the computation stops and returns +infinity
+/// (early abandoning), and point pairs whose chord lower bound exceeds
+/// it are never evaluated. Empty tracks and failed distances return -1.
+/// </summary>
+class GeodesyTrajectory {
+
+public:
+    enum class Measure { Frechet, Hausdorff, DTW };
+
+    template<class T>
+    static constexpr T inf = std::numeric_limits<T>::infinity();
+
+    template<class P, class T>
+    static T Frechet(const T* lat1, const T* lon1, std::size_t n1,
+                     const T* lat2, const T* lon2, std::size_t n2,
+                     T limit = inf<T>) {
+        return Compare<P>(Measure::Frechet, lat1, lon1, n1, lat2, lon2, n2, limit);
+    }
+
+    template<class P, class T>
+    static T Hausdorff(const T* lat1, const T* lon1, std::size_t n1,
+                       const T* lat2, const T* lon2, std::size_t n2,
+                       T limit = inf<T>) {
+        return Compare<P>(Measure::Hausdorff, lat1, lon1, n1, lat2, lon2, n2, limit);
+    }
+
+    template<class P, class T>
+    static T DTW(const T* lat1, const T* lon1, std::size_t n1,
+                 const T* lat2, const T* lon2, std::size_t n2,
+                 T limit = inf<T>) {
+        return Compare<P>(Measure::DTW, lat1, lon1, n1, lat2, lon2, n2, limit);
+    }
+
+    template<class P, class T>
+    static T Compare(Measure measure,
+                     const T* lat1, const T* lon1, std::size_t n1,
+                     const T* lat2, const T* lon2, std::size_t n2,
+                     T limit = inf<T>) {
+        Track<P, T> a, b;
+        a.Assign(lat1, lon1, n1);
+        b.Assign(lat2, lon2, n2);
+        return Evaluate(measure, a, b, limit);
+    }
+
+    /// <summary>
+    /// Many-vs-one: out[k] = measure between the query track and track k,
+    /// the points offsets[k] .. offsets[k+1]-1 of lat[], lon[] (CSR), or
+    /// +infinity if it exceeds limit. Tracks are first screened with
+    /// O(n) bounding-box lower bounds (no distance evaluations), then
+    /// compared with early abandoning; tracks are split over the threads.
+    /// </summary>
+    template<class P, class T, class I>
+    static void ManyToOne(Measure measure,
+                          const T* qlat, const T* qlon, std::size_t qn,
+                          const T* lat, const T* lon, const I* offsets, std::size_t count,
+                          T* out, T limit = inf<T>) {
+        Track<P, T> q;
+        q.Assign(qlat, qlon, qn);
+        GeodesyParallel::For(count, [&](std::size_t lo, std::size_t hi) {
+            Track<P, T> t; // reused: no allocation per track
+            for (std::size_t k = lo; k < hi; ++k) {
+                const std::size_t first = static_cast<std::size_t>(offsets[k]);
+                t.Assign(lat + first, lon + first, static_cast<std::size_t>(offsets[k + 1]) - first, false);
+                if (LowerBound(measure, q, t) > limit) { out[k] = inf<T>; continue; }
+                t.Prepare(lat + first, lon + first);
+                out[k] = Evaluate(measure, q, t, limit);
+            }
+        }, std::max<std::size_t>(1, 256 / P::cost));
+    }
+
+private:
+    using Size = std::size_t;
+
+    /// <summary>
+    /// Prepared track: P::Prepare points for the distances, unit vectors
+    /// and their bounding box for the chord lower bounds
+    /// </summary>
+    template<class P, class T>
+    struct Track {
+        using Vec3 = GeodesyPolicy::Vec3<T>;
+        std::vector<GeodesyPolicy::Point<T>> pt;
+        std::vector<Vec3> v;
+        Vec3 lo{}, hi{};
+
+        Size Count() const { return v.size(); }
+
+        // unit vectors and box; the prepared points follow with Prepare
+        void Assign(const T* lat, const T* lon, Size n, bool prepare = true) {
+            v.resize(n);
+            for (Size i = 0; i < n; ++i) v[i] = GeodesyPolicy::BoundVector<P>(lat[i], lon[i]);
+            if (prepare) Prepare(lat, lon);
+            if (n == 0) return;
+            lo = hi = v[0];
+            for (const Vec3& p : v) {
+                lo = { std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z) };
+                hi = { std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z) };
+            }
+        }
+
+        void Prepare(const T* lat, const T* lon) {
+            pt.resize(v.size());
+            for (Size i = 0; i < v.size(); ++i) pt[i] = P::Prepare(lat[i], lon[i]);
+        }
+
+        T Distance(Size i, const Track& b, Size j) const { return P::Distance(pt[i], b.pt[j]); }
+
+        T Chord2(Size i, const Track& b, Size j) const { return GeodesyKernels::Chord2(v[i], b.v[j]); }
+
+        // squared chord from point j of b to this track's bounding box
+        T BoxChord2(const Track& b, Size j) const {
+            auto gap = [](T x, T l, T h) { return std::max({ l - x, T(0), x - h }); };
+            T dx = gap(b.v[j].x, lo.x, hi.x), dy = gap(b.v[j].y, lo.y, hi.y), dz = gap(b.v[j].z, lo.z, hi.z);
+            return dx * dx + dy * dy + dz * dz;
+        }
+
+        // P::Distance lower bound of a squared chord (GeodesyPolicy::LowerBound)
+        static T Bound(T c2) {
+            return 2 * P::Math::Asin(std::min(P::Math::Sqrt(c2) / 2, T(1))) *
+                T(P::boundR * P::Units::perKm * (1 - 1e-9));
+        }
+    };
+
+    template<class P, class T>
+    static T Evaluate(Measure measure, const Track<P, T>& a, const Track<P, T>& b, T limit) {
+        if (a.Count() == 0 || b.Count() == 0) return -1;
+        switch (measure) {
+        case Measure::Frechet:   return Coupling<false>(a, b, limit);
+        case Measure::DTW:       return Coupling<true>(a, b, limit);
+        default:                 return HausdorffOf(a, b, limit);
+        }
+    }
+
+    /// <summary>
+    /// Lower bound of the measure from the bounding boxes and end points:
+    /// every point is at least its box distance from the other track;
+    /// couplings (Frechet, DTW) also match both pairs of end points.
+    /// </summary>
+    template<class P, class T>
+    static T LowerBound(Measure measure, const Track<P, T>& a, const Track<P, T>& b) {
+        using Tr = Track<P, T>;
+        if (a.Count() == 0 || b.Count() == 0) return 0;
+        T worst = 0, sumA = 0, sumB = 0;
+        for (Size j = 0; j < b.Count(); ++j) {
+            T c2 = a.BoxChord2(b, j);
+            worst = std::max(worst, c2);
+            if (measure == Measure::DTW && c2 > 0) sumB += Tr::Bound(c2);
+        }
+        for (Size i = 0; i < a.Count(); ++i) {
+            T c2 = b.BoxChord2(a, i);
+            worst = std::max(worst, c2);
+            if (measure == Measure::DTW && c2 > 0) sumA += Tr::Bound(c2);
+        }
+        if (measure == Measure::Hausdorff) return Tr::Bound(worst);
+
+        const Size n = a.Count() - 1, m = b.Count() - 1;
+        T first = Tr::Bound(a.Chord2(0, b, 0)), last = Tr::Bound(a.Chord2(n, b, m));
+        if (measure == Measure::Frechet) return std::max({ Tr::Bound(worst), first, last });
+        T ends = (n == 0 && m == 0) ? first : first + last;
+        return std::max({ sumA, sumB, ends });
+    }
+
+    /// <summary>
+    /// Frechet (sum = false) or DTW (sum = true) by dynamic programming
+    /// over two rows; cells above limit are cut off, and the search stops
+    /// when a whole row is cut off (every coupling crosses every row).
+    /// </summary>
+    template<bool sum, class P, class T>
+    static T Coupling(const Track<P, T>& a, const Track<P, T>& b, T limit) {
+        const Size n = a.Count(), m = b.Count();
+        const T above = GeodesyPolicy::Chord2Above<P>(limit);
+        std::vector<T> prev(m, inf<T>), cur(m, inf<T>);
+        for (Size i = 0; i < n; ++i) {
+            T rowMin = inf<T>;
+            for (Size j = 0; j < m; ++j) {
+                T reach = (i == 0 && j == 0) ? T(0) : inf<T>;
+                if (i > 0) reach = std::min(reach, prev[j]);
+                if (j > 0) reach = std::min(reach, cur[j - 1]);
+                if (i > 0 && j > 0) reach = std::min(reach, prev[j - 1]);
+
+                T v = inf<T>;
+                if (reach <= limit && a.Chord2(i, b, j) <= above) {
+                    T d = a.Distance(i, b, j);
+                    if (!(d >= 0)) return -1;
+                    v = sum ? reach + d : std::max(reach, d);
+                    if (v > limit) v = inf<T>;
+                }
+                cur[j] = v;
+                rowMin = std::min(rowMin, v);
+            }
+            if (rowMin == inf<T>) return inf<T>;
+            std::swap(prev, cur);
+        }
+        return prev[m - 1];
+    }
+
+    /// <summary>
+    /// Hausdorff: max of the two directed distances. A point stops its
+    /// nearest-neighbor scan once it is within the current maximum (it
+    /// cannot raise it); the scan starts at the previous point's nearest
+    /// neighbor, so along similar tracks it usually stops at once. For
+    /// the spherical methods the chord orders the distances, so only
+    /// chord improvements are evaluated; for Vincenty, only points whose
+    /// chord lower bound is below the nearest distance so far. Pairs whose
+    /// chord lower bound exceeds limit are skipped: a point left without a
+    /// neighbor is farther than limit from the other track.
+    /// </summary>
+    template<class P, class T>
+    static T HausdorffOf(const Track<P, T>& a, const Track<P, T>& b, T limit) {
+        T h = 0;
+        const T above = GeodesyPolicy::Chord2Above<P>(limit);
+        auto directed = [&](const Track<P, T>& x, const Track<P, T>& y) {
+            const Size m = y.Count();
+            Size start = 0;
+            for (Size i = 0; i < x.Count(); ++i) {
+                T best = inf<T>, bestC2 = inf<T>;
+                Size arg = start;
+                for (Size t = 0; t < m; ++t) {
+                    Size j = (start + t < m) ? start + t : start + t - m;
+                    T c2 = x.Chord2(i, y, j);
+                    if (c2 > above) continue;
+                    if (P::boundF == 0 ? c2 >= bestC2 : Track<P, T>::Bound(c2) >= best) continue;
+                    T d = x.Distance(i, y, j);
+                    if (!(d >= 0)) return false;
+                    if (d < best) {
+                        best = d; bestC2 = c2; arg = j;
+                        if (best <= h) break;
+                    }
+                }
+                start = arg;
+                if (best > h) h = best;
+                if (h > limit) return true;
+            }
+            return true;
+        };
+        if (!directed(a, b)) return -1;
+        if (h <= limit && !directed(b, a)) return -1;
+        return (h > limit) ? inf<T> : h;
+    }
+};